@@ -0,0 +1,210 @@
+/**
+ * @file audit-log.cpp
+ * @brief Implementation of the EEPROM audit log ring
+ * @author Dag
+ */
+
+#include "audit-log.h"
+#include "def.h"
+#include "frame.h"
+
+#ifdef __AVR__
+#include <avr/eeprom.h>
+#endif
+
+static const byte SLOTS = EEPROM_AUDIT_LOG_SIZE / AUDIT_RECORD_SIZE;
+static const uint16_t SEQ_EMPTY = 0xFFFF;
+
+// The result code is the commit flag: a slot is valid only once it is in range
+static const byte RESULT_OFFSET = 3;
+static const byte RESULT_EMPTY = 0xFF;
+
+// Write steps of a pending record: invalidate result, every other byte, commit result
+static const byte STEP_BODY = 1;
+static const byte STEP_COMMIT = STEP_BODY + AUDIT_RECORD_SIZE - 1;
+static const byte STEP_DONE = STEP_COMMIT + 1;
+
+static byte nextSlot = 0;      // Slot of the next record
+static uint16_t nextSeq = 0;   // Sequence number of the next record
+static byte bootId = 0;        // Boot id stamped on this boot's records
+static byte pending[AUDIT_RECORD_SIZE]; // Record being written
+static byte pendingSlot = 0;   // Slot of the record being written
+static byte pendingStep = STEP_DONE;
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+static int slotAddr(byte slot)
+{
+    return EEPROM_AUDIT_LOG_ADDR + slot * AUDIT_RECORD_SIZE;
+}
+
+static uint16_t slotSeq(byte slot)
+{
+    int addr = slotAddr(slot);
+    return EEPROM.read(addr) | (EEPROM.read(addr + 1) << 8);
+}
+
+/**
+ * @brief A slot holds a committed record
+ * @details The result code is written last, in a single cell: while it reads
+ *          RESULT_EMPTY the rest of the slot may be torn. The range check also
+ *          rejects stale data left in the region by firmware versions that used
+ *          the whole EEPROM for the passphrase.
+ */
+static bool slotValid(byte slot)
+{
+    byte result = EEPROM.read(slotAddr(slot) + RESULT_OFFSET);
+    return slotSeq(slot) != SEQ_EMPTY && result >= AUDIT_GRANTED && result <= AUDIT_USES_EXHAUSTED;
+}
+
+/** @brief FNV-1a over the UID, folded to 16 bits */
+static uint16_t uidHash(const MFRC522::Uid &uid)
+{
+    uint32_t h = 2166136261UL;
+    for (byte i = 0; i < uid.size; i++)
+    {
+        h ^= uid.uidByte[i];
+        h *= 16777619UL;
+    }
+    return (h >> 16) ^ (h & 0xFFFF);
+}
+
+/** @brief Execute one write step of the pending record */
+static void writeStep()
+{
+    int addr = slotAddr(pendingSlot);
+
+    if (pendingStep < STEP_BODY)
+        EEPROM.update(addr + RESULT_OFFSET, RESULT_EMPTY); // Invalidate: slot reads as empty
+    else if (pendingStep < STEP_COMMIT)
+    {
+        byte i = pendingStep - STEP_BODY;
+        if (i >= RESULT_OFFSET)
+            i++; // Skip the result code
+        EEPROM.update(addr + i, pending[i]);
+    }
+    else
+        EEPROM.update(addr + RESULT_OFFSET, pending[RESULT_OFFSET]); // Commit
+
+    pendingStep++;
+}
+
+static bool eepromReady()
+{
+#ifdef __AVR__
+    return eeprom_is_ready();
+#else
+    return true;
+#endif
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+
+void auditLogInit()
+{
+    bool found = false;
+    uint16_t headSeq = 0;
+    byte headSlot = 0;
+
+    for (byte slot = 0; slot < SLOTS; slot++)
+    {
+        if (!slotValid(slot))
+            continue;
+
+        uint16_t seq = slotSeq(slot);
+
+        // Wrap-aware comparison of 16-bit sequence numbers
+        if (!found || (int16_t)(seq - headSeq) > 0)
+        {
+            found = true;
+            headSeq = seq;
+            headSlot = slot;
+        }
+    }
+
+    if (found)
+    {
+        nextSeq = headSeq + 1;
+        if (nextSeq == SEQ_EMPTY)
+            nextSeq = 0;
+        nextSlot = (headSlot + 1) % SLOTS;
+        bootId = EEPROM.read(slotAddr(headSlot) + 2) + 1;
+    }
+}
+
+void auditLogAppend(AuditResult result, const MFRC522::Uid &uid, byte block, unsigned long durationMs)
+{
+    // Complete the previous record before reusing the buffer
+    while (pendingStep < STEP_DONE)
+        writeStep();
+
+    uint16_t hash = uidHash(uid);
+    uint16_t duration = durationMs > 0xFFFF ? 0xFFFF : durationMs;
+    unsigned long seconds = millis() / 1000;
+
+    pending[0] = nextSeq & 0xFF;
+    pending[1] = nextSeq >> 8;
+    pending[2] = bootId;
+    pending[3] = result;
+    pending[4] = hash & 0xFF;
+    pending[5] = hash >> 8;
+    pending[6] = block;
+    pending[7] = duration & 0xFF;
+    pending[8] = duration >> 8;
+    pending[9] = seconds & 0xFF;
+    pending[10] = (seconds >> 8) & 0xFF;
+    pending[11] = (seconds >> 16) & 0xFF;
+
+    pendingSlot = nextSlot;
+    pendingStep = 0;
+
+    nextSlot = (nextSlot + 1) % SLOTS;
+    nextSeq = nextSeq + 1 == SEQ_EMPTY ? 0 : nextSeq + 1;
+}
+
+void auditLogService()
+{
+    if (pendingStep < STEP_DONE && eepromReady())
+        writeStep();
+}
+
+bool auditLogPending()
+{
+    return pendingStep < STEP_DONE;
+}
+
+byte auditLogCount()
+{
+    byte count = 0;
+    for (byte slot = 0; slot < SLOTS; slot++)
+        if (slotValid(slot))
+            count++;
+    return count;
+}
+
+void auditLogExport(Print *out)
+{
+    // The export must reflect every record, including the one being written
+    while (pendingStep < STEP_DONE)
+        writeStep();
+
+    FrameWriter frame(out);
+    frame.begin(FRAME_AUDIT_LOG, auditLogCount() * AUDIT_RECORD_SIZE);
+
+    // Oldest record first: start right after the head
+    for (byte n = 0; n < SLOTS; n++)
+    {
+        byte slot = (nextSlot + n) % SLOTS;
+        if (!slotValid(slot))
+            continue;
+
+        for (byte i = 0; i < AUDIT_RECORD_SIZE; i++)
+            frame.write(EEPROM.read(slotAddr(slot) + i));
+    }
+
+    frame.end();
+}
@@ -0,0 +1,100 @@
+/**
+ * @file audit-log.h
+ * @brief Binary audit log ring in EEPROM
+ * @details Every card transaction appends one fixed-size record to a circular log,
+ *          giving a forensic trail that survives power cycles.
+ *
+ * Record layout (AUDIT_RECORD_SIZE = 12 bytes, little endian):
+ * -----------------------------------------------------------------
+ * Byte 0-1   Sequence number (0xFFFF = empty)
+ * Byte 2     Boot id (incremented at every boot, no EEPROM write needed)
+ * Byte 3     Result code (AuditResult, 0xFF = empty / being written)
+ * Byte 4-5   UID hash (FNV-1a folded to 16 bits)
+ * Byte 6     Failing block (0xFF = none)
+ * Byte 7-8   Transaction duration, detection to halt (ms, saturated)
+ * Byte 9-11  Time since boot (s)
+ * -----------------------------------------------------------------
+ *
+ * Wear spreading: there are no head/tail cells. Slots are used round robin and
+ * the head is found at boot as the record with the highest sequence number,
+ * so every slot is written equally often.
+ *
+ * Capacity: the region holds the last 16 records (EEPROM_AUDIT_LOG_SIZE /
+ * AUDIT_RECORD_SIZE). At a busy door that is minutes of history: export the
+ * log ("log" command, FRAME_AUDIT_LOG) regularly to keep a longer trail.
+ *
+ * Tap latency: records are written in background by auditLogService(), one
+ * byte per loop iteration whenever the EEPROM is idle, with EEPROM.update()
+ * skipping unchanged cells. The result code is the commit flag: it is
+ * invalidated first and written last, in a single cell, so a power cut
+ * mid-write leaves an empty slot. A cut during that last cell write may leave
+ * a wrong result code, never a torn sequence number or body.
+ * @author Dag
+ */
+
+#ifndef RFID_AUDIT_LOG_H
+#define RFID_AUDIT_LOG_H
+
+#include "Arduino.h"
+#include <MFRC522.h>
+
+const byte AUDIT_RECORD_SIZE = 12;
+const byte AUDIT_NO_BLOCK = 0xFF;
+
+/**
+ * @brief Transaction result codes
+ */
+enum AuditResult : byte
+{
+    AUDIT_GRANTED = 1,        // Valid credential, access granted
+    AUDIT_DENIED = 2,         // Invalid credential
+    AUDIT_UID_DENIED = 3,     // UID denylisted / not allowlisted
+    AUDIT_INCOMPATIBLE = 4,   // Unsupported card type
+    AUDIT_AUTH_FAILED = 5,    // Authentication failed (block recorded)
+    AUDIT_READ_FAILED = 6,    // Block read failed (block recorded)
+    AUDIT_WRITE_FAILED = 7,   // Block write failed (block recorded)
+    AUDIT_WRITTEN = 8,        // Card programmed
+    AUDIT_SET = 9,            // SET mode: secret updated
+    AUDIT_SET_FAILED = 10,    // SET mode: EEPROM store failed
+    AUDIT_UID_MISMATCH = 11,  // Host job: card UID differs from the expected one
+    AUDIT_USES_EXHAUSTED = 12 // Valid usage-limited badge with no entry left
+};
+
+/**
+ * @brief Scan the log region to find the head and the next boot id
+ * @details Called once at boot.
+ */
+void auditLogInit();
+
+/**
+ * @brief Queue a record for the current transaction
+ * @details The record is written in background by auditLogService(). If the
+ *          previous record is still pending it is completed first (blocking).
+ * @param result Transaction result
+ * @param uid Card UID
+ * @param block Failing block, AUDIT_NO_BLOCK if none
+ * @param durationMs Transaction duration in milliseconds
+ */
+void auditLogAppend(AuditResult result, const MFRC522::Uid &uid, byte block, unsigned long durationMs);
+
+/**
+ * @brief Write the pending record, one EEPROM cell per call
+ * @details Non-blocking: returns immediately while the EEPROM is busy. Call from loop().
+ */
+void auditLogService();
+
+/** @brief A record is queued or half written: auditLogService() still has work to do */
+bool auditLogPending();
+
+/**
+ * @brief Stream the whole log as one FRAME_AUDIT_LOG frame (oldest record first)
+ * @param out Destination stream
+ */
+void auditLogExport(Print *out);
+
+/**
+ * @brief Number of valid records in the log
+ */
+byte auditLogCount();
+
+#endif // RFID_AUDIT_LOG_H
@@ -0,0 +1,135 @@
+/**
+ * @file clone.cpp
+ * @brief Implementation of the streaming card clone / backup
+ * @author Dag
+ */
+
+#include "clone.h"
+#include "sector-io.h"
+
+static CloneTarget target = CLONE_TO_SERIAL;
+static CloneStage stage = CLONE_IDLE;
+static const byte *fallbackBits; // Access bits for damaged source trailers
+static byte chunks = 0;     // Chunks of the source card
+static byte unreadable = 0; // Chunks skipped because no key opened them
+static SectorChunk chunk;   // The only card data held in SRAM
+static MFRC522::Uid source; // Source card, size 0 until first presented
+static MFRC522::Uid copy;   // Target card, size 0 until first presented
+
+static bool sameUid(const MFRC522::Uid &a, const MFRC522::Uid &b)
+{
+    return a.size == b.size && memcmp(a.uidByte, b.uidByte, a.size) == 0;
+}
+
+static void finish(EventQueue *events)
+{
+    events->publish(EV_CLONE_DONE, chunks - unreadable, unreadable);
+    stage = CLONE_IDLE;
+}
+
+void cloneBegin(CloneTarget to, const byte *defaultAccessBits)
+{
+    target = to;
+    fallbackBits = defaultAccessBits;
+    stage = CLONE_SOURCE;
+    chunks = 0;
+    unreadable = 0;
+    chunk.index = 0;
+    source.size = 0;
+    copy.size = 0;
+}
+
+void cloneCancel()
+{
+    stage = CLONE_IDLE;
+}
+
+CloneStage cloneStage()
+{
+    return stage;
+}
+
+/**
+ * @brief Source card presented: read chunks until one must be written to the target
+ */
+static void processSource(TracedMFRC522 *rfid, EventQueue *events, Print *out)
+{
+    if (source.size == 0)
+    {
+        source = rfid->uid;
+        chunks = chunkCount(rfid->PICC_GetType(rfid->uid.sak));
+        if (target == CLONE_TO_SERIAL)
+            sendCardInfo(out, rfid->uid, chunks);
+    }
+    else if (!sameUid(rfid->uid, source))
+    {
+        events->publish(EV_CLONE_WRONG_CARD, chunk.index, CLONE_SOURCE);
+        return;
+    }
+
+    while (chunk.index < chunks)
+    {
+        if (!readChunk(rfid, &chunk))
+        {
+            events->publish(EV_CLONE_STEP, chunk.index, CLONE_SOURCE); // Card removed: resume here
+            return;
+        }
+
+        if (chunk.status != MFRC522::STATUS_OK)
+            unreadable++;
+
+        if (target == CLONE_TO_SERIAL)
+            sendChunk(out, &chunk);
+        else if (chunk.status == MFRC522::STATUS_OK)
+        {
+            stage = CLONE_TARGET;
+            events->publish(EV_CLONE_STEP, chunk.index, CLONE_TARGET);
+            return;
+        }
+
+        chunk.index++;
+    }
+
+    if (target == CLONE_TO_SERIAL)
+        sendCardEnd(out, chunks, unreadable);
+    finish(events);
+}
+
+/**
+ * @brief Target card presented: write the loaded chunk
+ */
+static void processTarget(TracedMFRC522 *rfid, EventQueue *events)
+{
+    if (sameUid(rfid->uid, source) || (copy.size > 0 && !sameUid(rfid->uid, copy)))
+    {
+        events->publish(EV_CLONE_WRONG_CARD, chunk.index, CLONE_TARGET);
+        return;
+    }
+    copy = rfid->uid;
+
+    byte block;
+    MFRC522::StatusCode status = writeChunk(rfid, &chunk, fallbackBits, &block);
+    if (status != MFRC522::STATUS_OK)
+    {
+        events->publish(EV_BLOCK_WRITE_FAILED, block, status); // Chunk kept: present the target again
+        return;
+    }
+
+    chunk.index++;
+    if (chunk.index >= chunks)
+    {
+        finish(events);
+        return;
+    }
+
+    stage = CLONE_SOURCE;
+    events->publish(EV_CLONE_STEP, chunk.index, CLONE_SOURCE);
+}
+
+void cloneProcessCard(TracedMFRC522 *rfid, EventQueue *events, Print *out)
+{
+    if (stage == CLONE_SOURCE)
+        processSource(rfid, events, out);
+    else if (stage == CLONE_TARGET)
+        processTarget(rfid, events);
+}
@@ -0,0 +1,63 @@
+/**
+ * @file clone.h
+ * @brief Streaming card clone / backup
+ * @details The source card is read one chunk (64 bytes, see sector-io.h) at a time:
+ *          - CLONE_TO_SERIAL: every chunk is streamed to the host as a FRAME_SECTOR.
+ *            The whole card is sent in one presentation.
+ *          - CLONE_TO_CARD: each chunk read from the source is written to the target
+ *            card presented next, then the source must be presented again for the
+ *            following chunk. Only one chunk is ever held in SRAM.
+ *
+ *          Progress is kept across presentations: if a card is removed too early, or
+ *          the wrong card is presented, presenting the right card again resumes from
+ *          the last completed chunk. Chunks that no KEYRING key can open are skipped
+ *          and counted.
+ * @author Dag
+ */
+
+#ifndef RFID_CLONE_H
+#define RFID_CLONE_H
+
+#include "Arduino.h"
+#include <MFRC522.h>
+#include "rf-trace.h"
+#include "events.h"
+
+enum CloneTarget : byte
+{
+    CLONE_TO_SERIAL, // Backup: stream the card to the host
+    CLONE_TO_CARD    // Duplicate: write the card to a blank target
+};
+
+enum CloneStage : byte
+{
+    CLONE_IDLE,   // No clone in progress
+    CLONE_SOURCE, // Waiting for the source card
+    CLONE_TARGET  // Chunk loaded, waiting for the target card
+};
+
+/**
+ * @brief Start a clone session
+ * @param target Destination of the card data
+ * @param defaultAccessBits Access bits written to the target when a source trailer
+ *        fails the integrity check (accessBits in data.h)
+ */
+void cloneBegin(CloneTarget target, const byte *defaultAccessBits);
+
+/** @brief Abort the clone session */
+void cloneCancel();
+
+/** @brief Current stage (CLONE_IDLE when no session is active) */
+CloneStage cloneStage();
+
+/**
+ * @brief Process the card currently selected
+ * @details Progress and failures are published as events (EV_CLONE_*, EV_AUTH_FAILED,
+ *          EV_BLOCK_WRITE_FAILED). CLONE_TO_SERIAL frames are written to `out`.
+ * @param rfid Reader, with the card selected
+ * @param events Event queue
+ * @param out Stream for CLONE_TO_SERIAL frames
+ */
+void cloneProcessCard(TracedMFRC522 *rfid, EventQueue *events, Print *out);
+
+#endif // RFID_CLONE_H
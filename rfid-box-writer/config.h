@@ -0,0 +1,174 @@
+/**
+ * @file config.h
+ * @brief Build profile selection for RFID Box
+ * @details Selects at compile time which device variant is built from this sketch.
+ *          The selected policy (see ReaderRole / WriterRole in def.h) is exposed as
+ *          the BoxRole type and drives every role-dependent branch of the firmware.
+ *
+ *          Default build: WRITER (programming station).
+ *          Reader build:  define RFID_BOX_READER, either by uncommenting the line below
+ *                         or from the command line:
+ *                         arduino-cli compile --build-property "compiler.cpp.extra_flags=-DRFID_BOX_READER" ...
+ * @author Dag
+ */
+
+#ifndef RFID_CONFIG_H
+#define RFID_CONFIG_H
+
+#include "def.h"
+
+// #define RFID_BOX_READER // Uncomment to build the reader-only (door unit) profile
+
+#ifdef RFID_BOX_READER
+typedef ReaderRole BoxRole;
+#else
+typedef WriterRole BoxRole;
+#endif
+
+/**
+ * @brief Fast boot
+ * @details true: setup() only initializes what card detection needs (reader, outputs,
+ *          passphrase, key) and returns within tens of milliseconds. The LCD splash,
+ *          the reader diagnostics and the boot log run afterwards from loop().
+ *          false: legacy blocking startup with a 2 s splash screen.
+ *          The measured boot time is printed with the "boot" serial command.
+ */
+const bool FAST_BOOT = true;
+
+/**
+ * @brief Credential format written and validated by this device
+ * @details CREDENTIAL_PASSPHRASE: the passphrase is stored in clear over 4+ blocks and
+ *          is identical on every card.
+ *          CREDENTIAL_UID_MAC: one block with a truncated MAC of the card UID, computed
+ *          with a 16-byte key derived from the passphrase of the SET-mode master card.
+ *          Validation reads a single block and a dumped card cannot clone the fleet.
+ *          CREDENTIAL_RECORDS: typed TLV fields (badge id, permissions, issue counter)
+ *          closed by a MAC of the UID and of the fields, same key as CREDENTIAL_UID_MAC.
+ *          Validation stops reading as soon as the MAC record has been checked.
+ *          Readers and writers of the same installation must use the same mode.
+ */
+const CredentialMode CREDENTIAL_MODE = CREDENTIAL_PASSPHRASE;
+
+/**
+ * @brief Permission bits a card needs to open this door (CREDENTIAL_RECORDS)
+ * @details A valid card is granted if its REC_PERMISSIONS record has at least one of
+ *          these bits. 0: every valid card is granted, permissions are not checked.
+ */
+const uint16_t DOOR_PERMISSIONS = 0;
+
+/**
+ * @brief The master passphrase is kept in clear, in EEPROM and in RAM
+ * @details Only writers in CREDENTIAL_PASSPHRASE mode need it: they write it on cards.
+ *          Every other build keeps only its 16-byte digest (deriveMacKey(), stored in
+ *          the MAC key slot), and all builds validate cards against the digest, hashing
+ *          each block as it is read. Without the clear passphrase UPGRADE_OLD_CARDS
+ *          only applies to UID-MAC credentials.
+ */
+const bool KEEP_PASSPHRASE = BoxRole::CAN_WRITE && CREDENTIAL_MODE == CREDENTIAL_PASSPHRASE;
+
+/**
+ * @brief UID allowlist enforcement
+ * @details Denylisted UIDs (uid-index.h) are always rejected right after anticollision.
+ *          true: only allowlisted UIDs may proceed to the credential check.
+ *          false: unlisted UIDs are validated by their credential as usual.
+ */
+const bool UID_ALLOWLIST_ONLY = false;
+
+/**
+ * @brief Re-key cards while writing them (writer builds)
+ * @details true: every sector is written, then its trailer is rewritten with crypto_key
+ *          and accessBits (data.h), then it is re-authenticated with the new key and read
+ *          back, all in one pass (see provisionCard()). Readers find the new key first
+ *          in KEYRING, cards still on the factory key keep working.
+ *          false: data blocks only, the sector keys are left untouched.
+ */
+const bool REKEY_ON_WRITE = true;
+
+/**
+ * @brief Read-compare-write card updates (writer builds)
+ * @details true: every target block is read first and only rewritten when its content
+ *          differs, re-issuing a card after a passphrase change only writes what changed.
+ *          The number of blocks written and skipped is printed after each card.
+ *          false: every block is written unconditionally.
+ */
+const bool INCREMENTAL_WRITE = true;
+
+/**
+ * @brief Re-issue accepted cards written with a retired secret (secret-ring.h)
+ * @details true: a card accepted with a previous secret version, or without version
+ *          tag, is rewritten with the current secret before the door opens, while the
+ *          badge is still held. Only the blocks that change are written.
+ *          UID-MAC reader builds then also link the card write path; passphrase
+ *          cards are only re-issued by writers (KEEP_PASSPHRASE).
+ *          false: old cards keep working until their version leaves the ring.
+ */
+const bool UPGRADE_OLD_CARDS = true;
+
+/**
+ * @brief Record the RF commands of every card exchange (rf-trace.h)
+ * @details true: command, status and duration of the last 32 reader commands are kept
+ *          in RAM (192 bytes) and exported with the "trace" serial command.
+ *          false: nothing is recorded and the ring is not linked.
+ */
+const bool RF_TRACE = false;
+
+/**
+ * @brief Count watchdog resets in the lifetime counters (counters.h)
+ * @details true: a boot with WDRF set in MCUSR increments "Watchdog recoveries". Only
+ *          for boards flashed over ISP without a bootloader: Optiboot (Uno) clears MCUSR
+ *          before the sketch starts, and leaves through a watchdog reset of its own.
+ *          false: the counter is not kept and "stats" does not print it; FRAME_COUNTERS
+ *          still carries it, always 0.
+ */
+const bool COUNT_WATCHDOG_RESETS = false;
+
+/**
+ * @brief Sleep between card polls when idle (power.h)
+ * @details true: with no card in the field, no button held and no serial traffic the
+ *          MCU is put in power-down until the next watchdog tick, a button press, a
+ *          byte from the host or the reader IRQ. The card is polled after each tick.
+ *          false: loop() polls at full speed (mains powered installs).
+ */
+const bool LOW_POWER_IDLE = false;
+
+/**
+ * @brief Longest time from a card entering the field to its detection, in ms
+ * @details Sets the sleep tick: the longest watchdog period (16 ms to 1 s) that, plus
+ *          an empty-field poll (25 ms), stays within this bound. Below 41 ms the box
+ *          never sleeps.
+ */
+const unsigned long IDLE_WAKE_LATENCY_MS = 200;
+
+/**
+ * @brief Supply current of the box awake and asleep, in microamps
+ * @details Only used to estimate the average current in "stats". Defaults for an Uno R3
+ *          with MFRC522 and LCD backlight (USB chip, regulator and LEDs do not sleep):
+ *          replace them with values measured on the installed hardware.
+ */
+const unsigned long AWAKE_CURRENT_UA = 62000;
+const unsigned long ASLEEP_CURRENT_UA = 44000;
+
+/**
+ * @brief Validity window of the grant cache, in milliseconds (grant-cache.h)
+ * @details A UID validated less than this long ago is granted right after
+ *          anticollision, without authenticating or reading blocks.
+ *          0 disables the cache: every tap is fully validated.
+ */
+const unsigned long GRANT_CACHE_TTL_MS = 10000;
+
+/**
+ * @brief Sector holding the entry counter of usage-limited badges (usage-counter.h)
+ * @details 5..15: a badge loaded with the "uses" command (writer builds) carries its
+ *          remaining entries in a MIFARE value block of this sector, and readers take
+ *          one entry at each granted tap (Decrement + Transfer, card still held).
+ *          The sector never carries credential data: sectors 1-4 may hold the longest
+ *          passphrase and its closing empty block. Every valid MIFARE Classic tap
+ *          costs one more sector authentication and block read; limited badges are
+ *          never granted from the grant cache.
+ *          0: no limited badges, the sector is not read.
+ */
+const byte USAGE_SECTOR = 0;
+static_assert(USAGE_SECTOR == 0 || (USAGE_SECTOR >= 5 && USAGE_SECTOR <= 15),
+              "USAGE_SECTOR must be 0 or 5..15: sectors 1-4 carry the passphrase");
+
+#endif // RFID_CONFIG_H
@@ -0,0 +1,43 @@
+/**
+ * @file console.cpp
+ * @brief Implementation of the framed command console
+ * @author Dag
+ */
+
+#include "console.h"
+
+bool consoleNext(const byte *payload, byte length, byte *pos, ConsoleCommand *cmd)
+{
+    if (*pos >= length)
+        return false;
+
+    cmd->op = payload[*pos];
+    if (length - *pos < 2 || payload[*pos + 1] > length - *pos - 2)
+    {
+        cmd->length = 0;
+        cmd->args = NULL;
+        *pos = length; // Nothing after a truncated command can be trusted
+        return true;
+    }
+
+    cmd->length = payload[*pos + 1];
+    cmd->args = payload + *pos + 2;
+    *pos += 2 + cmd->length;
+    return true;
+}
+
+void consoleReplyBegin(FrameWriter *frame, byte seq, byte index, byte op, ConsoleStatus status, byte dataLength)
+{
+    frame->begin(FRAME_CONSOLE_REPLY, 4 + dataLength);
+    frame->write(seq);
+    frame->write(index);
+    frame->write(op);
+    frame->write(status);
+}
+
+void consoleReply(Print *out, byte seq, byte index, byte op, ConsoleStatus status)
+{
+    FrameWriter frame(out);
+    consoleReplyBegin(&frame, seq, index, op, status, 0);
+    frame.end();
+}
@@ -0,0 +1,104 @@
+/**
+ * @file console.h
+ * @brief Framed command console for host tools (rfid-host-util/box-console)
+ * @details The text commands of the Serial Monitor are meant for a person; host tools
+ *          send FRAME_CONSOLE instead. One frame carries a batch of commands, each
+ *          answered by its own FRAME_CONSOLE_REPLY, in order. A tool can keep several
+ *          batches in flight and match the replies by sequence number and index,
+ *          instead of one round trip per command.
+ *
+ *          Frames are decoded byte by byte in loop() (FrameReader), like the job
+ *          frames: reception never blocks and a batch runs as soon as its CRC checks.
+ *          Commands that export frames (log, trace) send them before their reply.
+ *
+ * Payloads (little endian):
+ * -----------------------------------------------------------------
+ * FRAME_CONSOLE        seq (1) | commands: op (1) | length (1) | arguments (length) ...
+ * FRAME_CONSOLE_REPLY  seq (1) | index (1) | op (1) | ConsoleStatus (1) | data (rest)
+ * -----------------------------------------------------------------
+ *
+ * Commands (arguments -> reply data):
+ * CMD_STATUS       -                          agent | mode | job | job armed | job id (2)
+ * CMD_STATS        -                          boot us (4) | stack peak (2) | free heap (2) |
+ *                                             UIDs (2) | audit records (1) | counters (4 each)
+ * CMD_MODE         mode | job                 mode | job
+ * CMD_UID_PUT      UidStatus | UID            -
+ * CMD_UID_REMOVE   UID                        -
+ * CMD_UID_LOOKUP   UID                        UidStatus
+ * CMD_LOG          -                          - (FRAME_AUDIT_LOG before the reply)
+ * CMD_TRACE        [1: clear after export]    - (FRAME_TRACE before the reply)
+ * CMD_DUMP         -                          - (next card streamed, sector-io.h)
+ * CMD_JOB          FRAME_JOB payload          JobAck (FRAME_JOB_RESULT after the card)
+ * CMD_JOB_CANCEL   job id (2)                 -
+ * -----------------------------------------------------------------
+ * A batch is limited by the receive buffer of the sketch (cmdLine, 80 bytes).
+ * @author Dag
+ */
+
+#ifndef RFID_CONSOLE_H
+#define RFID_CONSOLE_H
+
+#include "Arduino.h"
+#include "frame.h"
+
+/**
+ * @brief Console commands
+ */
+enum ConsoleOp : byte
+{
+    CMD_STATUS = 0x01,
+    CMD_STATS = 0x02,
+    CMD_MODE = 0x03,
+    CMD_UID_PUT = 0x10,
+    CMD_UID_REMOVE = 0x11,
+    CMD_UID_LOOKUP = 0x12,
+    CMD_LOG = 0x20,
+    CMD_TRACE = 0x21,
+    CMD_DUMP = 0x22,
+    CMD_JOB = 0x30,
+    CMD_JOB_CANCEL = 0x31
+};
+
+/**
+ * @brief Outcome of a console command
+ */
+enum ConsoleStatus : byte
+{
+    CONSOLE_OK = 0,
+    CONSOLE_UNKNOWN = 1,     // Unknown op
+    CONSOLE_BAD_ARGS = 2,    // Wrong argument length or value
+    CONSOLE_UNSUPPORTED = 3, // Not available on this build (role, RF_TRACE, ...)
+    CONSOLE_FAILED = 4,      // Valid but not done (UID index full, UID not listed, ...)
+    CONSOLE_MALFORMED = 5    // Batch truncated inside this command: the batch ends here
+};
+
+/**
+ * @brief One command of a batch, arguments in place in the frame payload
+ */
+struct ConsoleCommand
+{
+    byte op;          // ConsoleOp
+    byte length;      // Argument bytes
+    const byte *args; // Points into the payload, NULL if the command is truncated
+};
+
+/**
+ * @brief Next command of a FRAME_CONSOLE payload
+ * @param payload Frame payload
+ * @param length Payload length
+ * @param pos Walk position, start at 1 (after the sequence number)
+ * @param cmd Destination of the command
+ * @return false at the end of the batch. A truncated command is returned once with
+ *         args NULL, then the walk ends.
+ */
+bool consoleNext(const byte *payload, byte length, byte *pos, ConsoleCommand *cmd);
+
+/**
+ * @brief Start a FRAME_CONSOLE_REPLY, the caller writes dataLength bytes and ends it
+ */
+void consoleReplyBegin(FrameWriter *frame, byte seq, byte index, byte op, ConsoleStatus status, byte dataLength);
+
+/** @brief Send a FRAME_CONSOLE_REPLY without data */
+void consoleReply(Print *out, byte seq, byte index, byte op, ConsoleStatus status);
+
+#endif // RFID_CONSOLE_H
@@ -0,0 +1,205 @@
+/**
+ * @file counters.cpp
+ * @brief Implementation of the persistent counters
+ * @author Dag
+ */
+
+#include "counters.h"
+#include "config.h"
+#include "def.h"
+#include "frame.h"
+
+#ifdef __AVR__
+#include <avr/eeprom.h>
+#include <avr/io.h>
+#endif
+
+static const byte SLOTS = EEPROM_COUNTERS_SIZE / COUNTER_SLOT_SIZE;
+static const byte STEP_DONE = COUNTER_SLOT_SIZE;
+
+static uint32_t counters[COUNTER_COUNT];
+static byte unflushed = 0;           // Increments since the last flush started
+static unsigned long firstUnflushedMs = 0;
+static uint16_t nextSeq = 0;         // Sequence number of the next flush
+static byte nextSlot = 0;            // Slot of the next flush
+static byte pending[COUNTER_SLOT_SIZE]; // Flush being written
+static byte pendingSlot = 0;
+static byte pendingStep = STEP_DONE;
+
+#ifdef __AVR__
+/**
+ * @brief Reset cause, saved before the C runtime starts
+ * @details MCUSR is cleared here in any case: a WDRF left set keeps the watchdog
+ *          armed. The cause is only trusted with COUNT_WATCHDOG_RESETS (config.h).
+ */
+static byte resetCause __attribute__((section(".noinit")));
+
+void saveResetCause() __attribute__((naked, used, section(".init3")));
+void saveResetCause()
+{
+    resetCause = MCUSR;
+    MCUSR = 0;
+}
+#endif
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+static int slotAddr(byte slot)
+{
+    return EEPROM_COUNTERS_ADDR + slot * COUNTER_SLOT_SIZE;
+}
+
+/** @brief A slot holds a complete flush */
+static bool slotValid(byte slot)
+{
+    int addr = slotAddr(slot);
+    uint16_t crc = 0xFFFF;
+    for (byte i = 0; i < COUNTER_SLOT_SIZE - 2; i++)
+        crc = crc16Update(crc, EEPROM.read(addr + i));
+
+    return crc == (EEPROM.read(addr + COUNTER_SLOT_SIZE - 2) | (EEPROM.read(addr + COUNTER_SLOT_SIZE - 1) << 8));
+}
+
+static uint16_t slotSeq(byte slot)
+{
+    int addr = slotAddr(slot);
+    return EEPROM.read(addr) | (EEPROM.read(addr + 1) << 8);
+}
+
+static bool eepromReady()
+{
+#ifdef __AVR__
+    return eeprom_is_ready();
+#else
+    return true;
+#endif
+}
+
+/** @brief Snapshot the counters into the pending buffer */
+static void startFlush()
+{
+    pending[0] = nextSeq & 0xFF;
+    pending[1] = nextSeq >> 8;
+    for (byte c = 0; c < COUNTER_COUNT; c++)
+        for (byte i = 0; i < 4; i++)
+            pending[2 + c * 4 + i] = (counters[c] >> (8 * i)) & 0xFF;
+
+    uint16_t crc = 0xFFFF;
+    for (byte i = 0; i < COUNTER_SLOT_SIZE - 2; i++)
+        crc = crc16Update(crc, pending[i]);
+    pending[COUNTER_SLOT_SIZE - 2] = crc & 0xFF;
+    pending[COUNTER_SLOT_SIZE - 1] = crc >> 8;
+
+    pendingSlot = nextSlot;
+    pendingStep = 0;
+    nextSlot = (nextSlot + 1) % SLOTS;
+    nextSeq++;
+    unflushed = 0;
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+
+void countersInit()
+{
+    bool found = false;
+    uint16_t headSeq = 0;
+    byte headSlot = 0;
+
+    for (byte slot = 0; slot < SLOTS; slot++)
+    {
+        if (!slotValid(slot))
+            continue;
+
+        uint16_t seq = slotSeq(slot);
+        if (!found || (int16_t)(seq - headSeq) > 0) // Wrap-aware
+        {
+            found = true;
+            headSeq = seq;
+            headSlot = slot;
+        }
+    }
+
+    if (found)
+    {
+        int addr = slotAddr(headSlot) + 2;
+        for (byte c = 0; c < COUNTER_COUNT; c++)
+            for (byte i = 0; i < 4; i++)
+                counters[c] |= (uint32_t)EEPROM.read(addr + c * 4 + i) << (8 * i);
+
+        nextSeq = headSeq + 1;
+        nextSlot = (headSlot + 1) % SLOTS;
+    }
+
+#ifdef __AVR__
+    if (COUNT_WATCHDOG_RESETS && (resetCause & _BV(WDRF)))
+    {
+        counterIncrement(CNT_WATCHDOG_RECOVERIES);
+        startFlush(); // Rare and worth keeping even if power fails soon
+    }
+#endif
+}
+
+void counterIncrement(Counter counter)
+{
+    counters[counter]++;
+    if (unflushed++ == 0)
+        firstUnflushedMs = millis();
+}
+
+uint32_t counterValue(Counter counter)
+{
+    return counters[counter];
+}
+
+void counterService()
+{
+    if (pendingStep < STEP_DONE)
+    {
+        if (eepromReady())
+        {
+            EEPROM.update(slotAddr(pendingSlot) + pendingStep, pending[pendingStep]);
+            pendingStep++;
+        }
+        return;
+    }
+
+    if (unflushed >= COUNTER_FLUSH_EVENTS || (unflushed && millis() - firstUnflushedMs >= COUNTER_FLUSH_MS))
+        startFlush();
+}
+
+bool counterFlushPending()
+{
+    return pendingStep < STEP_DONE;
+}
+
+void printCounters()
+{
+    static const char names[] PROGMEM =
+        "Taps\0Grants\0Rejects\0Auth failures\0Read errors\0Write successes\0Watchdog recoveries\0";
+
+    const char *name = names;
+    for (byte c = 0; c < COUNTER_COUNT; c++)
+    {
+        if (c != CNT_WATCHDOG_RECOVERIES || COUNT_WATCHDOG_RESETS)
+        {
+            Serial.print((const __FlashStringHelper *)name);
+            Serial.print(F(": "));
+            Serial.println(counters[c]);
+        }
+        name += strlen_P(name) + 1;
+    }
+}
+
+void countersExport(Print *out)
+{
+    FrameWriter frame(out);
+    frame.begin(FRAME_COUNTERS, COUNTER_COUNT * 4);
+    for (byte c = 0; c < COUNTER_COUNT; c++)
+        for (byte i = 0; i < 4; i++)
+            frame.write((counters[c] >> (8 * i)) & 0xFF);
+    frame.end();
+}
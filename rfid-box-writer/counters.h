@@ -0,0 +1,83 @@
+/**
+ * @file counters.h
+ * @brief Lifetime operational counters persisted in EEPROM
+ * @details Counters are incremented in RAM and flushed to EEPROM in batches: after
+ *          COUNTER_FLUSH_EVENTS increments, or COUNTER_FLUSH_MS after the first
+ *          unflushed one. A power cut loses at most one batch.
+ *
+ * Slot layout (COUNTER_SLOT_SIZE = 32 bytes, little endian, 2 slots):
+ * -----------------------------------------------------------------
+ * Byte 0-1   Sequence number
+ * Byte 2-29  COUNTER_COUNT counters, 4 bytes each
+ * Byte 30-31 CRC-16/CCITT-FALSE of bytes 0-29
+ * -----------------------------------------------------------------
+ *
+ * Wear spreading: flushes alternate between the two slots and EEPROM.update()
+ * only rewrites the cells that changed, mostly the low byte of a few counters.
+ * Power safety: at boot the valid slot with the highest sequence wins. A flush
+ * torn by a power cut fails its CRC and the previous flush, in the other slot,
+ * is used instead.
+ *
+ * Flushes are written in background by counterService(), one byte per loop
+ * iteration whenever the EEPROM is idle, like the audit log.
+ * @author Dag
+ */
+
+#ifndef RFID_COUNTERS_H
+#define RFID_COUNTERS_H
+
+#include "Arduino.h"
+
+/**
+ * @brief Counter identifiers
+ * @details The order is the export order: append new counters at the end.
+ */
+enum Counter : byte
+{
+    CNT_TAPS,                // Cards selected
+    CNT_GRANTS,              // Access granted
+    CNT_REJECTS,             // Invalid credential or denylisted UID
+    CNT_AUTH_FAILURES,       // Sector authentication failed
+    CNT_READ_ERRORS,         // Block read failed
+    CNT_WRITE_SUCCESSES,     // Cards written
+    CNT_WATCHDOG_RECOVERIES, // Boots caused by a watchdog reset (COUNT_WATCHDOG_RESETS only)
+    COUNTER_COUNT
+};
+
+const byte COUNTER_SLOT_SIZE = 32;
+const byte COUNTER_FLUSH_EVENTS = 32;            // Increments that trigger a flush
+const unsigned long COUNTER_FLUSH_MS = 900000UL; // Longest delay of an increment (15 min)
+
+/**
+ * @brief Load the counters from the newest valid slot
+ * @details Called once at boot. With COUNT_WATCHDOG_RESETS (config.h) also counts a
+ *          watchdog recovery if the MCU was reset by the watchdog.
+ */
+void countersInit();
+
+/** @brief Increment a counter in RAM */
+void counterIncrement(Counter counter);
+
+/** @brief Lifetime value of a counter, including unflushed increments */
+uint32_t counterValue(Counter counter);
+
+/**
+ * @brief Start a due flush and write it, one EEPROM cell per call
+ * @details Non-blocking: returns immediately while the EEPROM is busy. Call from loop().
+ */
+void counterService();
+
+/** @brief A flush is half written: counterService() still has work to do */
+bool counterFlushPending();
+
+/** @brief Print every counter on serial */
+void printCounters();
+
+/**
+ * @brief Send the counters as one FRAME_COUNTERS frame
+ * @details Payload: COUNTER_COUNT values, 4 bytes each (LE), in Counter order.
+ * @param out Destination stream
+ */
+void countersExport(Print *out);
+
+#endif // RFID_COUNTERS_H
@@ -0,0 +1,221 @@
+/**
+ * @file credential.cpp
+ * @brief Implementation of the UID-bound MAC credential
+ * @author Dag
+ */
+
+#include "credential.h"
+#include "def.h"
+
+// Magic bytes identifying a UID-MAC credential block
+static const byte UID_MAC_MAGIC[2] = {'U', 'M'};
+
+// Marker written after the key: tells a programmed slot from erased EEPROM (0xFF)
+static const byte MAC_KEY_MARKER = 0xA5;
+
+// Domain separation keys for deriveMacKey() (not secret)
+static const byte KDF_KEY[MAC_KEY_SIZE] = {'R', 'F', 'I', 'D', '-', 'B', 'O', 'X', '-', 'M', 'A', 'C', '-', 'K', 'D', 'F'};
+
+// ============================================================================
+// SIPHASH-2-4
+// ============================================================================
+
+#define SIP_ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+static uint64_t loadLE64(const byte *p)
+{
+    uint64_t v = 0;
+    for (int8_t i = 7; i >= 0; i--)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+static void sipRound(uint64_t *v)
+{
+    v[0] += v[1];
+    v[1] = SIP_ROTL(v[1], 13);
+    v[1] ^= v[0];
+    v[0] = SIP_ROTL(v[0], 32);
+    v[2] += v[3];
+    v[3] = SIP_ROTL(v[3], 16);
+    v[3] ^= v[2];
+    v[0] += v[3];
+    v[3] = SIP_ROTL(v[3], 21);
+    v[3] ^= v[0];
+    v[2] += v[1];
+    v[1] = SIP_ROTL(v[1], 17);
+    v[1] ^= v[2];
+    v[2] = SIP_ROTL(v[2], 32);
+}
+
+/** @brief Absorb one 8-byte message word */
+static void sipCompress(uint64_t *v, uint64_t m)
+{
+    v[3] ^= m;
+    sipRound(v);
+    sipRound(v);
+    v[0] ^= m;
+}
+
+void siphashBegin(SipHash *h, const byte *key)
+{
+    uint64_t k0 = loadLE64(key);
+    uint64_t k1 = loadLE64(key + 8);
+    h->v[0] = k0 ^ 0x736f6d6570736575ULL;
+    h->v[1] = k1 ^ 0x646f72616e646f6dULL;
+    h->v[2] = k0 ^ 0x6c7967656e657261ULL;
+    h->v[3] = k1 ^ 0x7465646279746573ULL;
+    h->length = 0;
+}
+
+void siphashUpdate(SipHash *h, const byte *data, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+    {
+        byte used = h->length % 8;
+        h->tail[used] = data[i];
+        h->length++;
+
+        // Full 8-byte word
+        if (used == 7)
+            sipCompress(h->v, loadLE64(h->tail));
+    }
+}
+
+void siphashEnd(SipHash *h, byte *out)
+{
+    // Last partial word, with the message length in the top byte
+    uint64_t b = ((uint64_t)h->length) << 56;
+    for (byte i = 0; i < h->length % 8; i++)
+        b |= ((uint64_t)h->tail[i]) << (8 * i);
+    sipCompress(h->v, b);
+
+    // Finalization
+    h->v[2] ^= 0xff;
+    for (byte i = 0; i < 4; i++)
+        sipRound(h->v);
+
+    uint64_t r = h->v[0] ^ h->v[1] ^ h->v[2] ^ h->v[3];
+    for (byte i = 0; i < 8; i++)
+        out[i] = (byte)(r >> (8 * i));
+}
+
+void siphash24(const byte *key, const byte *data, uint16_t len, byte *out)
+{
+    SipHash h;
+    siphashBegin(&h, key);
+    siphashUpdate(&h, data, len);
+    siphashEnd(&h, out);
+}
+
+// ============================================================================
+// KEY DERIVATION AND CREDENTIAL BLOCK
+// ============================================================================
+
+void secretDigestBegin(SecretDigest *d)
+{
+    byte kdfKey[MAC_KEY_SIZE];
+    memcpy(kdfKey, KDF_KEY, MAC_KEY_SIZE);
+
+    siphashBegin(&d->low, kdfKey);
+    kdfKey[MAC_KEY_SIZE - 1] ^= 0x01; // Second half: different domain key
+    siphashBegin(&d->high, kdfKey);
+}
+
+void secretDigestUpdate(SecretDigest *d, const byte *data, uint16_t len)
+{
+    siphashUpdate(&d->low, data, len);
+    siphashUpdate(&d->high, data, len);
+}
+
+void secretDigestEnd(SecretDigest *d, byte *macKey)
+{
+    siphashEnd(&d->low, macKey);
+    siphashEnd(&d->high, macKey + 8);
+}
+
+void deriveMacKey(const String &passphrase, byte *macKey)
+{
+    SecretDigest d;
+    secretDigestBegin(&d);
+    secretDigestUpdate(&d, (const byte *)passphrase.c_str(), passphrase.length());
+    secretDigestEnd(&d, macKey);
+}
+
+/** @brief MAC over header and UID, as stored in bytes 4-11 of the block */
+static void computeUidMac(const byte *macKey, const MFRC522::Uid &uid, byte *mac)
+{
+    byte message[4 + 10];
+    message[0] = UID_MAC_MAGIC[0];
+    message[1] = UID_MAC_MAGIC[1];
+    message[2] = UID_MAC_VERSION;
+    message[3] = uid.size;
+    memcpy(message + 4, uid.uidByte, uid.size);
+
+    siphash24(macKey, message, 4 + uid.size, mac);
+}
+
+void buildUidMacBlock(const byte *macKey, const MFRC522::Uid &uid, byte *block)
+{
+    memset(block, 0x00, 16);
+    block[0] = UID_MAC_MAGIC[0];
+    block[1] = UID_MAC_MAGIC[1];
+    block[2] = UID_MAC_VERSION;
+    block[3] = uid.size;
+    computeUidMac(macKey, uid, block + 4);
+}
+
+bool verifyUidMacBlock(const byte *macKey, const MFRC522::Uid &uid, const byte *block)
+{
+    if (block[0] != UID_MAC_MAGIC[0] || block[1] != UID_MAC_MAGIC[1] ||
+        block[2] != UID_MAC_VERSION || block[3] != uid.size)
+        return false;
+
+    byte mac[8];
+    computeUidMac(macKey, uid, mac);
+
+    // Constant-time comparison: timing does not reveal the matching prefix
+    byte diff = 0;
+    for (byte i = 0; i < UID_MAC_SIZE; i++)
+        diff |= mac[i] ^ block[4 + i];
+
+    return diff == 0;
+}
+
+// ============================================================================
+// EEPROM KEY STORAGE
+// ============================================================================
+
+bool saveMacKeyToEEPROM(const byte *macKey)
+{
+    // Marker cleared while the key changes: a power loss in between leaves no key
+    // rather than a mix of two (the same key is rewritten for free at every boot)
+    for (byte i = 0; i < MAC_KEY_SIZE; i++)
+        if (EEPROM.read(EEPROM_MAC_KEY_ADDR + i) != macKey[i])
+        {
+            EEPROM.update(EEPROM_MAC_KEY_ADDR + MAC_KEY_SIZE, 0xFF);
+            break;
+        }
+
+    for (byte i = 0; i < MAC_KEY_SIZE; i++)
+        EEPROM.update(EEPROM_MAC_KEY_ADDR + i, macKey[i]);
+    EEPROM.update(EEPROM_MAC_KEY_ADDR + MAC_KEY_SIZE, MAC_KEY_MARKER);
+
+    // Read back to detect worn cells
+    for (byte i = 0; i < MAC_KEY_SIZE; i++)
+        if (EEPROM.read(EEPROM_MAC_KEY_ADDR + i) != macKey[i])
+            return false;
+
+    return EEPROM.read(EEPROM_MAC_KEY_ADDR + MAC_KEY_SIZE) == MAC_KEY_MARKER;
+}
+
+bool loadMacKeyFromEEPROM(byte *macKey)
+{
+    if (EEPROM.read(EEPROM_MAC_KEY_ADDR + MAC_KEY_SIZE) != MAC_KEY_MARKER)
+        return false;
+
+    for (byte i = 0; i < MAC_KEY_SIZE; i++)
+        macKey[i] = EEPROM.read(EEPROM_MAC_KEY_ADDR + i);
+
+    return true;
+}
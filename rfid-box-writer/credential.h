@@ -0,0 +1,143 @@
+/**
+ * @file credential.h
+ * @brief Compact UID-bound MAC credential (CREDENTIAL_UID_MAC mode)
+ * @details Instead of the fleet-wide passphrase, a card carries a single block holding
+ *          a truncated SipHash-2-4 MAC of its own UID, computed with a 16-byte device key.
+ *          A dumped card cannot be replayed on a card with a different UID, and the
+ *          reader validates with one block read instead of the whole passphrase.
+ *
+ * Credential block layout (16 bytes, first data block of the card):
+ * -----------------------------------------------------------------
+ * Byte   0-1   Magic 'U' 'M'
+ * Byte   2     Format version (UID_MAC_VERSION)
+ * Byte   3     UID size (4, 7 or 10)
+ * Byte   4-11  MAC = SipHash-2-4(key, magic | version | size | UID)
+ * Byte  12    Secret version (secret-ring.h), 0 = unversioned
+ * Byte  13-15  0x00
+ * -----------------------------------------------------------------
+ *
+ * The device key is derived from the passphrase (deriveMacKey) when a master card is
+ * read in SET mode, and only the key is kept in EEPROM. In CREDENTIAL_PASSPHRASE mode
+ * the same derived key is the digest cards are validated against (KEEP_PASSPHRASE).
+ * @author Dag
+ */
+
+#ifndef RFID_CREDENTIAL_H
+#define RFID_CREDENTIAL_H
+
+#include "Arduino.h"
+#include <MFRC522.h>
+
+// ============================================================================
+// CREDENTIAL CONSTANTS
+// ============================================================================
+
+const byte MAC_KEY_SIZE = 16;   // SipHash-2-4 key size
+const byte UID_MAC_SIZE = 8;    // MAC bytes stored on the card
+const byte UID_MAC_VERSION = 1; // Credential block format version
+const byte UID_MAC_SECRET_VERSION = 12; // Offset of the secret version (not covered by the MAC)
+
+/**
+ * @brief deriveMacKey() of the demo passphrase published with the sources
+ * @details A factory secret (secrets.h) equal to it is never adopted: anyone can
+ *          write cards with it.
+ */
+const byte DEMO_DIGEST[MAC_KEY_SIZE] PROGMEM = {0x8D, 0xE5, 0x50, 0xB9, 0x21, 0x5D, 0x02, 0xAE,
+                                                0xE4, 0x89, 0x93, 0x74, 0x88, 0xDE, 0xF0, 0xDE};
+
+/**
+ * @brief Incremental SipHash-2-4 state
+ */
+struct SipHash
+{
+    uint64_t v[4];   // Internal state
+    byte tail[8];    // Bytes of the incomplete message word
+    uint16_t length; // Message length so far
+};
+
+/**
+ * @brief Incremental deriveMacKey(): two SipHash-2-4 states fed with the same bytes
+ */
+struct SecretDigest
+{
+    SipHash low;  // Key bytes 0-7
+    SipHash high; // Key bytes 8-15
+};
+
+// ============================================================================
+// FUNCTION DECLARATIONS
+// ============================================================================
+
+/**
+ * @brief SipHash-2-4 keyed hash
+ * @param key 16-byte key
+ * @param data Message to authenticate
+ * @param len Message length in bytes
+ * @param out 8-byte output (little endian)
+ */
+void siphash24(const byte *key, const byte *data, uint16_t len, byte *out);
+
+/** @brief Start an incremental SipHash-2-4 with a 16-byte key */
+void siphashBegin(SipHash *h, const byte *key);
+
+/** @brief Append message bytes */
+void siphashUpdate(SipHash *h, const byte *data, uint16_t len);
+
+/** @brief Finish the hash: 8-byte output (little endian) */
+void siphashEnd(SipHash *h, byte *out);
+
+/**
+ * @brief Derive the 16-byte device MAC key from the passphrase
+ * @details Two SipHash-2-4 runs over the passphrase with domain-separated constant keys.
+ *          Every device sharing the passphrase derives the same key.
+ * @param passphrase Master passphrase
+ * @param macKey Destination buffer (MAC_KEY_SIZE bytes)
+ */
+void deriveMacKey(const String &passphrase, byte *macKey);
+
+/**
+ * @brief Incremental deriveMacKey()
+ * @details The passphrase is fed in pieces as it is read from the card, so the
+ *          reader never holds it in clear: deriveMacKey(p) == Begin, Update(p), End.
+ */
+void secretDigestBegin(SecretDigest *d);
+void secretDigestUpdate(SecretDigest *d, const byte *data, uint16_t len);
+void secretDigestEnd(SecretDigest *d, byte *macKey);
+
+/**
+ * @brief Build the credential block for a card
+ * @param macKey Device key (MAC_KEY_SIZE bytes)
+ * @param uid Card UID
+ * @param block Destination buffer (16 bytes)
+ */
+void buildUidMacBlock(const byte *macKey, const MFRC522::Uid &uid, byte *block);
+
+/**
+ * @brief Verify a credential block read from a card
+ * @details Checks magic, version and UID size, then recomputes the MAC and compares
+ *          it in constant time.
+ * @param macKey Device key (MAC_KEY_SIZE bytes)
+ * @param uid UID of the card the block was read from
+ * @param block Block content (16 bytes)
+ * @return true if the credential is valid for this UID
+ */
+bool verifyUidMacBlock(const byte *macKey, const MFRC522::Uid &uid, const byte *block);
+
+/**
+ * @brief Store the device MAC key in EEPROM (EEPROM_MAC_KEY_ADDR)
+ * @details The marker is cleared while a different key is written: interrupted,
+ *          the slot reads as never written (loadMacKeyFromEEPROM() false).
+ * @param macKey Key to store (MAC_KEY_SIZE bytes)
+ * @return true if the key was written and verified
+ */
+bool saveMacKeyToEEPROM(const byte *macKey);
+
+/**
+ * @brief Load the device MAC key from EEPROM
+ * @param macKey Destination buffer (MAC_KEY_SIZE bytes)
+ * @return true if a valid key was found, false if the slot was never written or
+ *         its last write was interrupted
+ */
+bool loadMacKeyFromEEPROM(byte *macKey);
+
+#endif // RFID_CREDENTIAL_H
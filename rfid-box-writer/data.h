@@ -2,17 +2,18 @@
 #define RFID_DATA_H
 
 #include <MFRC522.h>
+#include "secrets.h" // Generated build secrets (secrets-generator-util)
 
 /************************************************/
 /*** INSERIRE QUI I DATI DA SCRIVERE */
 /************************************************/
 
-// Firmware version for display and serial output
-const String VERSION = "v1.0.0";
+// Firmware version for display and serial output (flash, print it as const __FlashStringHelper *)
+const char VERSION[] PROGMEM = "v1.0.0";
 
-// main passphrase (max 135 characters)
-const String mainPassphrase = "SuperMegaS3cretP4ssphraseToKeepHidden4EverLockedUpInAS4f3Place00";
-// CHANGE THIS PASSHPRASE TO YOUR OWN CUSTOM PASSPHRASE FOR BETTER SECURITY!
+// Passphrase, MIFARE keys, NTAG password and build id are generated in secrets.h:
+//   secrets-generator-util --header rfid-box-writer/secrets.h
+// DO NOT SHIP THE DEMO SECRETS.H: GENERATE YOUR OWN FOR BETTER SECURITY!
 
 // ============================================================================
 // MIFARE CLASSIC BLOCKS TO USE
@@ -38,24 +39,16 @@ const String mainPassphrase = "SuperMegaS3cretP4ssphraseToKeepHidden4EverLockedU
  *
  * Considerazioni Chiave:
  * - La chiave predefinita (0xFFFFFFFFFFFF) è una chiave ben nota e non sicura e dovrebbe essere modificata per qualsiasi applicazione reale.
- * - La `crypto_key` in questo codice rappresenta una chiave personalizzata che dovrebbe essere utilizzata per una maggiore sicurezza.
+ * - La `crypto_key` generata in secrets.h rappresenta una chiave personalizzata che dovrebbe essere utilizzata per una maggiore sicurezza.
  * - La corretta gestione e protezione di queste chiavi sono fondamentali per mantenere la sicurezza del sistema MIFARE Classic.
  *
  * Nota: L'interpretazione specifica dei bit di accesso può essere complessa e dipende dalla versione della card MIFARE Classic. Fare riferimento al datasheet MIFARE Classic per informazioni dettagliate.
  */
 
 // ============================================================================
-// CRYPTOGRAPHIC KEYS DECLARATIONS
+// ACCESS BITS (the keys are in secrets.h)
 // ============================================================================
 
-/**
- * @brief MIFARE Classic Authentication Key (Constant Declaration)
- * @details External declaration of factory default 6-byte key for MIFARE Classic card authentication.
- *          This key is used for initial access to cards before any custom keys are set.
- *          Factory default key is widely known (FFFFFFFFFFFF) and should be changed for security.
- */
-const byte default_key[MFRC522::MF_KEY_SIZE] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-
 /**
  * @brief Standard access bits for data blocks with custom key protection
  * @details External declaration of access bits for MIFARE Classic card data blocks.
@@ -63,15 +56,6 @@ const byte default_key[MFRC522::MF_KEY_SIZE] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x
  */
 const byte accessBits[4] = {0xFF, 0x07, 0x80, 0x69}; // default values for data blocks with custom key protection
 
-/**
- * @brief MIFARE Classic Authentication Key (Constant Declaration)
- * @details External declaration of custom 6-byte key for MIFARE Classic card authentication.
- *          Alternative to factory default key (FFFFFFFFFFFF).
- *          Used for enhanced security when reading/writing card data.
- *          This key must match the one programmed on the cards using the key-changer utility.
- */
-const byte crypto_key[MFRC522::MF_KEY_SIZE] = {0x01, 0x02, 0x13, 0x51, 0x09, 0x0F};
-// CHANGE THIS KEY TO YOUR OWN CUSTOM KEY FOR BETTER SECURITY!
 /************************************************/
 
 #endif
@@ -121,6 +121,43 @@ void dump_byte_array(byte *buffer, byte bufferSize)
     }
 }
 
+/** @brief Value of a hex digit, -1 if not a hex digit */
+static int8_t hexDigit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+byte parseHexBytes(const char *str, byte *buffer, byte maxSize)
+{
+    byte count = 0;
+
+    while (*str)
+    {
+        // Skip separators between bytes
+        if (*str == ' ' || *str == ':')
+        {
+            str++;
+            continue;
+        }
+
+        int8_t hi = hexDigit(str[0]);
+        int8_t lo = hi < 0 ? -1 : hexDigit(str[1]);
+        if (lo < 0 || count >= maxSize)
+            return 0; // Invalid digit, odd digit count or overflow
+
+        buffer[count++] = (hi << 4) | lo;
+        str += 2;
+    }
+
+    return count;
+}
+
 // ============================================================================
 // BLOCK NAVIGATION UTILITY IMPLEMENTATION
 // ============================================================================
@@ -155,9 +192,9 @@ bool savePayloadToEEPROM(String *payload)
         return false;
     }
 
-    // Check available EEPROM space
+    // Check available space in the passphrase region
     int dataLength = payload->length();
-    int maxEEPROMSize = EEPROM.length();
+    int maxEEPROMSize = EEPROM_PASSPHRASE_SIZE;
 
     if (dataLength >= maxEEPROMSize)
     {
@@ -173,10 +210,10 @@ bool savePayloadToEEPROM(String *payload)
     Serial.print(dataLength);
     Serial.println(F(" bytes to EEPROM..."));
 
-    // Clear entire EEPROM to ensure clean state
+    // Clear the passphrase region to ensure clean state (other stores are preserved)
     for (int i = 0; i < maxEEPROMSize; i++)
     {
-        EEPROM.write(i, 0);
+        EEPROM.update(EEPROM_PASSPHRASE_ADDR + i, 0);
     }
 
     // Write payload data with character validation
@@ -187,21 +224,21 @@ bool savePayloadToEEPROM(String *payload)
         // Validate printable ASCII characters only (security measure)
         if (c >= 32 && c <= 126)
         {
-            EEPROM.write(i, c);
+            EEPROM.write(EEPROM_PASSPHRASE_ADDR + i, c);
         }
         else
         {
             Serial.print(F("Warning: Non-printable character at position "));
             Serial.print(i);
             Serial.println(F(", replacing with '?'"));
-            EEPROM.write(i, '?'); // Replace invalid characters with placeholder
+            EEPROM.write(EEPROM_PASSPHRASE_ADDR + i, '?'); // Replace invalid characters with placeholder
         }
     }
 
     // Ensure proper null termination
     if (dataLength < maxEEPROMSize)
     {
-        EEPROM.write(dataLength, 0);
+        EEPROM.write(EEPROM_PASSPHRASE_ADDR + dataLength, 0);
     }
 
     Serial.print(F("Successfully saved "));
@@ -217,11 +254,18 @@ void loadPayloadFromEEPROM(String *payload)
 
     // Read EEPROM data with safety limits
     int i = 0;
-    int maxLength = min(EEPROM.length(), 512); // Reasonable limit to prevent memory issues
+    int maxLength = EEPROM_PASSPHRASE_SIZE - 1; // Passphrase region, null terminator excluded
+
+    // Size the string once up front: appending char by char would otherwise
+    // reallocate the heap buffer on every character
+    int storedLength = 0;
+    while (storedLength < maxLength && EEPROM.read(EEPROM_PASSPHRASE_ADDR + storedLength) != 0)
+        storedLength++;
+    payload->reserve(storedLength);
 
     while (i < maxLength)
     {
-        char c = EEPROM.read(i);
+        char c = EEPROM.read(EEPROM_PASSPHRASE_ADDR + i);
 
         // Stop at null terminator (proper end of data)
         if (c == 0)
@@ -241,13 +285,6 @@ void loadPayloadFromEEPROM(String *payload)
         }
 
         i++;
-
-        // Additional safety: prevent excessive memory usage
-        if (payload->length() > 500)
-        {
-            Serial.println(F("Warning: EEPROM data too long, truncating at 500 characters"));
-            break;
-        }
     }
 
     // Report loading status
@@ -69,6 +69,13 @@ const int ERROR_PIN = 3;  // Error State Indicator - Signals system errors and f
 const int SIGNAL1_PIN = A1; // Reserved Signal Pin 1 - Available for future features
 const int SIGNAL2_PIN = A2; // Reserved Signal Pin 2 - Available for future features
 
+/**
+ * @brief RFID Reader Interrupt Line
+ * @details MFRC522 IRQ output, a low-power wake source (power.h). -1: not wired,
+ *          cards are then found by the poll after each sleep tick.
+ */
+const int RFID_IRQ_PIN = -1;
+
 // ============================================================================
 // SYSTEM STATE ENUMERATIONS
 // ============================================================================
@@ -99,10 +106,75 @@ enum Job
  */
 enum Agent
 {
-    AGENT_READER, // Reader-only device variant (if implemented)
-    AGENT_WRITER  // Writer-capable device variant (current implementation)
+    AGENT_READER, // Reader-only device variant (door units, validation only)
+    AGENT_WRITER  // Writer-capable device variant (programming station)
+};
+
+/**
+ * @brief Credential Mode Enumeration
+ * @details Format of the credential carried by the cards (see config.h)
+ */
+enum CredentialMode
+{
+    CREDENTIAL_PASSPHRASE, // Fleet-wide ASCII passphrase spread over the data blocks
+    CREDENTIAL_UID_MAC,    // Single block with a MAC of the card UID (credential.h)
+    CREDENTIAL_RECORDS     // Typed TLV fields closed by a MAC of the card UID (records.h)
+};
+
+/**
+ * @brief Boot Stage Enumeration
+ * @details Boot work deferred to loop() when FAST_BOOT is enabled (see config.h)
+ */
+enum BootStage
+{
+    BOOT_SPLASH,      // LCD init and splash screen still to be shown
+    BOOT_DIAGNOSTICS, // Version and reader details still to be printed
+    BOOT_IDLE,        // Waiting for the splash timeout before showing the idle screen
+    BOOT_DONE         // Boot completed
 };
 
+/**
+ * @brief Splash screen duration (milliseconds)
+ */
+const unsigned long SPLASH_MS = 2000;
+
+// ============================================================================
+// BUILD PROFILE POLICIES
+// ============================================================================
+
+/**
+ * @brief Reader-only build profile policy
+ * @details Compile-time description of a door unit. Every branch guarded by one of
+ *          these constants folds away at compile time, so writeTag(), changeSectorKey(),
+ *          the WRITE mode logic and their LCD strings are discarded by the linker
+ *          (-ffunction-sections + --gc-sections) and never reach the flash image.
+ */
+struct ReaderRole
+{
+    static const Agent AGENT = AGENT_READER;
+    static const bool CAN_WRITE = false;        // No WRITE mode, no card programming
+    static const bool HAS_RESET_BUTTON = false; // Errors clear on their own after ERROR_HOLD_MS
+};
+
+/**
+ * @brief Writer build profile policy
+ * @details Full-featured programming station: READ/WRITE modes, card dump on
+ *          RESET hold and blocking error acknowledgment through the RESET button.
+ */
+struct WriterRole
+{
+    static const Agent AGENT = AGENT_WRITER;
+    static const bool CAN_WRITE = true;
+    static const bool HAS_RESET_BUTTON = true;
+};
+
+/**
+ * @brief Error state duration for devices without a RESET button (milliseconds)
+ * @details Reader units have no operator at the door: after an error is signalled
+ *          the device returns to idle by itself once this time has elapsed.
+ */
+const unsigned long ERROR_HOLD_MS = 2000;
+
 // ============================================================================
 // MIFARE CLASSIC MEMORY LAYOUT CONFIGURATION
 // ============================================================================
@@ -132,6 +204,12 @@ const int BLOCKS_COUNT = 45; // 15 sectors × 3 data blocks per sector
  */
 const int TRAILER_BLOCKS_COUNT = 15; // 15 sectors
 
+/**
+ * @brief Data blocks per sector in the blocks array
+ * @details blocks[i * DATA_BLOCKS_PER_SECTOR ...] belong to the sector closed by trailerBlocks[i]
+ */
+const int DATA_BLOCKS_PER_SECTOR = 3;
+
 // ============================================================================
 // FUNCTION DECLARATIONS
 // ============================================================================
@@ -210,6 +288,18 @@ String bufferToString(byte *buffer, byte bufferSize);
  */
 void dump_byte_array(byte *buffer, byte bufferSize);
 
+/**
+ * @brief Parse a hexadecimal string into bytes
+ * @details Accepts upper/lower case digits; spaces and ':' between bytes are ignored,
+ *          so both "04A1B2C3" and " 04 a1 b2 c3" (uidToString() format) are valid.
+ *
+ * @param str Null-terminated source string
+ * @param buffer Destination byte array
+ * @param maxSize Capacity of the destination array
+ * @return Number of bytes parsed, 0 on invalid input or overflow
+ */
+byte parseHexBytes(const char *str, byte *buffer, byte maxSize);
+
 // ============================================================================
 // BLOCK NAVIGATION UTILITY (CURRENTLY UNUSED)
 // ============================================================================
@@ -233,24 +323,55 @@ int nextBlock(int block, int limit = 64);
 // EEPROM PERSISTENT STORAGE MANAGEMENT
 // ============================================================================
 
+/**
+ * @brief EEPROM Memory Map
+ * @details Fixed layout of the non-volatile configuration. Each store owns its
+ *          region and never touches the others.
+ *
+ * Address   Size  Content
+ * ---------------------------------------------------------------
+ * 0x000     144   Passphrase (ASCII, null terminated, max 143 chars)
+ * 0x090      17   UID-MAC key (16 bytes) + validity marker
+ * 0x0A8      56   Retired secrets, current version + 3 slots (secret-ring.h)
+ * 0x0E0      32   Provisioning journal (journal.h)
+ * 0x100      64   Lifetime counters, 2 slots x 32 bytes (counters.h)
+ * 0x140     192   Audit log ring, 16 records x 12 bytes (audit-log.h)
+ * 0x200     512   UID allow/deny index (uid-index.h)
+ * ---------------------------------------------------------------
+ */
+const int EEPROM_PASSPHRASE_ADDR = 0x000;
+const int EEPROM_PASSPHRASE_SIZE = 144;
+const int EEPROM_MAC_KEY_ADDR = 0x090;
+const int EEPROM_MAC_KEY_SIZE = 17;
+const int EEPROM_SECRET_RING_ADDR = 0x0A8;
+const int EEPROM_SECRET_RING_SIZE = 56;
+const int EEPROM_JOURNAL_ADDR = 0x0E0;
+const int EEPROM_JOURNAL_SIZE = 32;
+const int EEPROM_COUNTERS_ADDR = 0x100;
+const int EEPROM_COUNTERS_SIZE = 64;
+const int EEPROM_AUDIT_LOG_ADDR = 0x140;
+const int EEPROM_AUDIT_LOG_SIZE = 192;
+const int EEPROM_UID_INDEX_ADDR = 0x200;
+const int EEPROM_UID_INDEX_SIZE = 512;
+
 /**
  * @brief Save passphrase data to Arduino's EEPROM memory
  * @details Stores passphrase string in non-volatile EEPROM for persistence across
  *          power cycles. Includes safety checks, data validation, and null termination.
- *          Clears entire EEPROM before writing to ensure clean state.
+ *          Clears the passphrase region before writing to ensure clean state.
  *
  * @param payload Pointer to String containing passphrase to save
  * @return true if save operation succeeded, false if failed
  *
  * Safety Features:
  * - Null pointer validation
- * - Size limit checking (prevents EEPROM overflow)
+ * - Size limit checking (prevents passphrase region overflow)
  * - ASCII character validation (printable characters only)
  * - Automatic null termination
- * - Complete EEPROM clearing before write
+ * - Passphrase region clearing before write
  *
- * @warning Clears entire EEPROM memory before writing new data
- * @note Maximum storage depends on Arduino model (typically 512-4096 bytes)
+ * @warning Clears the whole passphrase region (EEPROM_PASSPHRASE_SIZE bytes) before writing
+ * @note Maximum length is EEPROM_PASSPHRASE_SIZE - 1 characters
  */
 bool savePayloadToEEPROM(String *payload);
 
@@ -263,9 +384,8 @@ bool savePayloadToEEPROM(String *payload);
  * @param payload Pointer to String where loaded data will be stored
  *
  * Safety Features:
- * - Maximum read length limiting (512 bytes)
+ * - Maximum read length limiting (passphrase region size)
  * - Non-printable character detection and rejection
- * - Automatic string length limiting (500 characters max)
  * - Null terminator detection
  * - Corruption detection and early termination
  *
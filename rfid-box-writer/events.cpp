@@ -0,0 +1,52 @@
+/**
+ * @file events.cpp
+ * @brief Implementation of the deferred event queue
+ * @author Dag
+ */
+
+#include "events.h"
+
+EventQueue::EventQueue()
+{
+    clear();
+}
+
+bool EventQueue::publish(EventType type, byte arg, byte status)
+{
+    if (count >= EVENT_QUEUE_SIZE)
+    {
+        if (dropped < 0xFF)
+            dropped++; // Saturating counter
+        return false;
+    }
+
+    Event &ev = queue[(head + count) & (EVENT_QUEUE_SIZE - 1)];
+    ev.type = type;
+    ev.arg = arg;
+    ev.status = status;
+    count++;
+    return true;
+}
+
+bool EventQueue::pop(Event *ev)
+{
+    if (count == 0)
+        return false;
+
+    *ev = queue[head];
+    head = (head + 1) & (EVENT_QUEUE_SIZE - 1);
+    count--;
+    return true;
+}
+
+byte EventQueue::droppedCount() const
+{
+    return dropped;
+}
+
+void EventQueue::clear()
+{
+    head = 0;
+    count = 0;
+    dropped = 0;
+}
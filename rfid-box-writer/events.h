@@ -0,0 +1,116 @@
+/**
+ * @file events.h
+ * @brief Deferred event queue for RFID Box user feedback
+ * @details The card exchange never talks to the LCD, the serial port or the buzzer
+ *          directly: it publishes compact events into a fixed-size queue instead.
+ *          The queue is drained only after the card has been halted, so the RF timing
+ *          no longer depends on I2C or UART speed.
+ * @author Dag
+ */
+
+#ifndef RFID_EVENTS_H
+#define RFID_EVENTS_H
+
+#include "Arduino.h"
+
+// ============================================================================
+// EVENT DEFINITIONS
+// ============================================================================
+
+/**
+ * @brief Event types published by the card path
+ * @details `arg` and `status` meaning is documented next to each type.
+ */
+enum EventType : byte
+{
+    EV_UID_DETECTED,        // Card selected (UID is available in rfid.uid)
+    EV_UID_READ_FAILED,     // Anticollision/select failed
+    EV_INCOMPATIBLE_CARD,   // Card type not supported
+    EV_UID_DENIED,          // UID denylisted: rejected before authentication
+    EV_UID_NOT_ALLOWED,     // UID_ALLOWLIST_ONLY: UID not allowlisted, rejected before authentication
+    EV_UID_MISMATCH,        // Host job: the card is not the expected one
+    EV_AUTH_FAILED,         // arg: block (page on Ultralight / NTAG), status: MFRC522::StatusCode
+    EV_BLOCK_READ_FAILED,   // arg: block (page on Ultralight / NTAG), status: MFRC522::StatusCode
+    EV_BLOCK_WRITE_FAILED,  // arg: block (page on Ultralight / NTAG), status: MFRC522::StatusCode
+    EV_CARD_READ,           // arg: number of data blocks read
+    EV_CARD_BLANK,          // Blocks read, but the card carries no credential (first block empty)
+    EV_CARD_WRITTEN,        // arg: number of blocks physically written
+    EV_CARD_UPGRADED,       // arg: secret version the card had (0 = unversioned)
+    EV_BLOCKS_UNCHANGED,    // arg: number of blocks skipped because already up to date
+    EV_SECTOR_REKEYED,      // arg: number of sectors re-keyed and verified
+    EV_TAG_PROTECTED,       // NTAG / Ultralight EV1: user pages write protected with ntag_password
+    EV_VERIFY_FAILED,       // arg: block whose read-back differs from the written data
+    EV_PROVISION_RESUMED,   // arg: sector index provisioning resumed from (journal.h)
+    EV_ACCESS_GRANTED,      // Credential matched, arg: 1 if granted from the grant cache
+    EV_ACCESS_DENIED,       // Passphrase mismatch
+    EV_USES_LEFT,           // Entry taken from a usage-limited badge, arg: entries left (capped to 255)
+    EV_USES_EXHAUSTED,      // Valid usage-limited badge with no entry left: access denied
+    EV_USES_LOADED,         // WRITE: entry counter loaded on the badge, arg: entries (capped to 255)
+    EV_CLONE_STEP,          // arg: next chunk, status: CloneStage (card to present next)
+    EV_CLONE_WRONG_CARD,    // arg: next chunk, status: CloneStage expected
+    EV_CLONE_DONE,          // arg: chunks copied, status: chunks unreadable
+    EV_PASSPHRASE_SET,      // SET mode: new passphrase stored in EEPROM
+    EV_EEPROM_WRITE_FAILED  // SET mode: EEPROM store failed. WRITE: master passphrase lost by an interrupted SET
+};
+
+/**
+ * @brief Compact event record (3 bytes)
+ */
+struct Event
+{
+    byte type;   // EventType
+    byte arg;    // Event argument (block number, counter, ...)
+    byte status; // MFRC522::StatusCode for RF failures, 0 otherwise
+};
+
+/**
+ * @brief Queue capacity (must be a power of two)
+ * @details One card transaction publishes a handful of events: 16 slots leave
+ *          plenty of room while costing only 48 bytes of SRAM.
+ */
+const byte EVENT_QUEUE_SIZE = 16;
+
+// ============================================================================
+// EVENT QUEUE
+// ============================================================================
+
+/**
+ * @brief Fixed-size FIFO ring of events
+ * @details No dynamic allocation. When the queue is full new events are dropped
+ *          and counted, the producer never blocks.
+ */
+class EventQueue
+{
+private:
+    Event queue[EVENT_QUEUE_SIZE];
+    byte head;    // Index of the oldest event
+    byte count;   // Number of queued events
+    byte dropped; // Events lost because the queue was full
+
+public:
+    EventQueue();
+
+    /**
+     * @brief Append an event to the queue
+     * @param type Event type
+     * @param arg Optional argument (block number, counter, ...)
+     * @param status Optional MFRC522::StatusCode
+     * @return true if queued, false if the queue was full (event dropped)
+     */
+    bool publish(EventType type, byte arg = 0, byte status = 0);
+
+    /**
+     * @brief Remove the oldest event from the queue
+     * @param ev Destination of the event
+     * @return true if an event was returned, false if the queue is empty
+     */
+    bool pop(Event *ev);
+
+    /** @brief Number of events dropped since the last clear() */
+    byte droppedCount() const;
+
+    /** @brief Discard every queued event and reset the drop counter */
+    void clear();
+};
+
+#endif // RFID_EVENTS_H
@@ -0,0 +1,150 @@
+/**
+ * @file frame.cpp
+ * @brief Implementation of the framed binary output
+ * @author Dag
+ */
+
+#include "frame.h"
+
+uint16_t crc16Update(uint16_t crc, byte data)
+{
+    crc ^= (uint16_t)data << 8;
+    for (byte i = 0; i < 8; i++)
+        crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    return crc;
+}
+
+FrameWriter::FrameWriter(Print *out)
+{
+    this->out = out;
+    crc = 0xFFFF;
+}
+
+void FrameWriter::put(byte b)
+{
+    crc = crc16Update(crc, b);
+    out->write(b);
+}
+
+void FrameWriter::begin(byte type, uint16_t length)
+{
+    out->write(FRAME_SOF);
+    crc = 0xFFFF;
+    put(type);
+    put(length & 0xFF);
+    put(length >> 8);
+}
+
+void FrameWriter::write(const byte *data, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+        put(data[i]);
+}
+
+void FrameWriter::write(byte b)
+{
+    put(b);
+}
+
+void FrameWriter::end()
+{
+    uint16_t final = crc;
+    out->write(final & 0xFF);
+    out->write(final >> 8);
+}
+
+// ============================================================================
+// FRAME READER
+// ============================================================================
+
+enum FrameReaderState : byte
+{
+    RX_IDLE,
+    RX_TYPE,
+    RX_LEN_LO,
+    RX_LEN_HI,
+    RX_PAYLOAD,
+    RX_CRC_LO,
+    RX_CRC_HI
+};
+
+FrameReader::FrameReader(byte *buffer, byte capacity)
+{
+    this->buffer = buffer;
+    this->capacity = capacity;
+    frameType = 0;
+    length = 0;
+    reset();
+}
+
+void FrameReader::reset()
+{
+    state = RX_IDLE;
+    count = 0;
+    crc = 0xFFFF;
+}
+
+bool FrameReader::active() const
+{
+    return state != RX_IDLE;
+}
+
+byte FrameReader::type() const
+{
+    return frameType;
+}
+
+byte FrameReader::payloadLength() const
+{
+    return length;
+}
+
+bool FrameReader::feed(byte b)
+{
+    switch (state)
+    {
+    case RX_IDLE:
+        if (b == FRAME_SOF)
+        {
+            reset();
+            state = RX_TYPE;
+        }
+        return false;
+
+    case RX_TYPE:
+        frameType = b;
+        state = RX_LEN_LO;
+        break;
+
+    case RX_LEN_LO:
+        length = b;
+        state = RX_LEN_HI;
+        break;
+
+    case RX_LEN_HI:
+        length |= (uint16_t)b << 8;
+        state = length > 0 ? RX_PAYLOAD : RX_CRC_LO;
+        break;
+
+    case RX_PAYLOAD:
+        if (count < capacity)
+            buffer[count] = b;
+        count++;
+        if (count == length)
+            state = RX_CRC_LO;
+        break;
+
+    case RX_CRC_LO:
+        received = b;
+        state = RX_CRC_HI;
+        return false;
+
+    case RX_CRC_HI:
+        received |= (uint16_t)b << 8;
+        state = RX_IDLE;
+        return received == crc && length <= capacity; // Oversized frames are dropped
+    }
+
+    crc = crc16Update(crc, b);
+    return false;
+}
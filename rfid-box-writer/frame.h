@@ -0,0 +1,135 @@
+/**
+ * @file frame.h
+ * @brief Framed binary output for host tools
+ * @details Every binary export (audit log, dumps, ...) is wrapped in the same frame,
+ *          so host tools can resynchronize on a noisy serial line and reject
+ *          corrupted data:
+ *
+ * -----------------------------------------------------------------
+ * SOF (0x7E) | TYPE (1) | LENGTH (2, LE) | PAYLOAD (LENGTH) | CRC16 (2, LE)
+ * -----------------------------------------------------------------
+ *
+ * CRC16 is CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) over TYPE, LENGTH and PAYLOAD.
+ * @author Dag
+ */
+
+#ifndef RFID_FRAME_H
+#define RFID_FRAME_H
+
+#include "Arduino.h"
+
+const byte FRAME_SOF = 0x7E; // Start of frame marker
+const unsigned long FRAME_RX_TIMEOUT_MS = 200; // Incomplete frame silent this long is dropped
+
+/**
+ * @brief Frame types
+ */
+enum FrameType : byte
+{
+    FRAME_AUDIT_LOG = 0x10, // Payload: audit records, oldest first (audit-log.h)
+    FRAME_COUNTERS = 0x11,  // Payload: lifetime counters (counters.h)
+    FRAME_TRACE = 0x12,     // Payload: RF trace records, oldest first (rf-trace.h)
+    FRAME_CARD_INFO = 0x20, // Card header of a sector stream (sector-io.h)
+    FRAME_SECTOR = 0x21,    // One 64-byte chunk with its auth status (sector-io.h)
+    FRAME_CARD_END = 0x22,  // End of a sector stream (sector-io.h)
+    FRAME_JOB = 0x30,            // Host -> box: provisioning job (host-job.h)
+    FRAME_JOB_ACK = 0x31,        // Box -> host: job accepted or refused
+    FRAME_JOB_RESULT = 0x32,     // Box -> host: job outcome
+    FRAME_STATUS_REQUEST = 0x33, // Host -> box: status poll, no payload
+    FRAME_STATUS = 0x34,         // Box -> host: device status
+    FRAME_JOB_CANCEL = 0x35,     // Host -> box: cancel the armed job
+    FRAME_CONSOLE = 0x40,        // Host -> box: batch of console commands (console.h)
+    FRAME_CONSOLE_REPLY = 0x41   // Box -> host: reply to one console command
+};
+
+/**
+ * @brief Update a CRC-16/CCITT-FALSE with one byte
+ * @param crc Current CRC (start with 0xFFFF)
+ * @param data Next byte
+ * @return Updated CRC
+ */
+uint16_t crc16Update(uint16_t crc, byte data);
+
+/**
+ * @brief Streaming frame encoder
+ * @details The payload is written in chunks while the CRC is updated on the fly,
+ *          so a frame never needs to be buffered in RAM.
+ */
+class FrameWriter
+{
+private:
+    Print *out;   // Destination stream (usually Serial)
+    uint16_t crc; // Running CRC of the current frame
+
+    void put(byte b);
+
+public:
+    /**
+     * @brief CONSTRUCTOR
+     * @param out Destination stream
+     */
+    FrameWriter(Print *out);
+
+    /**
+     * @brief Write the frame header
+     * @param type Frame type
+     * @param length Payload length that will follow
+     */
+    void begin(byte type, uint16_t length);
+
+    /** @brief Write payload bytes */
+    void write(const byte *data, uint16_t len);
+
+    /** @brief Write one payload byte */
+    void write(byte b);
+
+    /** @brief Close the frame with its CRC */
+    void end();
+};
+
+/**
+ * @brief Incremental frame decoder
+ * @details Bytes are fed one at a time as they arrive, so reception never blocks.
+ *          The payload is stored in a caller-provided buffer; longer frames are
+ *          consumed and discarded.
+ */
+class FrameReader
+{
+private:
+    byte *buffer;      // Payload destination
+    byte capacity;     // Buffer size
+    byte state;        // Decoder state
+    byte frameType;    // TYPE of the current frame
+    uint16_t length;   // LENGTH of the current frame
+    uint16_t count;    // Payload bytes received
+    uint16_t crc;      // Running CRC
+    uint16_t received; // CRC sent by the host
+
+public:
+    /**
+     * @brief CONSTRUCTOR
+     * @param buffer Payload buffer
+     * @param capacity Buffer size (longest accepted payload)
+     */
+    FrameReader(byte *buffer, byte capacity);
+
+    /**
+     * @brief Decode one received byte
+     * @return true when a complete frame with a valid CRC is in the buffer
+     */
+    bool feed(byte b);
+
+    /** @brief A frame is being received (SOF seen, frame not complete) */
+    bool active() const;
+
+    /** @brief Drop the frame being received */
+    void reset();
+
+    /** @brief TYPE of the last complete frame */
+    byte type() const;
+
+    /** @brief Payload length of the last complete frame */
+    byte payloadLength() const;
+};
+
+#endif // RFID_FRAME_H
@@ -0,0 +1,101 @@
+/**
+ * @file grant-cache.cpp
+ * @brief Implementation of the validation cache
+ * @author Dag
+ */
+
+#include "grant-cache.h"
+#include "config.h"
+
+struct GrantEntry
+{
+    byte size;                   // UID size, 0 = empty slot
+    byte uid[10];                // UID bytes
+    unsigned long validatedMs;   // millis() of the credential check
+    unsigned long usedMs;        // millis() of the last grant, for LRU replacement
+};
+
+static GrantEntry entries[GRANT_CACHE_SIZE];
+static unsigned int hits = 0;
+static unsigned int misses = 0;
+
+static bool expired(const GrantEntry &e, unsigned long now)
+{
+    return e.size == 0 || now - e.validatedMs >= GRANT_CACHE_TTL_MS;
+}
+
+static GrantEntry *find(const MFRC522::Uid &uid)
+{
+    for (byte i = 0; i < GRANT_CACHE_SIZE; i++)
+        if (entries[i].size == uid.size && memcmp(entries[i].uid, uid.uidByte, uid.size) == 0)
+            return &entries[i];
+    return nullptr;
+}
+
+bool grantCacheHit(const MFRC522::Uid &uid)
+{
+    if (GRANT_CACHE_TTL_MS == 0)
+        return false;
+
+    unsigned long now = millis();
+    GrantEntry *e = find(uid);
+    if (!e || expired(*e, now))
+    {
+        misses++;
+        return false;
+    }
+
+    e->usedMs = now;
+    hits++;
+    return true;
+}
+
+void grantCachePut(const MFRC522::Uid &uid)
+{
+    if (GRANT_CACHE_TTL_MS == 0)
+        return;
+
+    unsigned long now = millis();
+    GrantEntry *e = find(uid);
+
+    // Otherwise an expired slot, or the least recently used one
+    for (byte i = 0; !e && i < GRANT_CACHE_SIZE; i++)
+        if (expired(entries[i], now))
+            e = &entries[i];
+    if (!e)
+    {
+        e = &entries[0];
+        for (byte i = 1; i < GRANT_CACHE_SIZE; i++)
+            if (now - entries[i].usedMs > now - e->usedMs)
+                e = &entries[i];
+    }
+
+    e->size = uid.size;
+    memcpy(e->uid, uid.uidByte, uid.size);
+    e->validatedMs = now;
+    e->usedMs = now;
+}
+
+void grantCacheClear()
+{
+    for (byte i = 0; i < GRANT_CACHE_SIZE; i++)
+        entries[i].size = 0;
+}
+
+void printGrantCacheStats()
+{
+    unsigned long now = millis();
+    byte live = 0;
+    for (byte i = 0; i < GRANT_CACHE_SIZE; i++)
+        if (!expired(entries[i], now))
+            live++;
+
+    Serial.print(F("Grant cache: hits: "));
+    Serial.print(hits);
+    Serial.print(F(" misses: "));
+    Serial.print(misses);
+    Serial.print(F(" entries: "));
+    Serial.print(live);
+    Serial.print('/');
+    Serial.println(GRANT_CACHE_SIZE);
+}
@@ -0,0 +1,43 @@
+/**
+ * @file grant-cache.h
+ * @brief Short-lived cache of the UIDs validated a moment ago
+ * @details People tap twice or tap again when the door did not open fast enough.
+ *          A UID whose credential was validated less than GRANT_CACHE_TTL_MS ago
+ *          (config.h) is granted right after anticollision, without authenticating
+ *          or reading a single block.
+ *
+ *          The TTL starts at the real validation and is not extended by cached
+ *          grants. When the cache is full the least recently used entry is replaced.
+ *          The cache lives in RAM only and is cleared when the secret changes
+ *          (SET mode) or the UID lists are edited.
+ * @author Dag
+ */
+
+#ifndef RFID_GRANT_CACHE_H
+#define RFID_GRANT_CACHE_H
+
+#include "Arduino.h"
+#include <MFRC522.h>
+
+/**
+ * @brief Number of UIDs remembered
+ * @details Each entry costs 19 bytes of SRAM (UID, size, two timestamps).
+ */
+const byte GRANT_CACHE_SIZE = 4;
+
+/**
+ * @brief Look up a UID
+ * @return true if the UID was validated less than GRANT_CACHE_TTL_MS ago
+ */
+bool grantCacheHit(const MFRC522::Uid &uid);
+
+/** @brief Remember a UID whose credential has just been validated */
+void grantCachePut(const MFRC522::Uid &uid);
+
+/** @brief Forget every UID */
+void grantCacheClear();
+
+/** @brief Print hits, misses and occupancy */
+void printGrantCacheStats();
+
+#endif // RFID_GRANT_CACHE_H
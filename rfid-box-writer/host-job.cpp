@@ -0,0 +1,79 @@
+/**
+ * @file host-job.cpp
+ * @brief Implementation of the host provisioning job frames
+ * @author Dag
+ */
+
+#include "host-job.h"
+#include "frame.h"
+
+uint16_t jobId(const byte *payload, byte length)
+{
+    return length >= 2 ? payload[0] | (payload[1] << 8) : 0;
+}
+
+bool parseJob(const byte *payload, byte length, ProvisionJob *job)
+{
+    if (length < 4)
+        return false;
+
+    byte uidSize = payload[3];
+    if (uidSize != 0 && uidSize != 4 && uidSize != 7 && uidSize != 10)
+        return false;
+    if (length < 4 + uidSize || length - 4 - uidSize > JOB_PASSPHRASE_MAX)
+        return false;
+
+    job->id = jobId(payload, length);
+    job->flags = payload[2];
+    job->uid.size = uidSize;
+    memcpy(job->uid.uidByte, payload + 4, uidSize);
+
+    job->passphrase = "";
+    job->passphrase.reserve(length - 4 - uidSize);
+    for (byte i = 4 + uidSize; i < length; i++)
+        job->passphrase += (char)payload[i];
+
+    job->armed = true;
+    return true;
+}
+
+void sendJobAck(Print *out, uint16_t id, JobAck status)
+{
+    FrameWriter frame(out);
+    frame.begin(FRAME_JOB_ACK, 3);
+    frame.write(id & 0xFF);
+    frame.write(id >> 8);
+    frame.write(status);
+    frame.end();
+}
+
+void sendJobResult(Print *out, uint16_t id, const CardOutcome &outcome, unsigned long durationMs, const MFRC522::Uid &uid)
+{
+    uint16_t duration = durationMs > 0xFFFF ? 0xFFFF : durationMs;
+
+    FrameWriter frame(out);
+    frame.begin(FRAME_JOB_RESULT, 9 + uid.size);
+    frame.write(id & 0xFF);
+    frame.write(id >> 8);
+    frame.write(outcome.result);
+    frame.write(outcome.block);
+    frame.write(outcome.written);
+    frame.write(outcome.skipped);
+    frame.write(duration & 0xFF);
+    frame.write(duration >> 8);
+    frame.write(uid.size);
+    frame.write(uid.uidByte, uid.size);
+    frame.end();
+}
+
+void sendStatus(Print *out, byte agent, byte mode, const ProvisionJob &job)
+{
+    FrameWriter frame(out);
+    frame.begin(FRAME_STATUS, 5);
+    frame.write(agent);
+    frame.write(mode);
+    frame.write(job.armed);
+    frame.write(job.id & 0xFF);
+    frame.write(job.id >> 8);
+    frame.end();
+}
@@ -0,0 +1,84 @@
+/**
+ * @file host-job.h
+ * @brief Provisioning jobs received from the host (rfid-host-util/provisiond)
+ * @details A writer box holds at most one job. The host sends FRAME_JOB, the box
+ *          answers FRAME_JOB_ACK at once and FRAME_JOB_RESULT after the next card.
+ *          The single job slot is the flow control: the host sends a new job only
+ *          after the result of the previous one.
+ *
+ * Payloads (little endian):
+ * -----------------------------------------------------------------
+ * FRAME_JOB          id (2) | flags (1) | UID size (1) | UID (size) | passphrase (rest)
+ * FRAME_JOB_ACK      id (2) | JobAck (1)
+ * FRAME_JOB_RESULT   id (2) | result (1) | block (1) | written (1) | skipped (1) |
+ *                    duration ms (2) | UID size (1) | UID (size)
+ * FRAME_JOB_CANCEL   id (2)
+ * FRAME_STATUS       agent (1) | mode (1) | job armed (1) | job id (2)
+ * -----------------------------------------------------------------
+ * UID size 0: any card. Empty passphrase: the box master credential.
+ * result is an AuditResult (audit-log.h): AUDIT_WRITTEN on success, 0 if cancelled.
+ * @author Dag
+ */
+
+#ifndef RFID_HOST_JOB_H
+#define RFID_HOST_JOB_H
+
+#include "Arduino.h"
+#include <MFRC522.h>
+
+const byte JOB_FLAG_NO_REKEY = 0x01; // Write data only, keep the sector keys
+const byte JOB_PASSPHRASE_MAX = 64;  // Longer passphrases: use SET mode
+
+/**
+ * @brief FRAME_JOB_ACK status
+ */
+enum JobAck : byte
+{
+    JOB_ACCEPTED = 0,
+    JOB_BUSY = 1,       // A job is already armed
+    JOB_INVALID = 2,    // Malformed payload
+    JOB_UNSUPPORTED = 3 // Reader build
+};
+
+/**
+ * @brief Job waiting for a card
+ */
+struct ProvisionJob
+{
+    bool armed;        // Waiting for a card
+    uint16_t id;       // Host job id
+    byte flags;        // JOB_FLAG_*
+    MFRC522::Uid uid;  // Expected UID, size 0 = any card
+    String passphrase; // Data to write, empty = master credential
+};
+
+/**
+ * @brief Outcome of the last card transaction, collected from the events
+ */
+struct CardOutcome
+{
+    byte result;  // AuditResult
+    byte block;   // Failing block, 0xFF if none
+    byte written; // Blocks written
+    byte skipped; // Blocks already up to date
+};
+
+/**
+ * @brief Parse a FRAME_JOB payload
+ * @return true if valid (the job is armed)
+ */
+bool parseJob(const byte *payload, byte length, ProvisionJob *job);
+
+/** @brief Read the job id of a FRAME_JOB / FRAME_JOB_CANCEL payload (0 if too short) */
+uint16_t jobId(const byte *payload, byte length);
+
+/** @brief Send FRAME_JOB_ACK */
+void sendJobAck(Print *out, uint16_t id, JobAck status);
+
+/** @brief Send FRAME_JOB_RESULT */
+void sendJobResult(Print *out, uint16_t id, const CardOutcome &outcome, unsigned long durationMs, const MFRC522::Uid &uid);
+
+/** @brief Send FRAME_STATUS */
+void sendStatus(Print *out, byte agent, byte mode, const ProvisionJob &job);
+
+#endif // RFID_HOST_JOB_H
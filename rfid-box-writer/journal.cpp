@@ -0,0 +1,66 @@
+/**
+ * @file journal.cpp
+ * @brief Implementation of the provisioning journal
+ * @author Dag
+ */
+
+#include "journal.h"
+#include "def.h"
+
+static const int CRC_OFFSET = 5;
+static const int PROGRESS_OFFSET = 7;
+static const byte PROGRESS_CELLS = TRAILER_BLOCKS_COUNT;
+
+static_assert(PROGRESS_OFFSET + PROGRESS_CELLS <= EEPROM_JOURNAL_SIZE, "Journal region too small for one cell per sector");
+
+/** @brief Pointer to the UID bytes stored in the journal */
+static const byte *uidTag(const MFRC522::Uid &uid)
+{
+    return uid.uidByte + (uid.size > 4 ? uid.size - 4 : 0);
+}
+
+void journalOpen(const MFRC522::Uid &uid, uint16_t dataCrc)
+{
+    const byte *tag = uidTag(uid);
+
+    EEPROM.update(EEPROM_JOURNAL_ADDR, 0xFF); // Invalid while the record is rewritten
+    for (byte i = 0; i < 4; i++)
+        EEPROM.update(EEPROM_JOURNAL_ADDR + 1 + i, tag[i]);
+    EEPROM.update(EEPROM_JOURNAL_ADDR + CRC_OFFSET, dataCrc & 0xFF);
+    EEPROM.update(EEPROM_JOURNAL_ADDR + CRC_OFFSET + 1, dataCrc >> 8);
+    for (byte i = 0; i < PROGRESS_CELLS; i++)
+        EEPROM.update(EEPROM_JOURNAL_ADDR + PROGRESS_OFFSET + i, 0xFF); // update(): only the cells set by the last card are written
+    EEPROM.update(EEPROM_JOURNAL_ADDR, JOURNAL_MARKER);
+}
+
+void journalAdvance(byte sector)
+{
+    if (sector > 0 && sector <= PROGRESS_CELLS)
+        EEPROM.update(EEPROM_JOURNAL_ADDR + PROGRESS_OFFSET + sector - 1, JOURNAL_SECTOR_DONE);
+}
+
+byte journalResumeSector(const MFRC522::Uid &uid, uint16_t dataCrc)
+{
+    if (EEPROM.read(EEPROM_JOURNAL_ADDR) != JOURNAL_MARKER)
+        return 0;
+
+    const byte *tag = uidTag(uid);
+    for (byte i = 0; i < 4; i++)
+        if (EEPROM.read(EEPROM_JOURNAL_ADDR + 1 + i) != tag[i])
+            return 0;
+
+    uint16_t crc = EEPROM.read(EEPROM_JOURNAL_ADDR + CRC_OFFSET) |
+                   (EEPROM.read(EEPROM_JOURNAL_ADDR + CRC_OFFSET + 1) << 8);
+    if (crc != dataCrc)
+        return 0; // Same card, different data: provision from scratch
+
+    byte sector = 0;
+    while (sector < PROGRESS_CELLS && EEPROM.read(EEPROM_JOURNAL_ADDR + PROGRESS_OFFSET + sector) == JOURNAL_SECTOR_DONE)
+        sector++;
+    return sector;
+}
+
+void journalClose()
+{
+    EEPROM.update(EEPROM_JOURNAL_ADDR, 0xFF);
+}
@@ -0,0 +1,64 @@
+/**
+ * @file journal.h
+ * @brief Provisioning journal in EEPROM
+ * @details Provisioning re-keys one sector at a time. If the card is pulled or the
+ *          writer loses power half way, the card is left with some sectors on the new
+ *          key and some on the old one. The journal records the card, a CRC of the
+ *          data being written and the first sector not yet verified, so presenting
+ *          the same card again resumes from that sector.
+ *
+ *          Authentication goes through the keyring (keyring.h), so the interrupted
+ *          sector is accessed with whichever key it ended up with.
+ *
+ * Record layout (EEPROM_JOURNAL_SIZE = 32 bytes):
+ * -----------------------------------------------------------------
+ * Byte 0     Marker (JOURNAL_MARKER = open, anything else = empty)
+ * Byte 1-4   Last 4 UID bytes
+ * Byte 5-6   CRC16 of the data being written (LE)
+ * Byte 7-21  One cell per sector (position in trailerBlocks):
+ *            JOURNAL_SECTOR_DONE = verified, anything else = not yet
+ * Byte 22-31 Unused
+ * -----------------------------------------------------------------
+ *
+ * @note Progress is not a counter rewritten at every sector: each sector has its own
+ *       cell, set once by journalAdvance() and cleared once by the next journalOpen().
+ *       No cell is written more than twice per card: with 100,000 EEPROM cycles per
+ *       cell this allows about 50,000 provisioned cards.
+ * @author Dag
+ */
+
+#ifndef RFID_JOURNAL_H
+#define RFID_JOURNAL_H
+
+#include "Arduino.h"
+#include <MFRC522.h>
+
+const byte JOURNAL_MARKER = 0x4A;      // 'J'
+const byte JOURNAL_SECTOR_DONE = 0x00; // Progress cell of a verified sector
+
+/**
+ * @brief Open the journal for a card
+ * @param uid Card UID
+ * @param dataCrc CRC16 of the data being written
+ */
+void journalOpen(const MFRC522::Uid &uid, uint16_t dataCrc);
+
+/**
+ * @brief Record that every sector before `sector` is written, re-keyed and verified
+ * @details One EEPROM cell write per sector, in the cell of sector - 1.
+ * @param sector Next sector index to process
+ */
+void journalAdvance(byte sector);
+
+/**
+ * @brief Sector to resume from for this card and data
+ * @param uid Card UID
+ * @param dataCrc CRC16 of the data being written
+ * @return Sector index recorded by journalAdvance(), 0 if the journal is for another card or data
+ */
+byte journalResumeSector(const MFRC522::Uid &uid, uint16_t dataCrc);
+
+/** @brief Close the journal: provisioning completed */
+void journalClose();
+
+#endif // RFID_JOURNAL_H
@@ -0,0 +1,151 @@
+/**
+ * @file keyring.cpp
+ * @brief Implementation of the keyring authentication and key cache
+ * @author Dag
+ */
+
+#include "keyring.h"
+
+static const byte NO_KEY = 0xFF;
+
+static const byte (*ring)[MFRC522::MF_KEY_SIZE] = 0; // Candidate keys, in flash
+static byte ringSize = 0;
+static byte lastKey = 0;            // Key index that worked last (any card)
+
+static byte cacheUid[KEY_CACHE_SIZE][4]; // Last 4 UID bytes (the serial number part)
+static byte cacheKey[KEY_CACHE_SIZE];    // Key index per entry, NO_KEY = empty
+static byte cacheNext = 0;               // Round robin replacement
+
+static KeyringStats stats;
+
+// ============================================================================
+// KEY CACHE
+// ============================================================================
+
+/** @brief Pointer to the UID bytes used as cache tag */
+static const byte *uidTag(const MFRC522::Uid &uid)
+{
+    return uid.uidByte + (uid.size > 4 ? uid.size - 4 : 0);
+}
+
+static byte cacheFind(const MFRC522::Uid &uid)
+{
+    const byte *tag = uidTag(uid);
+    for (byte i = 0; i < KEY_CACHE_SIZE; i++)
+        if (cacheKey[i] != NO_KEY && memcmp(cacheUid[i], tag, 4) == 0)
+            return i;
+    return NO_KEY;
+}
+
+static void cacheStore(const MFRC522::Uid &uid, byte key)
+{
+    byte entry = cacheFind(uid);
+    if (entry == NO_KEY)
+    {
+        entry = cacheNext;
+        cacheNext = (cacheNext + 1) % KEY_CACHE_SIZE;
+        memcpy(cacheUid[entry], uidTag(uid), 4);
+    }
+    cacheKey[entry] = key;
+}
+
+// ============================================================================
+// AUTHENTICATION
+// ============================================================================
+
+MFRC522::StatusCode reselectCard(TracedMFRC522 *rfid)
+{
+    byte atqa[2];
+    byte size = sizeof(atqa);
+
+    rfid->PCD_StopCrypto1();
+    rfid->PICC_WakeupA(atqa, &size);
+    return rfid->PICC_Select(&(rfid->uid), rfid->uid.size * 8); // UID known: no anticollision
+}
+
+static MFRC522::StatusCode tryKey(TracedMFRC522 *rfid, byte block, byte index)
+{
+    MFRC522::MIFARE_Key key;
+    memcpy_P(key.keyByte, ring[index], MFRC522::MF_KEY_SIZE);
+    return rfid->PCD_Authenticate(MFRC522::PICC_CMD_MF_AUTH_KEY_A, block, &key, &(rfid->uid));
+}
+
+void keyringBegin(const byte (*keys)[MFRC522::MF_KEY_SIZE], byte count)
+{
+    ring = keys;
+    ringSize = count;
+    lastKey = 0;
+    memset(cacheKey, NO_KEY, sizeof(cacheKey));
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool keyringAuthenticate(TracedMFRC522 *rfid, byte block, MFRC522::StatusCode *status)
+{
+    stats.auths++;
+
+    // Probe order: cached key, last working key, then the rest of the ring
+    byte entry = cacheFind(rfid->uid);
+    byte first = entry != NO_KEY ? cacheKey[entry] : lastKey;
+
+    for (byte n = 0; n < ringSize; n++)
+    {
+        byte index = n == 0 ? first : n - 1 + (n - 1 >= first); // Skip the key already tried
+
+        if (n > 0)
+        {
+            stats.probes++;
+            reselectCard(rfid);
+        }
+
+        *status = tryKey(rfid, block, index);
+        if (*status == MFRC522::STATUS_OK)
+        {
+            if (n == 0)
+                stats.firstTry++;
+            lastKey = index;
+            cacheStore(rfid->uid, index);
+            return true;
+        }
+    }
+
+    stats.failures++;
+    return false;
+}
+
+bool keyringAuthenticatePreferred(TracedMFRC522 *rfid, byte block, MFRC522::StatusCode *status)
+{
+    *status = tryKey(rfid, block, 0);
+    if (*status != MFRC522::STATUS_OK)
+        return false;
+
+    lastKey = 0;
+    cacheStore(rfid->uid, 0);
+    return true;
+}
+
+void keyringKey(byte index, byte *key)
+{
+    memcpy_P(key, ring[index], MFRC522::MF_KEY_SIZE);
+}
+
+byte keyringLastIndex()
+{
+    return lastKey;
+}
+
+const KeyringStats &keyringStats()
+{
+    return stats;
+}
+
+void printKeyringStats()
+{
+    Serial.print(F("Auth: "));
+    Serial.print(stats.auths);
+    Serial.print(F(" first try: "));
+    Serial.print(stats.firstTry);
+    Serial.print(F(" probes: "));
+    Serial.print(stats.probes);
+    Serial.print(F(" failed: "));
+    Serial.println(stats.failures);
+}
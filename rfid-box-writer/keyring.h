@@ -0,0 +1,87 @@
+/**
+ * @file keyring.h
+ * @brief Multi-key MIFARE Classic authentication with per-card key cache
+ * @details During a key migration part of the fleet still uses the old Key A.
+ *          Authentication tries a ring of candidate keys (KEYRING in secrets.h) in
+ *          this order, each key at most once per block:
+ *          1. the key cached for this card (UID -> key index, RAM only)
+ *          2. the key that worked last, for any card (cards of one batch share it)
+ *          3. the remaining keys, in keyring order
+ *
+ *          A failed MIFARE authentication drops the card out of the selected
+ *          state, so the card is woken up and selected again before each new probe.
+ * @author Dag
+ */
+
+#ifndef RFID_KEYRING_H
+#define RFID_KEYRING_H
+
+#include "Arduino.h"
+#include <MFRC522.h>
+#include "rf-trace.h"
+
+/**
+ * @brief Number of cards remembered by the key cache
+ * @details Each entry costs 5 bytes of SRAM (4 UID bytes + key index).
+ */
+const byte KEY_CACHE_SIZE = 8;
+
+/**
+ * @brief Authentication counters
+ */
+struct KeyringStats
+{
+    unsigned int auths;    // Authentications requested
+    unsigned int firstTry; // Succeeded with the first candidate
+    unsigned int probes;   // Extra candidates tried after a failure
+    unsigned int failures; // No candidate worked
+};
+
+/**
+ * @brief Set the candidate keys
+ * @param keys 6-byte keys in flash (PROGMEM), preferred key first
+ * @param count Number of keys (at least 1)
+ */
+void keyringBegin(const byte (*keys)[MFRC522::MF_KEY_SIZE], byte count);
+
+/**
+ * @brief Authenticate a block with Key A, probing the keyring
+ * @param rfid Reader, with the card selected (rfid->uid valid)
+ * @param block Block number
+ * @param status Status code of the last attempt (meaningful on failure)
+ * @return true if one of the keys was accepted
+ */
+bool keyringAuthenticate(TracedMFRC522 *rfid, byte block, MFRC522::StatusCode *status);
+
+/**
+ * @brief Authenticate a block with the first key of the ring only
+ * @details Used to verify a sector right after it has been re-keyed to the
+ *          preferred key. On success the card is cached with that key.
+ * @param rfid Reader, with the card selected
+ * @param block Block number
+ * @param status Status code of the attempt
+ * @return true if the preferred key was accepted
+ */
+bool keyringAuthenticatePreferred(TracedMFRC522 *rfid, byte block, MFRC522::StatusCode *status);
+
+/**
+ * @brief Wake up and select the current card again
+ * @details A failed authentication drops the card out of the selected state.
+ * @param rfid Reader (rfid->uid must hold the card UID)
+ * @return STATUS_OK if the card answered, an error if it left the field
+ */
+MFRC522::StatusCode reselectCard(TracedMFRC522 *rfid);
+
+/** @brief Copy the key bytes (6) of a ring entry out of flash */
+void keyringKey(byte index, byte *key);
+
+/** @brief Index in the ring of the key that authenticated the last block */
+byte keyringLastIndex();
+
+/** @brief Authentication counters since boot */
+const KeyringStats &keyringStats();
+
+/** @brief Print the authentication counters on serial */
+void printKeyringStats();
+
+#endif // RFID_KEYRING_H
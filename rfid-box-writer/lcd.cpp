@@ -13,7 +13,17 @@
 // INIZIALIZZAZIONE E CONFIGURAZIONE LCD
 // ============================================================================
 
-void lcd_init(LCD_I2C *lcd, const String &version)
+void lcd_init(LCD_I2C *lcd, const __FlashStringHelper *version)
+{
+    // Passo 1: Inizializzazione del display e visualizzazione del messaggio di benvenuto
+    lcd_splash(lcd, version);
+    // Passo 2: Pausa di 2 secondi per permettere all'utente di leggere il messaggio
+    delay(SPLASH_MS);
+    // Passo 3: Pulizia completa dello schermo per prepararlo all'uso normale
+    lcd->clear();
+}
+
+void lcd_splash(LCD_I2C *lcd, const __FlashStringHelper *version)
 {
     // Passo 1: Inizializzazione hardware del display LCD
     lcd->begin();
@@ -28,10 +38,6 @@ void lcd_init(LCD_I2C *lcd, const String &version)
     // Passo 6: Visualizzazione della versione del firmware
     lcd->print(F("Version "));
     lcd->print(version);
-    // Passo 7: Pausa di 2 secondi per permettere all'utente di leggere il messaggio
-    delay(2000);
-    // Passo 8: Pulizia completa dello schermo per prepararlo all'uso normale
-    lcd->clear();
 }
 
 // ============================================================================
@@ -107,6 +113,107 @@ void lcd_show_uid(LCD_I2C *lcd, const String &uid)
     lcd->noAutoscroll();
 }
 
+void lcd_uid_denied(LCD_I2C *lcd)
+{
+    // Passo 1: Pulizia completa del display per rimuovere contenuto precedente
+    lcd->clear();
+    // Passo 2: Posizionamento del cursore in posizione home (prima riga, prima colonna)
+    lcd->home();
+    // Passo 3: Visualizzazione del messaggio di accesso negato
+    lcd->print(F("ACCESS DENIED"));
+    // Passo 4: Spostamento alla seconda riga
+    lcd->setCursor(0, 1);
+    // Passo 5: Visualizzazione del motivo (carta revocata)
+    lcd->print(F("revoked card!"));
+}
+
+void lcd_uid_not_allowed(LCD_I2C *lcd)
+{
+    // Passo 1: Pulizia completa del display per rimuovere contenuto precedente
+    lcd->clear();
+    // Passo 2: Posizionamento del cursore in posizione home (prima riga, prima colonna)
+    lcd->home();
+    // Passo 3: Visualizzazione del messaggio di accesso negato
+    lcd->print(F("ACCESS DENIED"));
+    // Passo 4: Spostamento alla seconda riga
+    lcd->setCursor(0, 1);
+    // Passo 5: Visualizzazione del motivo (UID non in allowlist)
+    lcd->print(F("not allowlisted"));
+}
+
+void lcd_job_wrong_card(LCD_I2C *lcd)
+{
+    // Passo 1: Pulizia completa del display per rimuovere contenuto precedente
+    lcd->clear();
+    // Passo 2: Posizionamento del cursore in posizione home (prima riga, prima colonna)
+    lcd->home();
+    // Passo 3: Visualizzazione del job rifiutato
+    lcd->print(F("JOB REFUSED"));
+    // Passo 4: Spostamento alla seconda riga
+    lcd->setCursor(0, 1);
+    // Passo 5: Visualizzazione del motivo (UID diverso da quello atteso)
+    lcd->print(F("wrong card!"));
+}
+
+void lcd_clone_step(LCD_I2C *lcd, bool target, byte chunk)
+{
+    // Passo 1: Pulizia completa del display per rimuovere contenuto precedente
+    lcd->clear();
+    // Passo 2: Posizionamento del cursore in posizione home (prima riga, prima colonna)
+    lcd->home();
+    // Passo 3: Visualizzazione della carta da presentare
+    lcd->print(target ? F("CLONE: target") : F("CLONE: source"));
+    // Passo 4: Spostamento alla seconda riga
+    lcd->setCursor(0, 1);
+    // Passo 5: Visualizzazione del blocco da 64 byte in corso
+    lcd->print(F("chunk "));
+    lcd->print(chunk);
+}
+
+void lcd_clone_wrong_card(LCD_I2C *lcd)
+{
+    // Passo 1: Pulizia completa del display per rimuovere contenuto precedente
+    lcd->clear();
+    // Passo 2: Posizionamento del cursore in posizione home (prima riga, prima colonna)
+    lcd->home();
+    // Passo 3: Visualizzazione dell'intestazione di errore
+    lcd->print(F("CLONE"));
+    // Passo 4: Spostamento alla seconda riga
+    lcd->setCursor(0, 1);
+    // Passo 5: Visualizzazione del dettaglio dell'errore
+    lcd->print(F("wrong card!"));
+}
+
+void lcd_clone_done(LCD_I2C *lcd, byte unreadable)
+{
+    // Passo 1: Pulizia completa del display per rimuovere contenuto precedente
+    lcd->clear();
+    // Passo 2: Posizionamento del cursore in posizione home (prima riga, prima colonna)
+    lcd->home();
+    // Passo 3: Visualizzazione del messaggio di completamento
+    lcd->print(F("CLONE done"));
+    // Passo 4: Spostamento alla seconda riga
+    lcd->setCursor(0, 1);
+    // Passo 5: Visualizzazione dei blocchi non leggibili
+    lcd->print(F("unreadable: "));
+    lcd->print(unreadable);
+}
+
+void lcd_job(LCD_I2C *lcd, uint16_t id)
+{
+    // Passo 1: Pulizia completa del display per rimuovere contenuto precedente
+    lcd->clear();
+    // Passo 2: Posizionamento del cursore in posizione home (prima riga, prima colonna)
+    lcd->home();
+    // Passo 3: Visualizzazione dell'identificativo del job
+    lcd->print(F("HOST JOB #"));
+    lcd->print(id);
+    // Passo 4: Spostamento alla seconda riga
+    lcd->setCursor(0, 1);
+    // Passo 5: Richiesta di presentare la carta da programmare
+    lcd->print(F("present card"));
+}
+
 void lcd_authentication_error(LCD_I2C *lcd)
 {
     // Passo 1: Pulizia completa del display per rimuovere contenuto precedente
@@ -150,6 +257,34 @@ void lcd_invalid_passphrase(LCD_I2C *lcd)
     lcd->print(F("passphrase!"));
 }
 
+void lcd_blank_card(LCD_I2C *lcd)
+{
+    // Passo 1: Pulizia completa del display per rimuovere contenuto precedente
+    lcd->clear();
+    // Passo 2: Posizionamento del cursore in posizione home (prima riga, prima colonna)
+    lcd->home();
+    // Passo 3: Visualizzazione del messaggio di carta vuota
+    lcd->print(F("BLANK CARD"));
+    // Passo 4: Spostamento alla seconda riga
+    lcd->setCursor(0, 1);
+    // Passo 5: Visualizzazione del dettaglio dell'errore
+    lcd->print(F("no credential!"));
+}
+
+void lcd_uses_exhausted(LCD_I2C *lcd)
+{
+    // Passo 1: Pulizia completa del display per rimuovere contenuto precedente
+    lcd->clear();
+    // Passo 2: Posizionamento del cursore in posizione home (prima riga, prima colonna)
+    lcd->home();
+    // Passo 3: Visualizzazione del messaggio di accesso negato
+    lcd->print(F("ACCESS DENIED"));
+    // Passo 4: Spostamento alla seconda riga
+    lcd->setCursor(0, 1);
+    // Passo 5: Visualizzazione del motivo (ingressi esauriti)
+    lcd->print(F("no entries left"));
+}
+
 void lcd_EEPROM_writing_error(LCD_I2C *lcd)
 {
     // Passo 1: Pulizia completa del display per rimuovere contenuto precedente
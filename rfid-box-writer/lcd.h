@@ -23,9 +23,18 @@
 /**
  * @brief Inizializza il display LCD I2C
  * @param lcd Puntatore all'oggetto LCD_I2C
- * @param version Stringa contenente la versione del programma da visualizzare
+ * @param version Versione del programma da visualizzare, in flash (VERSION in data.h)
  */
-void lcd_init(LCD_I2C *lcd, const String &version);
+void lcd_init(LCD_I2C *lcd, const __FlashStringHelper *version);
+
+/**
+ * @brief Inizializza il display LCD I2C e mostra lo splash senza attendere
+ * @details Versione non bloccante di lcd_init(): la rimozione dello splash è
+ *          a carico del chiamante (es. con un DagTimer), usata dal FAST_BOOT.
+ * @param lcd Puntatore all'oggetto LCD_I2C
+ * @param version Versione del programma da visualizzare, in flash (VERSION in data.h)
+ */
+void lcd_splash(LCD_I2C *lcd, const __FlashStringHelper *version);
 
 /**
  * @brief Mostra lo stato di attesa (idle) del sistema
@@ -48,6 +57,52 @@ void lcd_compatibility_error(LCD_I2C *lcd);
  */
 void lcd_show_uid(LCD_I2C *lcd, const String &uid);
 
+/**
+ * @brief Visualizza il rifiuto di una carta revocata (UID in denylist)
+ * @param lcd Puntatore all'oggetto LCD_I2C
+ */
+void lcd_uid_denied(LCD_I2C *lcd);
+
+/**
+ * @brief Visualizza il rifiuto di una carta non in allowlist (UID_ALLOWLIST_ONLY)
+ * @param lcd Puntatore all'oggetto LCD_I2C
+ */
+void lcd_uid_not_allowed(LCD_I2C *lcd);
+
+/**
+ * @brief Visualizza il rifiuto di un job dell'host: la carta non è quella attesa
+ * @param lcd Puntatore all'oggetto LCD_I2C
+ */
+void lcd_job_wrong_card(LCD_I2C *lcd);
+
+/**
+ * @brief Visualizza la carta da presentare durante la clonazione
+ * @param lcd Puntatore all'oggetto LCD_I2C
+ * @param target true: carta di destinazione, false: carta sorgente
+ * @param chunk Numero del blocco da 64 byte in corso
+ */
+void lcd_clone_step(LCD_I2C *lcd, bool target, byte chunk);
+
+/**
+ * @brief Visualizza la presentazione della carta sbagliata durante la clonazione
+ * @param lcd Puntatore all'oggetto LCD_I2C
+ */
+void lcd_clone_wrong_card(LCD_I2C *lcd);
+
+/**
+ * @brief Visualizza la fine della clonazione
+ * @param lcd Puntatore all'oggetto LCD_I2C
+ * @param unreadable Numero di blocchi da 64 byte non leggibili (nessuna chiave valida)
+ */
+void lcd_clone_done(LCD_I2C *lcd, byte unreadable);
+
+/**
+ * @brief Visualizza il job di programmazione ricevuto dall'host
+ * @param lcd Puntatore all'oggetto LCD_I2C
+ * @param id Identificativo del job
+ */
+void lcd_job(LCD_I2C *lcd, uint16_t id);
+
 /**
  * @brief Visualizza errore di autenticazione della carta RFID
  * @param lcd Puntatore all'oggetto LCD_I2C
@@ -67,6 +122,18 @@ void lcd_read_block_error(LCD_I2C *lcd, byte block);
  */
 void lcd_invalid_passphrase(LCD_I2C *lcd);
 
+/**
+ * @brief Visualizza il rifiuto di una carta vuota (nessuna credenziale scritta)
+ * @param lcd Puntatore all'oggetto LCD_I2C
+ */
+void lcd_blank_card(LCD_I2C *lcd);
+
+/**
+ * @brief Visualizza il rifiuto di un badge a ingressi limitati senza ingressi residui
+ * @param lcd Puntatore all'oggetto LCD_I2C
+ */
+void lcd_uses_exhausted(LCD_I2C *lcd);
+
 /**
  * @brief Visualizza errore di scrittura EEPROM
  * @param lcd Puntatore all'oggetto LCD_I2C
@@ -0,0 +1,114 @@
+/**
+ * @file memory-stats.cpp
+ * @brief Implementation of the SRAM telemetry functions
+ * @author Dag
+ */
+
+#include "memory-stats.h"
+
+#ifdef __AVR__
+
+// Symbols provided by the linker script and avr-libc malloc
+extern uint8_t _end;        // End of .bss/.noinit: start of the heap
+extern uint8_t __stack;     // RAMEND: top of the stack
+extern char *__brkval;      // Current heap top (0 if malloc was never called)
+extern char __heap_start;   // Heap start
+
+struct __freelist
+{
+    size_t sz;
+    struct __freelist *nx;
+};
+extern struct __freelist *__flp; // malloc free list head
+
+/**
+ * @brief Paint the whole free SRAM with STACK_CANARY before main() runs
+ * @details Placed in .init1: no stack frame and no zero register are available yet,
+ *          so the loop is written in assembly. Paints from _end to __stack.
+ */
+void paintStack(void) __attribute__((naked)) __attribute__((used)) __attribute__((section(".init1")));
+
+void paintStack(void)
+{
+    __asm volatile("    ldi r30,lo8(_end)\n"
+                   "    ldi r31,hi8(_end)\n"
+                   "    ldi r24,lo8(0xc5)\n" // STACK_CANARY
+                   "    ldi r25,hi8(__stack)\n"
+                   "    rjmp 2f\n"
+                   "1:  st Z+,r24\n"
+                   "2:  cpi r30,lo8(__stack)\n"
+                   "    cpc r31,r25\n"
+                   "    brlo 1b\n"
+                   "    breq 1b\n" ::);
+}
+
+/** @brief Current heap top */
+static uint8_t *heapTop()
+{
+    return __brkval == 0 ? (uint8_t *)&__heap_start : (uint8_t *)__brkval;
+}
+
+/** @brief Address of the lowest stack byte ever written */
+static uint8_t *stackLowWater()
+{
+    uint8_t *p = heapTop();
+    while (p <= &__stack && *p == STACK_CANARY)
+        p++;
+    return p;
+}
+
+uint16_t stackPeakUsage()
+{
+    return &__stack - stackLowWater() + 1;
+}
+
+uint16_t stackUnusedBytes()
+{
+    return stackLowWater() - heapTop();
+}
+
+uint16_t freeHeap()
+{
+    uint8_t top; // Its address is the current stack pointer
+    uint16_t total = &top - heapTop();
+
+    for (struct __freelist *chunk = __flp; chunk; chunk = chunk->nx)
+        total += chunk->sz + sizeof(size_t);
+
+    return total;
+}
+
+uint16_t largestFreeBlock()
+{
+    uint8_t top;
+    uint16_t largest = &top - heapTop();
+
+    for (struct __freelist *chunk = __flp; chunk; chunk = chunk->nx)
+        if (chunk->sz > largest)
+            largest = chunk->sz;
+
+    return largest;
+}
+
+#else
+
+uint16_t stackPeakUsage() { return 0; }
+uint16_t stackUnusedBytes() { return 0; }
+uint16_t freeHeap() { return 0; }
+uint16_t largestFreeBlock() { return 0; }
+
+#endif // __AVR__
+
+void printMemoryStats()
+{
+    Serial.print(F("Stack peak: "));
+    Serial.print(stackPeakUsage());
+    Serial.print(F(" B, untouched margin: "));
+    Serial.print(stackUnusedBytes());
+    Serial.println(F(" B"));
+    Serial.print(F("Free heap: "));
+    Serial.print(freeHeap());
+    Serial.print(F(" B, largest free block: "));
+    Serial.print(largestFreeBlock());
+    Serial.println(F(" B"));
+}
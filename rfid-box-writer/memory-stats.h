@@ -0,0 +1,60 @@
+/**
+ * @file memory-stats.h
+ * @brief Runtime SRAM telemetry: stack high-water mark and free heap
+ * @details On the ATmega328 the heap (String globals, MFRC522/LCD objects) grows up
+ *          from the end of .bss while the stack grows down from RAMEND: when they meet
+ *          the device reboots at random. At reset the whole free area is painted with
+ *          a canary byte (see memory-stats.cpp, .init1 section); scanning for the first
+ *          overwritten byte gives the deepest stack excursion since boot.
+ *
+ *          On non-AVR targets (host builds) every function returns 0.
+ * @author Dag
+ */
+
+#ifndef RFID_MEMORY_STATS_H
+#define RFID_MEMORY_STATS_H
+
+#include "Arduino.h"
+
+/**
+ * @brief Canary value painted between heap and stack at reset
+ */
+const uint8_t STACK_CANARY = 0xC5;
+
+/**
+ * @brief Peak stack usage since reset
+ * @details Scans the painted area from the current heap top upward and returns the
+ *          distance from the first overwritten byte to RAMEND.
+ * @return Maximum number of stack bytes ever used
+ */
+uint16_t stackPeakUsage();
+
+/**
+ * @brief Painted bytes never touched by the stack since reset
+ * @details Margin that was still left between heap and stack at the worst moment.
+ *          A value approaching 0 means a stack/heap collision is imminent.
+ * @return Number of untouched canary bytes above the heap top
+ */
+uint16_t stackUnusedBytes();
+
+/**
+ * @brief Total free heap
+ * @details Gap between heap top and stack pointer plus every chunk in the malloc free list.
+ * @return Free bytes available to malloc (fragmented)
+ */
+uint16_t freeHeap();
+
+/**
+ * @brief Largest single allocation that can currently succeed
+ * @details Maximum between the heap/stack gap and the biggest free-list chunk.
+ * @return Size in bytes of the largest free block
+ */
+uint16_t largestFreeBlock();
+
+/**
+ * @brief Print the memory report on Serial
+ * @details Output: stack peak, untouched stack margin, free heap, largest free block.
+ */
+void printMemoryStats();
+
+#endif // RFID_MEMORY_STATS_H
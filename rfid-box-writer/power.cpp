@@ -0,0 +1,194 @@
+/**
+ * @file power.cpp
+ * @brief Implementation of the idle low-power policy
+ * @author Dag
+ */
+
+#include "power.h"
+#include "config.h"
+#include "def.h"
+
+#ifdef __AVR__
+#include <avr/eeprom.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+
+extern volatile unsigned long timer0_millis; // Arduino core (wiring.c)
+extern volatile unsigned long timer0_overflow_count;
+
+static volatile bool tickFired = false; // Woken by the watchdog, not by a pin
+static byte pcicrMask = 0;              // PCICR groups of the wake pins
+
+ISR(WDT_vect)
+{
+    tickFired = true;
+}
+
+// Pin-change wake: nothing to do, the loop polls buttons and serial itself
+EMPTY_INTERRUPT(PCINT0_vect);
+EMPTY_INTERRUPT(PCINT1_vect);
+EMPTY_INTERRUPT(PCINT2_vect);
+#endif
+
+static const byte NO_TICK = 0xFF;
+static byte tickIndex = NO_TICK; // Watchdog prescaler: 16 ms << tickIndex
+
+static unsigned long startMs = 0;
+static unsigned long sleptMs = 0;     // Watchdog ticks slept
+static unsigned long sleeps = 0;
+static unsigned long pinWakes = 0;    // Sleeps ended early by a pin change
+static unsigned long lastRxMs = 0;
+static bool rxSeen = false;           // lastRxMs is meaningful
+static bool woke = false;             // The last idle iteration slept
+static unsigned long wakeUs = 0;
+static unsigned long lastLatencyUs = 0;
+static unsigned long maxLatencyUs = 0;
+
+void powerInit()
+{
+    startMs = millis();
+    if (!LOW_POWER_IDLE)
+        return;
+
+    for (int i = 6; i >= 0; i--) // 1 s down to 16 ms
+        if ((16UL << i) + POWER_POLL_MS <= IDLE_WAKE_LATENCY_MS)
+        {
+            tickIndex = i;
+            break;
+        }
+
+#ifdef __AVR__
+    const int pins[] = {BTN_MODE_PIN, BTN_RESET_PIN, 0, RFID_IRQ_PIN}; // 0: RX
+    for (byte i = 0; i < sizeof(pins) / sizeof(pins[0]); i++)
+    {
+        if (pins[i] < 0)
+            continue;
+        *digitalPinToPCMSK(pins[i]) |= _BV(digitalPinToPCMSKbit(pins[i]));
+        pcicrMask |= _BV(digitalPinToPCICRbit(pins[i]));
+    }
+#endif
+}
+
+uint16_t powerTickMs()
+{
+    return tickIndex == NO_TICK ? 0 : 16 << tickIndex;
+}
+
+void powerKeepAwake()
+{
+    lastRxMs = millis();
+    rxSeen = true;
+}
+
+void powerIdle(bool busy)
+{
+    woke = false;
+    if (!LOW_POWER_IDLE || tickIndex == NO_TICK || busy)
+        return;
+    if (rxSeen && millis() - lastRxMs < POWER_AWAKE_AFTER_RX_MS)
+        return;
+    rxSeen = false;
+
+    unsigned long tick = powerTickMs();
+
+#ifdef __AVR__
+    if (!eeprom_is_ready())
+        return; // Last cell of an audit record or counter flush still being written
+
+    Serial.flush(); // The UART stops in power-down
+    byte adc = ADCSRA;
+    ADCSRA = 0;
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+
+    cli();
+    tickFired = false;
+    wdt_reset();
+    MCUSR &= ~_BV(WDRF);
+    WDTCSR = _BV(WDCE) | _BV(WDE);
+    WDTCSR = _BV(WDIE) | tickIndex; // Interrupt only, no reset
+    PCIFR = pcicrMask;              // Drop stale pin changes
+    PCICR |= pcicrMask;
+    sleep_enable();
+#ifdef sleep_bod_disable
+    sleep_bod_disable();
+#endif
+    sei();
+    sleep_cpu();
+
+    sleep_disable();
+    PCICR &= ~pcicrMask;
+    wdt_disable();
+    ADCSRA = adc;
+
+    if (tickFired)
+    {
+        cli();
+        timer0_millis += tick;
+        timer0_overflow_count += tick * 125 / 128; // One overflow every 1.024 ms
+        sei();
+        sleptMs += tick;
+    }
+    else
+        pinWakes++;
+#else
+    delay(tick); // Host build: the clock jumps as if the MCU had slept
+    sleptMs += tick;
+#endif
+
+    sleeps++;
+    woke = true;
+    wakeUs = micros();
+}
+
+void powerCardDetected()
+{
+    if (!woke)
+        return; // Detected while awake: no wake latency
+
+    lastLatencyUs = micros() - wakeUs;
+    if (lastLatencyUs > maxLatencyUs)
+        maxLatencyUs = lastLatencyUs;
+    woke = false;
+}
+
+void printPowerStats()
+{
+    if (powerTickMs() == 0)
+    {
+        Serial.println(LOW_POWER_IDLE ? F("Power: no sleep, IDLE_WAKE_LATENCY_MS below one tick")
+                                      : F("Power: idle sleep off"));
+        return;
+    }
+
+    unsigned long total = millis() - startMs;
+    unsigned long slept = min(sleptMs, total);
+    unsigned long permille = total == 0 ? 0 : total >= 1000000UL ? slept / (total / 1000) : slept * 1000 / total;
+    unsigned long averageUa = (AWAKE_CURRENT_UA * (1000 - permille) + ASLEEP_CURRENT_UA * permille) / 1000;
+
+    Serial.print(F("Power: asleep "));
+    Serial.print(permille / 10);
+    Serial.print('.');
+    Serial.print(permille % 10);
+    Serial.print(F("% sleeps: "));
+    Serial.print(sleeps);
+    Serial.print(F(" early wakes: "));
+    Serial.print(pinWakes);
+    Serial.print(F(" estimated average: "));
+    Serial.print(averageUa / 1000);
+    Serial.print('.');
+    Serial.print(averageUa % 1000 / 100);
+    Serial.println(F(" mA"));
+
+    Serial.print(F("Detection: tick "));
+    Serial.print(powerTickMs());
+    Serial.print(F(" ms + poll "));
+    Serial.print(POWER_POLL_MS);
+    Serial.print(F(" ms (bound "));
+    Serial.print(IDLE_WAKE_LATENCY_MS);
+    Serial.print(F(" ms) wake to detect: last "));
+    Serial.print(lastLatencyUs);
+    Serial.print(F(" us max "));
+    Serial.print(maxLatencyUs);
+    Serial.println(F(" us"));
+}
@@ -0,0 +1,63 @@
+/**
+ * @file power.h
+ * @brief Idle low-power policy (LOW_POWER_IDLE, config.h)
+ * @details With no card in the field loop() only polls the reader, which on a mains
+ *          box costs nothing but on battery or PoE budgets is most of the energy.
+ *          When the firmware is idle the MCU is put in power-down for one watchdog
+ *          tick, then polls once more. It wakes early on:
+ *          - a button press (pin change on BTN_MODE_PIN / BTN_RESET_PIN)
+ *          - a byte from the host (pin change on RX): the byte that wakes the MCU is
+ *            usually lost, the framed protocols resend; the box then stays awake for
+ *            POWER_AWAKE_AFTER_RX_MS so the rest of the traffic is received normally
+ *          - the reader IRQ line, when wired (RFID_IRQ_PIN, def.h)
+ *
+ *          The MFRC522 has no autonomous card detection: cards are found by the poll
+ *          after each tick. The tick is the longest watchdog period that, plus an
+ *          empty-field poll (REQA timeout, POWER_POLL_MS), keeps card detection
+ *          within IDLE_WAKE_LATENCY_MS.
+ *
+ *          Timer0 stops in power-down: millis() and micros() are moved forward by
+ *          the tick after each watchdog wake, so timers and TTLs keep their meaning
+ *          (the watchdog oscillator is only accurate to about 10%). A pin-change
+ *          wake adds nothing, the time slept is unknown.
+ *
+ *          Reported with "stats": share of time asleep, average current estimated
+ *          from AWAKE_CURRENT_UA / ASLEEP_CURRENT_UA (config.h), and the measured
+ *          wake-to-detect latency. On host builds the sleep is modeled with delay().
+ * @author Dag
+ */
+
+#ifndef RFID_POWER_H
+#define RFID_POWER_H
+
+#include "Arduino.h"
+
+const unsigned long POWER_POLL_MS = 25;            // MFRC522 REQA timeout on an empty field
+const unsigned long POWER_AWAKE_AFTER_RX_MS = 2000; // Host traffic keeps the box awake this long
+
+/**
+ * @brief Pick the watchdog tick and prepare the wake sources
+ * @details Called once at boot.
+ */
+void powerInit();
+
+/** @brief Watchdog tick used between polls, 0 if the box never sleeps */
+uint16_t powerTickMs();
+
+/** @brief Serial traffic: stay awake for POWER_AWAKE_AFTER_RX_MS */
+void powerKeepAwake();
+
+/**
+ * @brief End of an idle loop() iteration: sleep until the next tick or wake event
+ * @param busy The firmware has work in progress (boot tasks, partial command or
+ *             frame, button held): stay awake
+ */
+void powerIdle(bool busy);
+
+/** @brief A card was detected: record the latency from the last wake */
+void powerCardDetected();
+
+/** @brief Print time asleep, estimated average current and detection latency */
+void printPowerStats();
+
+#endif // RFID_POWER_H
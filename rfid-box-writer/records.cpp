@@ -0,0 +1,227 @@
+/**
+ * @file records.cpp
+ * @brief Implementation of the TLV card payload
+ * @author Dag
+ */
+
+#include "records.h"
+
+// Magic bytes identifying a records payload
+static const byte RECORDS_MAGIC[2] = {'T', 'L'};
+
+enum TlvState : byte
+{
+    TLV_TYPE,   // Next byte is a record type
+    TLV_LENGTH, // Next byte is the value length
+    TLV_VALUE,  // Next bytes belong to the value
+    TLV_END     // REC_END walked
+};
+
+enum RecordsResult : byte
+{
+    RECORDS_PENDING, // Credential not reached yet
+    RECORDS_VALID,   // Credential matched
+    RECORDS_INVALID  // Credential mismatch, missing or malformed
+};
+
+// ============================================================================
+// TLV PARSER
+// ============================================================================
+
+void tlvBegin(TlvParser *p)
+{
+    p->state = TLV_TYPE;
+    p->type = REC_END;
+    p->length = 0;
+    p->offset = 0;
+}
+
+bool tlvNext(TlvParser *p, const byte *data, byte size, byte *pos, TlvChunk *chunk)
+{
+    while (*pos < size && p->state != TLV_END)
+    {
+        if (p->state == TLV_TYPE)
+        {
+            p->type = data[(*pos)++];
+            p->state = p->type == REC_END ? TLV_END : TLV_LENGTH;
+            continue;
+        }
+
+        if (p->state == TLV_LENGTH)
+        {
+            p->length = data[(*pos)++];
+            p->offset = 0;
+            p->state = TLV_VALUE;
+            if (p->length > 0)
+                continue;
+        }
+
+        // Value bytes of this block, in place
+        byte count = min(p->length - p->offset, size - *pos);
+        chunk->type = p->type;
+        chunk->length = p->length;
+        chunk->offset = p->offset;
+        chunk->data = data + *pos;
+        chunk->size = count;
+
+        *pos += count;
+        p->offset += count;
+        if (p->offset == p->length)
+            p->state = TLV_TYPE;
+        return true;
+    }
+    return false;
+}
+
+bool tlvEnded(const TlvParser *p)
+{
+    return p->state == TLV_END;
+}
+
+// ============================================================================
+// CARD RECORDS
+// ============================================================================
+
+/** @brief Add the bytes of a value slice to a little endian field */
+static uint32_t addBytes(uint32_t value, const TlvChunk *chunk, byte fieldSize)
+{
+    for (byte i = 0; i < chunk->size && chunk->offset + i < fieldSize; i++)
+        value |= (uint32_t)chunk->data[i] << (8 * (chunk->offset + i));
+    return value;
+}
+
+/** @brief Decode a value slice of a known field, unknown types are ignored */
+static void decodeField(CardRecords *records, const TlvChunk *chunk)
+{
+    byte fieldSize;
+
+    switch (chunk->type)
+    {
+    case REC_BADGE_ID:
+        fieldSize = sizeof(records->badgeId);
+        records->badgeId = addBytes(records->badgeId, chunk, fieldSize);
+        break;
+    case REC_PERMISSIONS:
+        fieldSize = sizeof(records->permissions);
+        records->permissions = addBytes(records->permissions, chunk, fieldSize);
+        break;
+    case REC_ISSUE:
+        fieldSize = sizeof(records->issue);
+        records->issue = addBytes(records->issue, chunk, fieldSize);
+        break;
+    default:
+        return;
+    }
+
+    if (chunk->offset + chunk->size == chunk->length && chunk->length == fieldSize)
+        records->present |= recordBit(chunk->type);
+}
+
+bool recordsHeader(const byte *block, byte *version)
+{
+    *version = block[3];
+    return block[0] == RECORDS_MAGIC[0] && block[1] == RECORDS_MAGIC[1] && block[2] == RECORDS_VERSION;
+}
+
+void recordsBegin(RecordsReader *r, const byte *key, const MFRC522::Uid &uid)
+{
+    tlvBegin(&r->parser);
+    siphashBegin(&r->mac, key);
+    siphashUpdate(&r->mac, &uid.size, 1);
+    siphashUpdate(&r->mac, uid.uidByte, uid.size);
+    r->diff = 0;
+    r->blocks = 0;
+    r->result = RECORDS_PENDING;
+    memset(&r->records, 0, sizeof(r->records));
+}
+
+bool recordsFeed(RecordsReader *r, const byte *block)
+{
+    byte pos = 0;
+    TlvChunk chunk;
+
+    if (r->blocks++ == 0)
+    {
+        siphashUpdate(&r->mac, block, RECORDS_HEADER_SIZE);
+        pos = RECORDS_HEADER_SIZE;
+    }
+
+    while (r->result == RECORDS_PENDING && tlvNext(&r->parser, block, 16, &pos, &chunk))
+    {
+        if (chunk.offset == 0)
+        {
+            byte typeLength[2] = {chunk.type, chunk.length};
+            siphashUpdate(&r->mac, typeLength, 2);
+        }
+
+        if (chunk.type != REC_CREDENTIAL)
+        {
+            siphashUpdate(&r->mac, chunk.data, chunk.size);
+            decodeField(&r->records, &chunk);
+            continue;
+        }
+
+        if (chunk.length != UID_MAC_SIZE)
+        {
+            r->result = RECORDS_INVALID;
+            break;
+        }
+        if (chunk.offset == 0)
+            siphashEnd(&r->mac, r->expected); // Everything before the MAC value
+
+        // Constant-time comparison, across block boundaries
+        for (byte i = 0; i < chunk.size; i++)
+            r->diff |= chunk.data[i] ^ r->expected[chunk.offset + i];
+        if (chunk.offset + chunk.size == chunk.length)
+            r->result = r->diff == 0 ? RECORDS_VALID : RECORDS_INVALID;
+    }
+
+    if (r->result == RECORDS_PENDING && tlvEnded(&r->parser))
+        r->result = RECORDS_INVALID; // No credential record
+    return r->result == RECORDS_PENDING;
+}
+
+bool recordsValid(const RecordsReader *r)
+{
+    return r->result == RECORDS_VALID;
+}
+
+/** @brief Append a little endian field record */
+static byte putField(byte *out, byte length, byte type, uint32_t value, byte size)
+{
+    out[length++] = type;
+    out[length++] = size;
+    for (byte i = 0; i < size; i++)
+        out[length++] = (byte)(value >> (8 * i));
+    return length;
+}
+
+byte buildRecords(const CardRecords *records, const byte *key, byte version, const MFRC522::Uid &uid, byte *out)
+{
+    byte length = 0;
+    out[length++] = RECORDS_MAGIC[0];
+    out[length++] = RECORDS_MAGIC[1];
+    out[length++] = RECORDS_VERSION;
+    out[length++] = version;
+
+    if (records->present & recordBit(REC_BADGE_ID))
+        length = putField(out, length, REC_BADGE_ID, records->badgeId, sizeof(records->badgeId));
+    if (records->present & recordBit(REC_PERMISSIONS))
+        length = putField(out, length, REC_PERMISSIONS, records->permissions, sizeof(records->permissions));
+    if (records->present & recordBit(REC_ISSUE))
+        length = putField(out, length, REC_ISSUE, records->issue, sizeof(records->issue));
+
+    out[length++] = REC_CREDENTIAL;
+    out[length++] = UID_MAC_SIZE;
+
+    SipHash mac;
+    siphashBegin(&mac, key);
+    siphashUpdate(&mac, &uid.size, 1);
+    siphashUpdate(&mac, uid.uidByte, uid.size);
+    siphashUpdate(&mac, out, length);
+    siphashEnd(&mac, out + length);
+    length += UID_MAC_SIZE;
+
+    out[length++] = REC_END;
+    return length;
+}
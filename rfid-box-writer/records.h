@@ -0,0 +1,176 @@
+/**
+ * @file records.h
+ * @brief Typed TLV card payload (CREDENTIAL_RECORDS mode)
+ * @details The card carries several typed fields instead of a single string: a
+ *          header, then type | length | value records spread across the data blocks
+ *          in blocks[] order. Records may cross block boundaries.
+ *
+ * Payload layout:
+ * -----------------------------------------------------------------
+ * Byte   0-1   Magic 'T' 'L'
+ * Byte   2     Format version (RECORDS_VERSION)
+ * Byte   3     Secret version (secret-ring.h), 0 = unversioned
+ * Byte   4-    Records: type (1) | length (1) | value (length), ended by REC_END
+ * -----------------------------------------------------------------
+ *
+ * Record types (integers little endian):
+ * REC_BADGE_ID     4 bytes  badge number
+ * REC_PERMISSIONS  2 bytes  permission bits, one per door group (DOOR_PERMISSIONS)
+ * REC_ISSUE        2 bytes  how many times the badge was written
+ * REC_CREDENTIAL   8 bytes  SipHash-2-4(key, UID size | UID | every payload byte
+ *                           before the MAC value)
+ *
+ * The credential closes the authenticated part: validation stops reading blocks as
+ * soon as it is complete, records after it are never read. Unknown types are skipped.
+ *
+ * The parser walks the raw block buffers in place: each call returns a slice of the
+ * block being walked, nothing is copied into a String or a payload buffer.
+ * @author Dag
+ */
+
+#ifndef RFID_RECORDS_H
+#define RFID_RECORDS_H
+
+#include "Arduino.h"
+#include <MFRC522.h>
+#include "credential.h"
+
+// ============================================================================
+// RECORD CONSTANTS
+// ============================================================================
+
+const byte RECORDS_VERSION = 1;     // Payload format version
+const byte RECORDS_HEADER_SIZE = 4; // Magic, format version, secret version
+const byte RECORDS_MAX_SIZE = 32;   // buildRecords() output: 2 blocks
+
+/**
+ * @brief Record types
+ */
+enum RecordType : byte
+{
+    REC_END = 0x00,         // End of the records, no length byte
+    REC_BADGE_ID = 0x01,    // uint32_t
+    REC_PERMISSIONS = 0x02, // uint16_t bits
+    REC_ISSUE = 0x03,       // uint16_t
+    REC_CREDENTIAL = 0x7F   // UID_MAC_SIZE bytes MAC
+};
+
+/** @brief Bit of a record type in CardRecords::present */
+inline byte recordBit(byte type) { return 1 << type; }
+
+/**
+ * @brief Fields decoded from a card
+ */
+struct CardRecords
+{
+    uint32_t badgeId;     // REC_BADGE_ID
+    uint16_t permissions; // REC_PERMISSIONS
+    uint16_t issue;       // REC_ISSUE
+    byte present;         // recordBit() of each field found
+};
+
+// ============================================================================
+// TLV PARSER
+// ============================================================================
+
+/**
+ * @brief Incremental TLV parser state, carried from one block to the next
+ */
+struct TlvParser
+{
+    byte state;  // Next byte expected: type, length or value (TlvState in records.cpp)
+    byte type;   // Record being walked
+    byte length; // Its value length
+    byte offset; // Value bytes already returned
+};
+
+/**
+ * @brief Slice of a record value inside the block being walked
+ */
+struct TlvChunk
+{
+    byte type;        // Record type
+    byte length;      // Full value length
+    byte offset;      // Position of data in the value
+    const byte *data; // Points into the block buffer
+    byte size;        // Bytes of the value in this block
+};
+
+/** @brief Start walking the records */
+void tlvBegin(TlvParser *p);
+
+/**
+ * @brief Next value slice of a block
+ * @details A record longer than what is left of the block is returned in pieces, one
+ *          per block; a record without value is returned once with size 0.
+ * @param p Parser state
+ * @param data Block buffer
+ * @param size Bytes in the buffer
+ * @param pos Walk position in the buffer, advanced past the returned slice
+ * @param chunk Destination of the slice
+ * @return true if a slice was returned, false at the end of the block or of the records
+ */
+bool tlvNext(TlvParser *p, const byte *data, byte size, byte *pos, TlvChunk *chunk);
+
+/** @brief true once REC_END was walked */
+bool tlvEnded(const TlvParser *p);
+
+// ============================================================================
+// CARD RECORDS
+// ============================================================================
+
+/**
+ * @brief Validation of the records, fed one block at a time
+ */
+struct RecordsReader
+{
+    TlvParser parser;
+    SipHash mac;                    // Running MAC over UID and payload
+    byte expected[UID_MAC_SIZE];    // MAC computed when the credential record starts
+    byte diff;                      // Mismatching bits of the credential so far
+    byte blocks;                    // Blocks fed
+    byte result;                    // RecordsResult (records.cpp)
+    CardRecords records;            // Fields decoded so far
+};
+
+/**
+ * @brief Check the payload header in the first block
+ * @param block First data block (16 bytes)
+ * @param version Secret version of the card
+ * @return true if the block starts a records payload of this format
+ */
+bool recordsHeader(const byte *block, byte *version);
+
+/**
+ * @brief Start validating the records of a card
+ * @param r Reader state
+ * @param key Device key of the card secret version (MAC_KEY_SIZE bytes)
+ * @param uid UID of the card
+ */
+void recordsBegin(RecordsReader *r, const byte *key, const MFRC522::Uid &uid);
+
+/**
+ * @brief Walk one more block, first block first
+ * @param r Reader state
+ * @param block Block content (16 bytes)
+ * @return true if more blocks are needed, false once the credential was checked or
+ *         the records are malformed
+ */
+bool recordsFeed(RecordsReader *r, const byte *block);
+
+/** @brief true if the credential record matched (r->records then holds the fields) */
+bool recordsValid(const RecordsReader *r);
+
+/**
+ * @brief Build the payload of a card
+ * @details Header, the fields of records->present, then the credential and REC_END.
+ * @param records Fields to write
+ * @param key Device key (MAC_KEY_SIZE bytes)
+ * @param version Secret version of the key
+ * @param uid UID of the card
+ * @param out Destination (RECORDS_MAX_SIZE bytes)
+ * @return Payload length
+ */
+byte buildRecords(const CardRecords *records, const byte *key, byte version, const MFRC522::Uid &uid, byte *out);
+
+#endif // RFID_RECORDS_H
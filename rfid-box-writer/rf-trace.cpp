@@ -0,0 +1,193 @@
+/**
+ * @file rf-trace.cpp
+ * @brief Implementation of the RF trace recorder
+ * @author Dag
+ */
+
+#include "rf-trace.h"
+#include "config.h"
+#include "frame.h"
+
+static TraceRecord ring[RF_TRACE_SIZE];
+static byte head = 0;  // Oldest record
+static byte count = 0; // Records in the ring
+
+/** @brief Start time of a command, only read when tracing */
+static unsigned long traceStart()
+{
+    return RF_TRACE ? micros() : 0;
+}
+
+static byte xorBytes(const byte *data, byte length)
+{
+    byte check = 0;
+    for (byte i = 0; i < length; i++)
+        check ^= data[i];
+    return check;
+}
+
+/** @brief Append a record, overwriting the oldest one when the ring is full */
+static MFRC522::StatusCode record(byte op, byte arg, MFRC522::StatusCode status, byte check, unsigned long start)
+{
+    if (!RF_TRACE)
+        return status;
+
+    unsigned long elapsed = micros() - start;
+    TraceRecord *r = &ring[(head + count) % RF_TRACE_SIZE];
+    if (count < RF_TRACE_SIZE)
+        count++;
+    else
+        head = (head + 1) % RF_TRACE_SIZE;
+
+    r->op = op;
+    r->arg = arg;
+    r->status = status;
+    r->check = check;
+    r->micros = elapsed > 0xFFFF ? 0xFFFF : elapsed;
+    return status;
+}
+
+// ============================================================================
+// TRACED COMMANDS
+// ============================================================================
+
+MFRC522::StatusCode TracedMFRC522::PICC_Select(Uid *uid, byte validBits)
+{
+    unsigned long start = traceStart();
+    StatusCode status = MFRC522::PICC_Select(uid, validBits);
+    return record(TRACE_OP_SELECT, uid->size, status, status == STATUS_OK ? xorBytes(uid->uidByte, uid->size) : 0, start);
+}
+
+MFRC522::StatusCode TracedMFRC522::PICC_WakeupA(byte *bufferATQA, byte *bufferSize)
+{
+    unsigned long start = traceStart();
+    return record(TRACE_OP_WAKEUP, 0, MFRC522::PICC_WakeupA(bufferATQA, bufferSize), 0, start);
+}
+
+MFRC522::StatusCode TracedMFRC522::PICC_HaltA()
+{
+    unsigned long start = traceStart();
+    return record(TRACE_OP_HALT, 0, MFRC522::PICC_HaltA(), 0, start);
+}
+
+MFRC522::StatusCode TracedMFRC522::PCD_Authenticate(byte command, byte blockAddr, MIFARE_Key *key, Uid *uid)
+{
+    unsigned long start = traceStart();
+    return record(command, blockAddr, MFRC522::PCD_Authenticate(command, blockAddr, key, uid), 0, start);
+}
+
+MFRC522::StatusCode TracedMFRC522::MIFARE_Read(byte blockAddr, byte *buffer, byte *bufferSize)
+{
+    unsigned long start = traceStart();
+    StatusCode status = MFRC522::MIFARE_Read(blockAddr, buffer, bufferSize);
+    return record(TRACE_OP_READ, blockAddr, status, status == STATUS_OK ? xorBytes(buffer, 16) : 0, start);
+}
+
+MFRC522::StatusCode TracedMFRC522::MIFARE_Write(byte blockAddr, byte *buffer, byte bufferSize)
+{
+    unsigned long start = traceStart();
+    StatusCode status = MFRC522::MIFARE_Write(blockAddr, buffer, bufferSize);
+    return record(TRACE_OP_WRITE, blockAddr, status, xorBytes(buffer, bufferSize), start);
+}
+
+MFRC522::StatusCode TracedMFRC522::MIFARE_Ultralight_Write(byte page, byte *buffer, byte bufferSize)
+{
+    unsigned long start = traceStart();
+    StatusCode status = MFRC522::MIFARE_Ultralight_Write(page, buffer, bufferSize);
+    return record(TRACE_OP_UL_WRITE, page, status, xorBytes(buffer, bufferSize), start);
+}
+
+MFRC522::StatusCode TracedMFRC522::MIFARE_Decrement(byte blockAddr, int32_t delta)
+{
+    unsigned long start = traceStart();
+    return record(TRACE_OP_DECREMENT, blockAddr, MFRC522::MIFARE_Decrement(blockAddr, delta), xorBytes((const byte *)&delta, 4), start);
+}
+
+MFRC522::StatusCode TracedMFRC522::MIFARE_Increment(byte blockAddr, int32_t delta)
+{
+    unsigned long start = traceStart();
+    return record(TRACE_OP_INCREMENT, blockAddr, MFRC522::MIFARE_Increment(blockAddr, delta), xorBytes((const byte *)&delta, 4), start);
+}
+
+MFRC522::StatusCode TracedMFRC522::MIFARE_Restore(byte blockAddr)
+{
+    unsigned long start = traceStart();
+    return record(TRACE_OP_RESTORE, blockAddr, MFRC522::MIFARE_Restore(blockAddr), 0, start);
+}
+
+MFRC522::StatusCode TracedMFRC522::MIFARE_Transfer(byte blockAddr)
+{
+    unsigned long start = traceStart();
+    return record(TRACE_OP_TRANSFER, blockAddr, MFRC522::MIFARE_Transfer(blockAddr), 0, start);
+}
+
+// Value block helpers: same frames as the library, through the traced read / write
+
+MFRC522::StatusCode TracedMFRC522::MIFARE_GetValue(byte blockAddr, int32_t *value)
+{
+    byte buffer[18];
+    byte size = sizeof(buffer);
+    StatusCode status = MIFARE_Read(blockAddr, buffer, &size);
+    if (status == STATUS_OK)
+        *value = (int32_t)((uint32_t)buffer[3] << 24 | (uint32_t)buffer[2] << 16 | (uint32_t)buffer[1] << 8 | buffer[0]);
+    return status;
+}
+
+MFRC522::StatusCode TracedMFRC522::MIFARE_SetValue(byte blockAddr, int32_t value)
+{
+    byte buffer[16];
+    for (byte i = 0; i < 4; i++)
+    {
+        buffer[i] = buffer[8 + i] = (byte)(value >> (8 * i));
+        buffer[4 + i] = ~buffer[i];
+    }
+    buffer[12] = buffer[14] = blockAddr;
+    buffer[13] = buffer[15] = ~blockAddr;
+    return MIFARE_Write(blockAddr, buffer, 16);
+}
+
+MFRC522::StatusCode TracedMFRC522::PCD_NTAG216_AUTH(byte *passWord, byte pACK[])
+{
+    unsigned long start = traceStart();
+    return record(TRACE_OP_PWD_AUTH, 0, MFRC522::PCD_NTAG216_AUTH(passWord, pACK), 0, start);
+}
+
+MFRC522::StatusCode TracedMFRC522::PCD_TransceiveData(byte *sendData, byte sendLen, byte *backData, byte *backLen,
+                                                      byte *validBits, byte rxAlign, bool checkCRC)
+{
+    unsigned long start = traceStart();
+    StatusCode status = MFRC522::PCD_TransceiveData(sendData, sendLen, backData, backLen, validBits, rxAlign, checkCRC);
+    return record(TRACE_OP_TRANSCEIVE, sendData[0], status, status == STATUS_OK ? xorBytes(backData, *backLen) : 0, start);
+}
+
+// ============================================================================
+// EXPORT
+// ============================================================================
+
+byte traceCount()
+{
+    return count;
+}
+
+void traceClear()
+{
+    head = 0;
+    count = 0;
+}
+
+void traceExport(Print *out)
+{
+    FrameWriter frame(out);
+    frame.begin(FRAME_TRACE, count * sizeof(TraceRecord));
+    for (byte i = 0; i < count; i++)
+    {
+        const TraceRecord &r = ring[(head + i) % RF_TRACE_SIZE];
+        frame.write(r.op);
+        frame.write(r.arg);
+        frame.write(r.status);
+        frame.write(r.check);
+        frame.write(r.micros & 0xFF);
+        frame.write(r.micros >> 8);
+    }
+    frame.end();
+}
@@ -0,0 +1,110 @@
+/**
+ * @file rf-trace.h
+ * @brief RF trace recorder
+ * @details With RF_TRACE (config.h) every command the reader sends to the card is
+ *          recorded in a RAM ring: command, block, status code, a checksum of the data
+ *          and the duration. The "trace" serial command exports the ring as a
+ *          FRAME_TRACE frame; box-emulator --replay runs it again against the emulated
+ *          reader (rfid-host-util/emulator), so a failure seen in the field can be
+ *          reproduced at the desk and the trace kept as a timing fixture.
+ *
+ *          The firmware talks to the reader through TracedMFRC522: same API as MFRC522,
+ *          each card command is forwarded and recorded. Card polling
+ *          (PICC_IsNewCardPresent) is not recorded.
+ *
+ * Record layout (6 bytes, FRAME_TRACE payload, oldest first):
+ * -----------------------------------------------------------------
+ * Byte 0     Command (TraceOp)
+ * Byte 1     Block or page, UID size for TRACE_OP_SELECT, first byte sent for
+ *            TRACE_OP_TRANSCEIVE
+ * Byte 2     MFRC522::StatusCode
+ * Byte 3     XOR of the data read or written (of the UID for TRACE_OP_SELECT)
+ * Byte 4-5   Duration in microseconds (LE, saturated at 65535)
+ * -----------------------------------------------------------------
+ * @author Dag
+ */
+
+#ifndef RFID_RF_TRACE_H
+#define RFID_RF_TRACE_H
+
+#include "Arduino.h"
+#include <MFRC522.h>
+
+const byte RF_TRACE_SIZE = 32; // Records kept in RAM (6 bytes each)
+
+/**
+ * @brief Recorded commands: the PICC command byte where there is one
+ */
+enum TraceOp : byte
+{
+    TRACE_OP_TRANSCEIVE = 0x01, // Raw frame (PCD_TransceiveData), e.g. GET_VERSION
+    TRACE_OP_PWD_AUTH = 0x1B,   // NTAG password authentication
+    TRACE_OP_READ = 0x30,
+    TRACE_OP_HALT = 0x50,
+    TRACE_OP_WAKEUP = 0x52,
+    TRACE_OP_AUTH_A = 0x60,
+    TRACE_OP_AUTH_B = 0x61,
+    TRACE_OP_SELECT = 0x93,     // Anticollision and select of a card
+    TRACE_OP_WRITE = 0xA0,
+    TRACE_OP_UL_WRITE = 0xA2,
+    TRACE_OP_TRANSFER = 0xB0,
+    TRACE_OP_DECREMENT = 0xC0,
+    TRACE_OP_INCREMENT = 0xC1,
+    TRACE_OP_RESTORE = 0xC2
+};
+
+/**
+ * @brief One recorded command (6 bytes)
+ */
+struct TraceRecord
+{
+    byte op;         // TraceOp
+    byte arg;        // Block, page or UID size
+    byte status;     // MFRC522::StatusCode
+    byte check;      // XOR of the data
+    uint16_t micros; // Duration
+};
+
+/**
+ * @brief MFRC522 that records every card command in the trace ring
+ * @details Only the commands used by the firmware are wrapped. PICC_Select is
+ *          virtual in MFRC522, so the select done inside PICC_ReadCardSerial is
+ *          recorded as well. MIFARE_GetValue / MIFARE_SetValue are rebuilt on the
+ *          traced read / write, as in the library.
+ */
+class TracedMFRC522 : public MFRC522
+{
+public:
+    TracedMFRC522(byte chipSelectPin, byte resetPowerDownPin) : MFRC522(chipSelectPin, resetPowerDownPin) {}
+
+    StatusCode PICC_Select(Uid *uid, byte validBits = 0) override;
+    StatusCode PICC_WakeupA(byte *bufferATQA, byte *bufferSize);
+    StatusCode PICC_HaltA();
+    StatusCode PCD_Authenticate(byte command, byte blockAddr, MIFARE_Key *key, Uid *uid);
+    StatusCode MIFARE_Read(byte blockAddr, byte *buffer, byte *bufferSize);
+    StatusCode MIFARE_Write(byte blockAddr, byte *buffer, byte bufferSize);
+    StatusCode MIFARE_Ultralight_Write(byte page, byte *buffer, byte bufferSize);
+    StatusCode MIFARE_Decrement(byte blockAddr, int32_t delta);
+    StatusCode MIFARE_Increment(byte blockAddr, int32_t delta);
+    StatusCode MIFARE_Restore(byte blockAddr);
+    StatusCode MIFARE_Transfer(byte blockAddr);
+    StatusCode MIFARE_GetValue(byte blockAddr, int32_t *value);
+    StatusCode MIFARE_SetValue(byte blockAddr, int32_t value);
+    StatusCode PCD_NTAG216_AUTH(byte *passWord, byte pACK[]);
+    StatusCode PCD_TransceiveData(byte *sendData, byte sendLen, byte *backData, byte *backLen,
+                                  byte *validBits = nullptr, byte rxAlign = 0, bool checkCRC = false);
+};
+
+/** @brief Records currently in the ring */
+byte traceCount();
+
+/** @brief Discard every record */
+void traceClear();
+
+/**
+ * @brief Send the ring as a FRAME_TRACE frame, oldest record first
+ * @param out Destination stream
+ */
+void traceExport(Print *out);
+
+#endif // RFID_RF_TRACE_H
@@ -17,8 +17,29 @@
 #include "dag-button.h" // Custom button library
 #include "dag-timer.h"  // Custom timer library for periodic tasks
 #include "def.h"        // Pin definitions, constants, and utility functions
+#include "config.h"     // Build profile selection (READER / WRITER)
 #include "data.h"       // Data storage
 #include "lcd.h"        // LCD display management functions
+#include "events.h"     // Deferred feedback event queue
+#include "memory-stats.h" // Stack high-water mark and free heap telemetry
+#include "credential.h" // UID-bound MAC credential
+#include "uid-index.h"  // EEPROM UID allow/deny index
+#include "audit-log.h"  // EEPROM audit log ring
+#include "keyring.h"    // Multi-key authentication with key cache
+#include "journal.h"    // Provisioning journal
+#include "frame.h"      // CRC16
+#include "clone.h"      // Streaming card clone / backup
+#include "sector-io.h"  // Framed binary card dump
+#include "host-job.h"   // Provisioning jobs from the host daemon
+#include "secret-ring.h" // Retired credential secrets, card version tags
+#include "grant-cache.h" // Recently validated UIDs
+#include "counters.h"    // Lifetime operational counters
+#include "ultralight.h"  // MIFARE Ultralight / NTAG backend
+#include "records.h"     // Typed TLV card payload
+#include "rf-trace.h"    // RF command trace
+#include "console.h"     // Framed command console for host tools
+#include "power.h"       // Idle low-power policy
+#include "usage-counter.h" // Entry counter of usage-limited badges
 
 // ============================================================================
 // HARDWARE INITIALIZATION
@@ -31,9 +52,14 @@ DagButton btnReset(BTN_RESET_PIN, PULLUP); // Button to reset system state and c
 // TIMER for visual/audio feedback during SET mode
 DagTimer blinkTimer; // Generates periodic signals to indicate SET mode is active
 
+// TIMER for the non-blocking splash screen (FAST_BOOT)
+DagTimer splashTimer; // One-shot: expires when the splash can be replaced by the idle screen
+
 // RFID hardware components
-MFRC522 rfid(SS_PIN, RST_PIN); // RFID reader instance using SPI communication
-MFRC522::MIFARE_Key key;       // Cryptographic key for card authentication (read/write operations)
+TracedMFRC522 rfid(SS_PIN, RST_PIN); // RFID reader instance using SPI communication, commands traced with RF_TRACE
+
+// Feedback produced during the card exchange, rendered after the card is halted
+EventQueue events;
 
 // LCD display for user feedback (16x2 character display)
 LCD_I2C lcd(0x27, 16, 2); // I2C address 0x27, 16 columns, 2 rows (SDA=A4, SCL=A5)
@@ -44,7 +70,7 @@ LCD_I2C lcd(0x27, 16, 2); // I2C address 0x27, 16 columns, 2 rows (SDA=A4, SCL=A
 
 Mode MODE = MODE_READ;      // Current operational mode: READ (validate cards) or WRITE (program cards)
 Job JOB = RUN;              // Current job type: RUN (normal operation) or SET (passphrase programming)
-Agent AGENT = AGENT_WRITER; // Device role identifier (WRITER variant of the RFID box system)
+const Agent AGENT = BoxRole::AGENT; // Device role identifier, fixed at compile time by config.h
 
 // ============================================================================
 // RUNTIME STATE FLAGS AND DATA
@@ -53,13 +79,39 @@ Agent AGENT = AGENT_WRITER; // Device role identifier (WRITER variant of the RFI
 bool fired = false;     // Flag indicating a card has been detected and is being processed
 String value;           // Temporary storage for data read from current card (up to 16 chars per block)
 String passphrase = ""; // Master passphrase loaded from EEPROM for card validation
+bool passphraseLost = false; // Stored passphrase does not match the device key: no card writing until the next SET
 String uid;             // Unique identifier of the currently detected card
+byte macKey[MAC_KEY_SIZE]; // UID-MAC key, or digest of the master passphrase (deriveMacKey())
+bool secretSet = false;    // macKey is not the public digest of "": until SET no card is valid
+unsigned long digestMicros = 0; // Last credential read: time spent hashing blocks
+unsigned long readMicros = 0;   // Last credential read: total time, RF and hashing
+byte digestBlocks = 0;          // Last credential read: blocks hashed
 bool VALID = false;     // Flag indicating whether the current card contains valid passphrase
 
+BootStage bootStage = BOOT_DONE; // Deferred boot work still to be executed (FAST_BOOT)
+unsigned long bootMicros = 0;    // Time from reset to card detection readiness (microseconds)
+unsigned long cardStartMs = 0;   // millis() at card detection
+unsigned long cardDurationMs = 0; // Duration of the last card exchange, detection to halt
+bool dumpNext = false;           // Serial command "dump": stream the next card as binary frames
+char cmdLine[80];                // Serial command line or binary frame payload being received
+byte cmdLength = 0;              // Characters currently stored in cmdLine
+unsigned long serialRxMs = 0;    // millis() of the last byte of a binary frame
+FrameReader frameReader((byte *)cmdLine, sizeof(cmdLine)); // Binary frames from the host
+ProvisionJob hostJob;            // Provisioning job armed by the host (writer builds)
+CardOutcome outcome;             // Outcome of the last card transaction
+bool cardIsUltralight = false;   // Tag in the field is an Ultralight / NTAG (page backend)
+CardRecords cardRecords;         // Fields of the last valid records card (CREDENTIAL_RECORDS)
+CardRecords issueRecords = {0, 0xFFFF, 0, 1 << REC_PERMISSIONS}; // Fields written on the next cards, "badge" command
+int32_t issueUses = 0;           // Entries loaded on the next cards, 0 for unlimited badges ("uses" command)
+UsageResult usage = USAGE_UNLIMITED; // Entry counter of the card being validated
+
 // Forward declarations of main FUNCTIONS
 String readTag(int *blocksArray, int blocksCount);
 bool writeTag(String data, int *blocksArray, int blocksCount);
 void executeAction(bool valid);
+void waitForAcknowledge();
+void endCardSession();
+void drainEvents();
 
 /**
  * @brief System initialization and hardware setup
@@ -70,8 +122,12 @@ void executeAction(bool valid);
  *          - SPI bus and RFID reader
  *          - GPIO pins for outputs (action, alarm, error)
  *          - Timer for SET mode indication
- *          - RFID authentication key
+ *          - RFID authentication keyring
  *          - Master passphrase from EEPROM
+ *
+ *          With FAST_BOOT (config.h) only what card detection needs is done here:
+ *          the LCD splash, the reader diagnostics and the boot log are deferred to
+ *          runBootTasks(), executed from loop() between card polls.
  */
 void setup()
 {
@@ -85,33 +141,159 @@ void setup()
     pinMode(ACTION_PIN, OUTPUT); // Main action output (e.g., relay control, lock mechanism)
     pinMode(ALARM_PIN, OUTPUT);  // Audio/visual alarm for status indication
     pinMode(ERROR_PIN, OUTPUT);  // Error state indicator
+    executeAction(false);        // Ensure all outputs are in safe/inactive state
 
-    // Display system information via serial
-    Serial.print(F("RFID Box "));
-    Serial.println(VERSION);
-    Serial.println(F("Reader details:"));
-    rfid.PCD_DumpVersionToSerial(); // Display RFID reader hardware information
+    secretRingInit(); // Version of the current secret
 
-    // Load master passphrase from persistent storage
-    Serial.println(F("reading passphrase from eeprom..."));
+    // Load the credential secret from persistent storage: macKey is the UID-MAC key,
+    // or the digest of the passphrase cards are validated against
     loadPayloadFromEEPROM(&passphrase);
-    Serial.print(F("Passphrase: "));
-    Serial.println(passphrase);
-    Serial.println();
+    if (KEEP_PASSPHRASE)
+    {
+        byte stored[MAC_KEY_SIZE];
+        bool keyStored = loadMacKeyFromEEPROM(stored);
+        bool factory = !keyStored && passphrase.length() == 0; // Never SET: secret of the build
+        if (factory)
+        {
+            passphrase = (const __FlashStringHelper *)FACTORY_PASSPHRASE; // secrets.h, may be empty
+            deriveMacKey(passphrase, macKey);
+            if (memcmp_P(macKey, DEMO_DIGEST, MAC_KEY_SIZE) == 0)
+                passphrase = ""; // Published demo secret: wait for SET instead
+        }
+        deriveMacKey(passphrase, macKey); // Master passphrase kept to write it on cards
+        passphraseLost = keyStored && memcmp(stored, macKey, MAC_KEY_SIZE) != 0;
+        if (passphraseLost)
+        {
+            // SET lost power while rewriting the passphrase, after the new key was stored:
+            // cards are still validated with the key, written again after the next SET
+            memcpy(macKey, stored, MAC_KEY_SIZE);
+            passphrase = "";
+        }
+        else
+        {
+            saveMacKeyToEEPROM(macKey); // Digest in sync: a reader flashed here needs no SET
+            if (factory && passphrase.length() > 0)
+                savePayloadToEEPROM(&passphrase); // After the key, as SET does
+        }
+    }
+    else
+    {
+        if (!loadMacKeyFromEEPROM(macKey))
+        {
+            // SET lost power while storing the key: keep the secret it was replacing.
+            // Otherwise migration: derive the key once from the stored passphrase
+            if (!secretRingLastRetired(macKey))
+            {
+                if (passphrase.length() > 0)
+                    deriveMacKey(passphrase, macKey);
+                else
+                {
+                    memcpy_P(macKey, FACTORY_DIGEST, MAC_KEY_SIZE); // Never SET: secret of the build (secrets.h)
+                    if (memcmp_P(macKey, DEMO_DIGEST, MAC_KEY_SIZE) == 0)
+                        deriveMacKey(String(), macKey); // Published demo secret: wait for SET instead
+                }
+            }
+            saveMacKeyToEEPROM(macKey);
+        }
+        if (passphrase.length() > 0)
+        {
+            passphrase = "";
+            savePayloadToEEPROM(&passphrase); // No passphrase left in clear
+        }
+    }
+    byte unset[MAC_KEY_SIZE];
+    deriveMacKey(String(), unset); // Never SET and no build secret: anyone can compute this key
+    secretSet = memcmp(unset, macKey, MAC_KEY_SIZE) != 0;
 
-    // Initialize RFID authentication key
-    // Using factory default key (FFFFFFFFFFFF) for MIFARE Classic cards
-    // Alternative: use custom cryptographic key from data.h
-    for (byte i = 0; i < MFRC522::MF_KEY_SIZE; i++)
-        key.keyByte[i] = default_key[i]; // default_key is defined in data.h
-    // key.keyByte[i] = crypto_key[i]; // Uncomment to use custom key
+    uidIndexInit();   // Format the UID allow/deny index on first boot
+    auditLogInit();
+    countersInit();
+    powerInit(); // Sleep tick and wake pins (LOW_POWER_IDLE)
 
-    // Initialize LCD display and show welcome message
-    lcd_init(&lcd, VERSION);
-    lcd_idle(&lcd, MODE, JOB);
+    // Initialize RFID authentication keys: crypto_key, older generations, factory key (secrets.h)
+    keyringBegin(KEYRING, KEYRING_SIZE);
+
+    if (FAST_BOOT)
+    {
+        bootStage = BOOT_SPLASH; // Splash, diagnostics and idle screen run in background
+    }
+    else
+    {
+        printDiagnostics();
+        lcd_init(&lcd, (const __FlashStringHelper *)VERSION); // Blocking splash
+        lcd_idle(&lcd, MODE, JOB);
+        bootStage = BOOT_DONE;
+    }
+
+    bootMicros = micros(); // Card detection is available from here on
+}
+
+/**
+ * @brief Background boot work deferred by FAST_BOOT
+ * @details Executes one step per call, so a card presented right after a reset
+ *          is detected without waiting for the LCD or the serial log:
+ *          1. BOOT_SPLASH:      LCD init and splash screen (non-blocking)
+ *          2. BOOT_DIAGNOSTICS: version, reader details and passphrase status on serial
+ *          3. BOOT_IDLE:        idle screen once SPLASH_MS has elapsed
+ */
+void runBootTasks()
+{
+    switch (bootStage)
+    {
+    case BOOT_SPLASH:
+        lcd_splash(&lcd, (const __FlashStringHelper *)VERSION);
+        splashTimer.init(SPLASH_MS, false);
+        bootStage = BOOT_DIAGNOSTICS;
+        break;
+
+    case BOOT_DIAGNOSTICS:
+        printDiagnostics();
+        bootStage = BOOT_IDLE;
+        break;
+
+    case BOOT_IDLE:
+        if (!splashTimer.exhausted())
+            break;
+        lcd_idle(&lcd, MODE, JOB);
+        bootStage = BOOT_DONE;
+        break;
+
+    case BOOT_DONE:
+        break;
+    }
+}
 
-    // Initialize system state
-    executeAction(false); // Ensure all outputs are in safe/inactive state
+/**
+ * @brief Print firmware version, reader details and boot status on serial
+ */
+void printDiagnostics()
+{
+    Serial.print(F("RFID Box "));
+    Serial.print((const __FlashStringHelper *)VERSION);
+    Serial.print(F(" build "));
+    Serial.println((const __FlashStringHelper *)BUILD_ID);
+    Serial.println(F("Reader details:"));
+    rfid.PCD_DumpVersionToSerial(); // Display RFID reader hardware information
+    Serial.print(F("Secret: "));
+    if (!secretSet)
+        Serial.println(F("none, SET a master card: no card is valid until then"));
+    else if (passphraseLost)
+        Serial.println(F("no passphrase matching the device key, SET again to write cards"));
+    else
+        Serial.println(KEEP_PASSPHRASE ? F("passphrase, to write cards") : F("digest only"));
+    printBootTime();
+    Serial.println();
+}
+
+/**
+ * @brief Print the time from reset to card detection readiness
+ * @note micros() starts at the end of the core init, bootloader time is not included
+ */
+void printBootTime()
+{
+    Serial.print(F("Boot time: "));
+    Serial.print(bootMicros);
+    Serial.println(FAST_BOOT ? F(" us (fast boot)") : F(" us"));
 }
 
 /**
@@ -126,12 +308,28 @@ void setup()
  */
 void loop()
 {
+    // ========================================================================
+    // BACKGROUND TASKS
+    // ========================================================================
+
+    // Deferred boot work (splash, diagnostics): one step per loop iteration
+    if (bootStage != BOOT_DONE)
+        runBootTasks();
+
+    // Serial commands (non-blocking)
+    handleSerialCommands();
+
+    // Audit log and counters: one EEPROM cell per iteration, only when the EEPROM is idle
+    auditLogService();
+    counterService();
+
     // ========================================================================
     // USER INPUT HANDLING
     // ========================================================================
 
-    // Handle mode switching: short press toggles READ/WRITE mode
-    btnMode.onPress(toggleMode);
+    // Handle mode switching: short press toggles READ/WRITE mode (writer builds only)
+    if (BoxRole::CAN_WRITE)
+        btnMode.onPress(toggleMode);
 
     // Handle job switching: long press (3s) toggles RUN/SET mode
     btnMode.onLongPress(toggleJob, 3000);
@@ -145,14 +343,17 @@ void loop()
 
     // Check for presence of new RFID card - exit if none detected
     if (!rfid.PICC_IsNewCardPresent())
+    {
+        if (LOW_POWER_IDLE)
+            idleSleep();
         return;
+    }
 
     // Attempt to read card serial number - exit if communication fails
     if (!rfid.PICC_ReadCardSerial())
     {
-        Serial.println(F("Failed to read card serial."));
-        lcd_uid_reading_error(&lcd);
-        beep(3); // Triple beep indicates read error
+        events.publish(EV_UID_READ_FAILED);
+        drainEvents();
         delay(1000);
         lcd_idle(&lcd, MODE, JOB);
         return;
@@ -161,34 +362,101 @@ void loop()
     // ========================================================================
     // CARD PROCESSING BEGINS
     // ========================================================================
+    // From here until endCardSession() the card is in the field: feedback is
+    // only published as events and rendered once the card has been halted.
+
+    fired = true; // Set flag indicating card processing is active
+    cardStartMs = millis();
+    powerCardDetected();
+    outcome.result = 0;
+    outcome.block = AUDIT_NO_BLOCK;
+    outcome.written = 0;
+    outcome.skipped = 0;
+    cardIsUltralight = isUltralight(rfid.uid.sak);
+    events.publish(EV_UID_DETECTED);
+
+    // Revoked badges are rejected right after anticollision, before any authentication
+    UidStatus listed = uidIndexLookup(rfid.uid.uidByte, rfid.uid.size);
+    if (listed == UID_DENIED || (UID_ALLOWLIST_ONLY && listed != UID_ALLOWED))
+    {
+        events.publish(listed == UID_DENIED ? EV_UID_DENIED : EV_UID_NOT_ALLOWED);
+        endCardSession();
+        if (BoxRole::CAN_WRITE && hostJob.armed)
+            finishHostJob(); // Reported to the host, no operator acknowledge
+        else
+            waitForAcknowledge();
+        lcd_idle(&lcd, MODE, JOB);
+        return;
+    }
 
-    fired = true;                // Set flag indicating card processing is active
-    uid = uidToString(rfid.uid); // Get the UID of the card as a string
-    Serial.print(F("Card detected UID: "));
-    Serial.println(uid); // Log card detection event
-    Serial.println();
+    // Verify card compatibility: MIFARE Classic, or Ultralight / NTAG for the credential
+    if (!checkCompatibility())
+    {
+        events.publish(EV_INCOMPATIBLE_CARD);
+        endCardSession();
+        if (BoxRole::CAN_WRITE && hostJob.armed)
+            finishHostJob(); // Reported to the host, no operator acknowledge
+        else
+            waitForAcknowledge();
+        lcd_idle(&lcd, MODE, JOB);
+        return;
+    }
 
     // ========================================================================
-    // READ MODE PROCESSING
+    // HOST PROVISIONING JOB (FRAME_JOB, rfid-host-util/provisiond)
+    // ========================================================================
+    if (BoxRole::CAN_WRITE && hostJob.armed)
+    {
+        runHostJob();
+        finishHostJob();
+        lcd_idle(&lcd, MODE, JOB);
+        return;
+    }
+
+    // ========================================================================
+    // BINARY DUMP (serial command "dump")
+    // ========================================================================
+    if (dumpNext)
+    {
+        dumpNext = false;
+        dumpCard(&rfid, &Serial);
+        endCardSession();
+        beep(1, 1000);
+        fired = false;
+        lcd_idle(&lcd, MODE, JOB);
+        return;
+    }
+
+    // ========================================================================
+    // CLONE / BACKUP (serial command "clone")
     // ========================================================================
-    if (MODE == MODE_READ)
+    if (BoxRole::CAN_WRITE && cloneStage() != CLONE_IDLE)
     {
-        // Verify card compatibility with MIFARE Classic standard
-        if (!checkCompatibility())
+        cloneProcessCard(&rfid, &events, &Serial);
+        endCardSession(); // Progress rendered after the card is halted
+        fired = false;
+        if (cloneStage() == CLONE_IDLE)
         {
-            beep(3);                       // Triple beep indicates compatibility error
-            lcd_compatibility_error(&lcd); // Display compatibility error on LCD
-            triggerErrorAndWaitForReset(&btnReset, &fired);
+            delay(ERROR_HOLD_MS);
             lcd_idle(&lcd, MODE, JOB);
-            return;
         }
+        return;
+    }
 
+    // ========================================================================
+    // READ MODE PROCESSING
+    // ========================================================================
+    if (!BoxRole::CAN_WRITE || MODE == MODE_READ)
+    {
         // Special debug feature: dump all card data when reset button is held
-        if (btnReset.clicked())
+        if (BoxRole::HAS_RESET_BUTTON && btnReset.clicked() && !cardIsUltralight)
         {
-            rfid.PICC_DumpToSerial(&(rfid.uid)); // Output complete card structure to serial
-            beep(1, 1000);                       // Long beep indicates dump completed
-            lcd_show_uid(&lcd, uid);             // Display UID on LCD
+            drainEvents();
+            dumpCard(&rfid, &Serial); // Framed binary dump (rfid-host-util/dump-decoder)
+            endCardSession();
+            beep(1, 1000);            // Long beep indicates dump completed
+            uid = uidToString(rfid.uid);
+            lcd_show_uid(&lcd, uid); // Display UID on LCD
 
             while (fired)
             {
@@ -203,120 +471,271 @@ void loop()
         }
 
         // ====================================================================
-        // READ CARD DATA
+        // REPEAT TAP: UID VALIDATED A MOMENT AGO
         // ====================================================================
-
-        value = "";                            // Clear previous read data
-        value = readTag(blocks, BLOCKS_COUNT); // Read passphrase from all configured blocks
-
-        // Handle read operation results
-        if (value == "")
+        // Granted right after anticollision: no authentication, no block read
+        if (JOB == RUN && grantCacheHit(rfid.uid))
         {
-            // Reading failed - provide error feedback and wait for user reset
-            beep(3);                                        // Triple beep indicates read error
-            triggerErrorAndWaitForReset(&btnReset, &fired); // Enter error state
+            events.publish(EV_ACCESS_GRANTED, 1);
+            endCardSession();
+            executeAction(true);
             lcd_idle(&lcd, MODE, JOB);
+            fired = false;
             return;
         }
 
-        // ================================================================
-        // SET MODE: PASSPHRASE PROGRAMMING
-        // ================================================================
-        if (JOB == SET)
+        // ====================================================================
+        // COMPACT CREDENTIAL: UID-BOUND MAC (1 BLOCK)
+        // ====================================================================
+        if (JOB == RUN && CREDENTIAL_MODE == CREDENTIAL_UID_MAC)
         {
-            // In SET mode, use the read passphrase to update the master passphrase
-            bool saved = savePayloadToEEPROM(&value);
+            byte buffer[18];
+            bool readOk = cardIsUltralight ? readUltralightBlock(0, buffer) : readBlock(blocks[0], buffer);
+            SecretMatch match = SECRET_INVALID;
+            usage = USAGE_UNLIMITED;
+            if (readOk)
+            {
+                // Checked with the card still in the field: an outdated card is re-issued
+                match = matchUidMac(buffer);
+                if (UPGRADE_OLD_CARDS && match == SECRET_OUTDATED)
+                    upgradeCard(buffer[UID_MAC_SECRET_VERSION]);
+                if (match != SECRET_INVALID)
+                    usage = usageCharge(&rfid, &events); // Same session as the validation
+            }
+            endCardSession(); // Card halted: render the feedback
 
-            if (!saved)
+            if (!readOk)
             {
-                // EEPROM save failed
-                beep(3); // Triple beep indicates error
-                lcd_EEPROM_writing_error(&lcd);
-                triggerErrorAndWaitForReset(&btnReset, &fired);
-                JOB = RUN; // Return to normal operation mode
+                waitForAcknowledge(); // Read failed - feedback already rendered
                 lcd_idle(&lcd, MODE, JOB);
                 return;
             }
 
-            // Passphrase successfully saved - provide confirmation
-            passphrase = value; // Update master passphrase with card data
-            beep(1, 1000);      // Long success beep
-            lcd_passphrase_set_success(&lcd);
-            while (fired) // Wait for user acknowledgment via reset button
+            VALID = match != SECRET_INVALID;
+        }
+        // ====================================================================
+        // TYPED RECORDS: FIELDS CLOSED BY A UID-BOUND MAC
+        // ====================================================================
+        else if (JOB == RUN && CREDENTIAL_MODE == CREDENTIAL_RECORDS)
+        {
+            SecretMatch match;
+            byte cardVersion;
+            bool readOk = readCardRecords(&match, &cardVersion);
+            if (readOk && UPGRADE_OLD_CARDS && match == SECRET_OUTDATED)
+                upgradeCard(cardVersion); // Checked with the card still in the field
+
+            // Valid card, and allowed through this door
+            VALID = readOk && match != SECRET_INVALID &&
+                    (DOOR_PERMISSIONS == 0 || ((cardRecords.present & recordBit(REC_PERMISSIONS)) &&
+                                               (cardRecords.permissions & DOOR_PERMISSIONS)));
+            usage = VALID ? usageCharge(&rfid, &events) : USAGE_UNLIMITED;
+            endCardSession(); // Card halted: render the feedback
+
+            if (!readOk)
             {
-                if (btnReset.pressed())
-                {
-                    fired = false; // Clear processing flag
-                    JOB = RUN;     // Return to normal operation mode
-                    lcd_idle(&lcd, MODE, JOB);
-                    return; // ESCE dalla modalità SET dopo che ha settato la passphrase
-                }
-                delay(100);
+                waitForAcknowledge(); // Read failed - feedback already rendered
+                lcd_idle(&lcd, MODE, JOB);
+                return;
             }
         }
-
-        // ================================================================
-        // RUN MODE: ACCESS VALIDATION
-        // ================================================================
-        else if (JOB == RUN)
+        else
         {
-            // Compare read passphrase with stored master passphrase
-            VALID = (value == passphrase);
+            // ================================================================
+            // READ CARD DATA
+            // ================================================================
+            // Every block is hashed as soon as it is read: the passphrase is only
+            // assembled by writers storing a new master passphrase (KEEP_PASSPHRASE)
+
+            byte digest[MAC_KEY_SIZE];
+            byte cardVersion = SECRET_VERSION_NONE;
+            bool readOk;
+            SecretMatch match = SECRET_INVALID;
+            usage = USAGE_UNLIMITED;
+
+            if (KEEP_PASSPHRASE && JOB == SET)
+            {
+                value = readTag(blocks, BLOCKS_COUNT); // Read passphrase from all configured blocks
+                bool tagged = value != "";
+                takeVersionTag(&value);
+                readOk = value != "";
+                if (tagged && !readOk)
+                    events.publish(EV_CARD_BLANK); // Version tag alone, no passphrase
+            }
+            else
+                readOk = readCredentialDigest(blocks, BLOCKS_COUNT, digest, &cardVersion);
+
+            if (JOB == RUN && readOk)
+            {
+                // Checked with the card still in the field: an outdated card is re-issued
+                match = matchPassphrase(digest, cardVersion);
+                if (UPGRADE_OLD_CARDS && KEEP_PASSPHRASE && match == SECRET_OUTDATED)
+                    upgradeCard(cardVersion);
+                if (match != SECRET_INVALID)
+                    usage = usageCharge(&rfid, &events); // Same session as the validation
+            }
+            endCardSession(); // Card halted: render the read feedback
 
-            if (!VALID)
+            // Handle read operation results
+            if (!readOk)
             {
-                // Invalid passphrase - deny access
-                beep(3); // Triple beep indicates invalid card
-                lcd_invalid_passphrase(&lcd);
-                triggerErrorAndWaitForReset(&btnReset, &fired);
+                // Reading failed or blank card - feedback already rendered, wait for user reset
+                waitForAcknowledge(); // Enter error state
                 lcd_idle(&lcd, MODE, JOB);
                 return;
             }
-            else
+
+            // ================================================================
+            // SET MODE: PASSPHRASE PROGRAMMING
+            // ================================================================
+            if (JOB == SET)
             {
-                // Valid passphrase - grant access
-                beep(1, 600);        // Success confirmation beep
-                executeAction(true); // Activate access control mechanism
-                lcd_reading_success(&lcd);
-                delay(3000);
-                lcd_idle(&lcd, MODE, JOB);
+                // In SET mode, the secret of the master card replaces the current one.
+                // Only its fixed-size digest is stored, and the passphrase itself only
+                // by writers that write it on cards (KEEP_PASSPHRASE).
+                // The secret being replaced is retired first: cards written with it keep working.
+                byte fresh[MAC_KEY_SIZE];
+                byte unset[MAC_KEY_SIZE];
+                if (KEEP_PASSPHRASE)
+                    deriveMacKey(value, fresh);
+                else
+                    memcpy(fresh, digest, MAC_KEY_SIZE);
+
+                deriveMacKey(String(), unset); // Device never SET and no build secret: nothing to retire
+                if (memcmp(fresh, macKey, MAC_KEY_SIZE) != 0 && memcmp(unset, macKey, MAC_KEY_SIZE) != 0)
+                    secretRingRotate(macKey);
+                memcpy(macKey, fresh, MAC_KEY_SIZE);
+                secretSet = memcmp(unset, macKey, MAC_KEY_SIZE) != 0;
+
+                bool saved = saveMacKeyToEEPROM(macKey);
+                if (KEEP_PASSPHRASE)
+                    saved = savePayloadToEEPROM(&value) && saved;
+
+                grantCacheClear(); // Cards validated with the previous secret must be checked again
+
+                if (!saved)
+                {
+                    // EEPROM save failed
+                    events.publish(EV_EEPROM_WRITE_FAILED);
+                    drainEvents();
+                    waitForAcknowledge();
+                    JOB = RUN; // Return to normal operation mode
+                    lcd_idle(&lcd, MODE, JOB);
+                    return;
+                }
+
+                // Passphrase successfully saved - provide confirmation
+                passphrase = value; // Update master passphrase with card data (writers only)
+                passphraseLost = false;
+                value = "";
+                events.publish(EV_PASSPHRASE_SET);
+                drainEvents();
+                if (!BoxRole::HAS_RESET_BUTTON)
+                {
+                    delay(ERROR_HOLD_MS); // No operator button: leave SET mode on its own
+                    fired = false;
+                    JOB = RUN;
+                    lcd_idle(&lcd, MODE, JOB);
+                    return;
+                }
+                while (fired) // Wait for user acknowledgment via reset button
+                {
+                    if (btnReset.pressed())
+                    {
+                        fired = false; // Clear processing flag
+                        JOB = RUN;     // Return to normal operation mode
+                        lcd_idle(&lcd, MODE, JOB);
+                        return; // ESCE dalla modalità SET dopo che ha settato la passphrase
+                    }
+                    delay(100);
+                }
+                return;
             }
+
+            // Current passphrase, or a retired one still in the secret ring
+            VALID = match != SECRET_INVALID;
+        }
+
+        // ================================================================
+        // RUN MODE: ACCESS VALIDATION
+        // ================================================================
+        if (VALID && usage == USAGE_FAILED)
+        {
+            // Entry counter not updated - feedback already rendered
+            waitForAcknowledge();
+            lcd_idle(&lcd, MODE, JOB);
+            return;
+        }
+        if (!VALID || usage == USAGE_EXHAUSTED)
+        {
+            // Invalid credential, or no entry left - deny access
+            events.publish(VALID ? EV_USES_EXHAUSTED : EV_ACCESS_DENIED);
+            drainEvents();
+            waitForAcknowledge();
+            lcd_idle(&lcd, MODE, JOB);
+            return;
+        }
+        else
+        {
+            // Valid credential - grant access
+            if (usage == USAGE_UNLIMITED)
+                grantCachePut(rfid.uid); // A limited badge is charged at every tap
+            events.publish(EV_ACCESS_GRANTED);
+            drainEvents();
+            executeAction(true); // Activate access control mechanism
+            delay(3000);
+            lcd_idle(&lcd, MODE, JOB);
         }
     }
 
     // ========================================================================
     // WRITE MODE PROCESSING
     // ========================================================================
-    else if (MODE == MODE_WRITE)
+    else if (BoxRole::CAN_WRITE && MODE == MODE_WRITE)
     {
-        // Verify card compatibility before attempting write operations
-        if (!checkCompatibility())
+        bool written = false;
+        if (CREDENTIAL_MODE == CREDENTIAL_UID_MAC)
         {
-            beep(3); // Triple beep indicates compatibility error
-            lcd_compatibility_error(&lcd);
-            triggerErrorAndWaitForReset(&btnReset, &fired);
-            lcd_idle(&lcd, MODE, JOB);
-            return;
+            // Single credential block bound to this card's UID, stale data cleared
+            byte credential[16];
+            buildCredentialBlock(macKey, secretRingVersion(), credential);
+            if (REKEY_ON_WRITE)
+                written = provisionCard(credential, sizeof(credential));
+            else
+                written = writeBuffer(credential, sizeof(credential), blocks, BLOCKS_COUNT);
         }
-
-        // Write current master passphrase to all configured blocks on the card
-        bool result = writeTag(&passphrase, blocks, BLOCKS_COUNT);
-
-        if (result)
+        else if (CREDENTIAL_MODE == CREDENTIAL_RECORDS)
         {
-            Serial.println(F("Write operation completed successfully"));
-            beep(1, 1000); // Long beep indicates write operation finished
-            lcd_writing_success(&lcd);
+            // Re-issuing a valid card keeps its badge id and increments its issue counter
+            byte data[RECORDS_MAX_SIZE];
+            byte length;
+            SecretMatch match;
+            byte cardVersion;
+            if (readCardRecords(&match, &cardVersion))
+            {
+                length = buildIssueRecords(match != SECRET_INVALID ? &cardRecords : NULL, macKey, secretRingVersion(), data);
+                if (REKEY_ON_WRITE)
+                    written = provisionCard(data, length);
+                else
+                    written = writeBuffer(data, length, blocks, BLOCKS_COUNT);
+            }
         }
+        else if (passphraseLost)
+            events.publish(EV_EEPROM_WRITE_FAILED); // Nothing to write until the next SET
         else
         {
-            Serial.println(F("Write operation failed"));
-            beep(3); // Triple beep indicates write error
-            // Note: LCD error are already displayed into writeTag function
+            String data = passphrase; // Master passphrase with the current version tag
+            appendVersionTag(&data, secretRingVersion());
+            if (REKEY_ON_WRITE)
+                written = provisionCard((const byte *)data.c_str(), data.length()); // Also moves every sector to crypto_key
+            else
+                written = writeTag(&data, blocks, BLOCKS_COUNT);
         }
+        if (written && USAGE_SECTOR != 0 && issueUses > 0 && !cardIsUltralight)
+            usageIssue(&rfid, &events, issueUses); // Usage-limited badge, "uses" command
+        endCardSession(); // Card halted: render success or failure feedback
 
         // Enter waiting state until user acknowledges with reset button
-        triggerErrorAndWaitForReset(&btnReset, &fired);
+        waitForAcknowledge();
         lcd_idle(&lcd, MODE, JOB);
     }
 
@@ -340,6 +759,9 @@ void loop()
  */
 void toggleMode()
 {
+    if (!BoxRole::CAN_WRITE)
+        return; // Reader builds have no WRITE mode
+
     MODE = MODE == MODE_READ ? MODE_WRITE : MODE_READ;
     beep(1); // Single beep confirms mode change
 
@@ -362,7 +784,7 @@ void toggleJob()
     JOB = JOB == RUN ? SET : RUN;
 
     // Security measure: only allow SET mode in READ mode to prevent write conflicts
-    if (MODE == MODE_WRITE)
+    if (BoxRole::CAN_WRITE && MODE == MODE_WRITE)
         JOB = RUN;
     else
         beep(5); // Multiple beeps confirm job mode change (only in READ mode)
@@ -387,114 +809,869 @@ void blinkIfSetMode()
     lcd_idle(&lcd, MODE, JOB);
 }
 
+/**
+ * @brief Sleep until the next card poll when nothing else is going on (power.h)
+ * @details Stays awake while boot tasks are pending, while an audit record or a counter
+ *          flush is being written (one EEPROM cell per loop: a tick per cell would
+ *          stretch it to seconds), while a command line or frame is partly received
+ *          and while a button is held (long press timing).
+ */
+void idleSleep()
+{
+    bool busy = bootStage != BOOT_DONE || auditLogPending() || counterFlushPending() ||
+                cmdLength > 0 || frameReader.active() || Serial.available() > 0 ||
+                digitalRead(BTN_MODE_PIN) == LOW || digitalRead(BTN_RESET_PIN) == LOW;
+    powerIdle(busy);
+}
+
 // ============================================================================
-// RFID CARD OPERATIONS
+// SERIAL COMMANDS
 // ============================================================================
 
 /**
- * Function to change the sector key for a specific MIFARE Classic sector
- * @param trailerBlock The trailer block number of the sector to change
- * @param mfrc522 Reference to the MFRC522 instance used for communication
- * @param newKey Pointer to the new 6-byte key to set for the sector
- * @param oldKey Pointer to the current 6-byte key used for authentication
- * @param accessBits Pointer to the 4-byte access bits array to set for the sector
- * @return true if the key change was successful, false otherwise
+ * @brief Collect serial input and execute complete command lines
+ * @details Non-blocking: consumes only the characters already received and
+ *          executes a command when its line terminator arrives.
+ *          Lines longer than the buffer are discarded.
+ *          A FRAME_SOF at the start of a line begins a binary frame from the host
+ *          (runFrame()); a frame silent for FRAME_RX_TIMEOUT_MS is dropped.
  */
-bool changeSectorKey(byte trailerBlock, byte *newKey, MFRC522::MIFARE_Key oldKey)
+void handleSerialCommands()
 {
-    MFRC522::StatusCode status;
-
-    // Authenticate using the old key
-    status = rfid.PCD_Authenticate(MFRC522::PICC_CMD_MF_AUTH_KEY_A, trailerBlock, &oldKey, &(rfid.uid));
+    if (frameReader.active() && millis() - serialRxMs > FRAME_RX_TIMEOUT_MS)
+        frameReader.reset(); // Host gone mid-frame: accept text commands again
 
-    if (status != MFRC522::STATUS_OK)
+    while (Serial.available() > 0)
     {
-        Serial.print(F("Authentication failed for block "));
-        Serial.print(trailerBlock);
-        Serial.print(F(": "));
-        Serial.println(rfid.GetStatusCodeName(status));
-        return false;
-    }
+        char c = Serial.read();
+        if (LOW_POWER_IDLE)
+            powerKeepAwake();
 
-    // Prepare new trailer block data with new key and access bits
-    byte buffer[16];
-    for (byte i = 0; i < 6; i++)
-    {
-        buffer[i] = newKey[i]; // New Key A
-    }
-    for (byte i = 0; i < 4; i++)
-    {
-        buffer[6 + i] = accessBits[i]; // Access Bits
+        if (frameReader.active() || (cmdLength == 0 && (byte)c == FRAME_SOF))
+        {
+            serialRxMs = millis();
+            if (frameReader.feed(c))
+                runFrame(frameReader.type(), (const byte *)cmdLine, frameReader.payloadLength());
+        }
+        else if (c == '\r' || c == '\n')
+        {
+            if (cmdLength > 0 && cmdLength < sizeof(cmdLine))
+            {
+                cmdLine[cmdLength] = '\0';
+                runCommand(cmdLine);
+            }
+            cmdLength = 0;
+        }
+        else if (cmdLength < sizeof(cmdLine))
+            cmdLine[cmdLength++] = c; // Overflow: the line is dropped at its terminator
     }
-    for (byte i = 0; i < 6; i++)
+}
+
+/**
+ * @brief Execute a single serial command
+ * @param cmd Null-terminated command line
+ *
+ * Commands:
+ * - boot:  time from reset to card detection readiness
+ * - mem:   stack high-water mark, free heap and largest free block
+ * - stats: full statistics dump
+ * - allow <uid>:  add a UID to the allowlist (hex, e.g. "allow 04 A1 B2 C3")
+ * - deny <uid>:   add a UID to the denylist (revoked badge)
+ * - forget <uid>: remove a UID from both lists
+ * - uids:         list the UID index
+ * - log:   export the audit log as a binary frame (audit-log.h)
+ * - counters: export the lifetime counters as a binary frame (counters.h)
+ * - trace: export the RF trace as a binary frame (rf-trace.h, RF_TRACE builds)
+ * - trace clear: discard the RF trace
+ * - dump:  stream the next card as binary frames (sector-io.h)
+ * - clone:        stream the next card to the host as sector frames (writer builds)
+ * - clone card:   copy the next card to a target card, one sector at a time
+ * - clone stop:   abort the clone session
+ * - badge [<id> [<permissions hex>]]: records written on the next cards (writer builds,
+ *                 CREDENTIAL_RECORDS), id 0 keeps the badge id of a re-issued card
+ * - uses [<n> | off]: entries loaded on the next cards (writer builds, USAGE_SECTOR set)
+ */
+void runCommand(const char *cmd)
+{
+    if (strcmp(cmd, "boot") == 0)
+        printBootTime();
+    else if (strcmp(cmd, "mem") == 0)
+        printMemoryStats();
+    else if (strcmp(cmd, "stats") == 0)
+        printStats();
+    else if (strcmp(cmd, "uids") == 0)
+        printUidIndex();
+    else if (strcmp(cmd, "log") == 0)
+        auditLogExport(&Serial);
+    else if (strcmp(cmd, "counters") == 0)
+        countersExport(&Serial);
+    else if (RF_TRACE && strcmp(cmd, "trace") == 0)
+        traceExport(&Serial);
+    else if (RF_TRACE && strcmp(cmd, "trace clear") == 0)
+        traceClear();
+    else if (strcmp(cmd, "dump") == 0)
     {
-        buffer[10 + i] = newKey[i]; // New Key B (same as Key A for simplicity)
+        dumpNext = true;
+        Serial.println(F("Dump: present the card"));
     }
-
-    // Write the new trailer block
-    status = rfid.MIFARE_Write(trailerBlock, buffer, 16);
-    if (status != MFRC522::STATUS_OK)
+    else if (BoxRole::CAN_WRITE && strncmp(cmd, "clone", 5) == 0)
+        cloneCommand(cmd + 5);
+    else if (BoxRole::CAN_WRITE && CREDENTIAL_MODE == CREDENTIAL_RECORDS && strncmp(cmd, "badge", 5) == 0)
+        badgeCommand(cmd + 5);
+    else if (BoxRole::CAN_WRITE && USAGE_SECTOR != 0 && strncmp(cmd, "uses", 4) == 0)
+        usesCommand(cmd + 4);
+    else if (strncmp(cmd, "allow ", 6) == 0)
+        uidCommand(cmd + 6, UID_ALLOWED);
+    else if (strncmp(cmd, "deny ", 5) == 0)
+        uidCommand(cmd + 5, UID_DENIED);
+    else if (strncmp(cmd, "forget ", 7) == 0)
+        uidCommand(cmd + 7, UID_UNKNOWN);
+    else
     {
-        Serial.print(F("Failed to write new key for block "));
-        Serial.print(trailerBlock);
-        Serial.print(F(": "));
-        Serial.println(rfid.GetStatusCodeName(status));
-        return false;
+        Serial.print(F("Unknown command: "));
+        Serial.println(cmd);
     }
-
-    Serial.print(F("Successfully changed key for sector  "));
-    Serial.println(((trailerBlock - 3) / 4));
-
-    rfid.PCD_StopCrypto1(); // Stop encryption on PCD
-    return true;
 }
 
 /**
- * @brief Authenticate with RFID card using Key A
- * @details Performs MIFARE Classic authentication for a specific block using Key A.
- *          This is required before any read or write operation can be performed.
- * @param block The block number to authenticate (0-63 for MIFARE Classic 1K)
- * @return true if authentication successful, false if failed
+ * @brief Execute a binary frame received from the host
+ * @param type Frame type
+ * @param payload Frame payload
+ * @param length Payload length
  */
-bool authenticateA(byte block)
+void runFrame(byte type, const byte *payload, byte length)
 {
-    MFRC522::StatusCode status;
-    status = rfid.PCD_Authenticate(MFRC522::PICC_CMD_MF_AUTH_KEY_A, block, &key, &(rfid.uid));
+    uint16_t id = jobId(payload, length);
 
-    if (status != MFRC522::STATUS_OK)
+    switch (type)
     {
-        Serial.print(F("Authentication failed: "));
-        Serial.println(rfid.GetStatusCodeName(status));
-        return false;
+    case FRAME_STATUS_REQUEST:
+        sendStatus(&Serial, AGENT, MODE, hostJob);
+        break;
+
+    case FRAME_JOB:
+        sendJobAck(&Serial, id, armHostJob(payload, length));
+        break;
+
+    case FRAME_JOB_CANCEL:
+        cancelHostJob(id);
+        break;
+
+    case FRAME_CONSOLE:
+        runConsole(payload, length);
+        break;
     }
-    else
-        return true;
 }
 
 /**
- * @brief Verify RFID card compatibility with system requirements
- * @details Checks if the detected card is a MIFARE Classic type, which is required
- *          for this system. Other card types (MIFARE Ultralight, NTAG, etc.) are
- *          not supported due to different memory structures and authentication methods.
- * @return true if card is compatible (MIFARE Classic Mini/1K/4K), false otherwise
+ * @brief Arm the host job of a FRAME_JOB payload
+ * @return Acknowledge to send to the host
  */
-bool checkCompatibility()
+JobAck armHostJob(const byte *payload, byte length)
 {
-    MFRC522::PICC_Type piccType = rfid.PICC_GetType(rfid.uid.sak);
-
-    if (piccType != MFRC522::PICC_TYPE_MIFARE_MINI &&
-        piccType != MFRC522::PICC_TYPE_MIFARE_1K &&
-        piccType != MFRC522::PICC_TYPE_MIFARE_4K)
-    {
-        Serial.println(F("This device only works with MIFARE Classic cards."));
-        return false;
-    }
-    else
-        return true;
+    if (!BoxRole::CAN_WRITE)
+        return JOB_UNSUPPORTED;
+    if (hostJob.armed)
+        return JOB_BUSY;
+    if (!parseJob(payload, length, &hostJob))
+        return JOB_INVALID;
+
+    lcd_job(&lcd, hostJob.id);
+    return JOB_ACCEPTED;
 }
 
 /**
- * @brief Read passphrase data from multiple RFID card blocks
+ * @brief Cancel the armed host job, reported with an empty FRAME_JOB_RESULT
+ * @return false if no job with this id is armed
+ */
+bool cancelHostJob(uint16_t id)
+{
+    if (!hostJob.armed || hostJob.id != id)
+        return false;
+
+    CardOutcome cancelled = {0, AUDIT_NO_BLOCK, 0, 0};
+    MFRC522::Uid none;
+    none.size = 0;
+    hostJob.armed = false;
+    hostJob.passphrase = "";
+    sendJobResult(&Serial, id, cancelled, 0, none);
+    lcd_idle(&lcd, MODE, JOB);
+    return true;
+}
+
+/**
+ * @brief Execute a FRAME_CONSOLE batch, one FRAME_CONSOLE_REPLY per command
+ * @param payload Frame payload: sequence number, then the commands (console.h)
+ * @param length Payload length
+ */
+void runConsole(const byte *payload, byte length)
+{
+    if (length == 0)
+        return; // No sequence number: nothing the host could match a reply to
+
+    ConsoleCommand cmd;
+    byte pos = 1;
+    byte index = 0;
+    while (consoleNext(payload, length, &pos, &cmd))
+        runConsoleCommand(payload[0], index++, cmd);
+}
+
+/**
+ * @brief Execute one console command and send its reply
+ * @param seq Sequence number of the batch
+ * @param index Position of the command in the batch
+ * @param cmd Command and its arguments
+ */
+void runConsoleCommand(byte seq, byte index, const ConsoleCommand &cmd)
+{
+    FrameWriter frame(&Serial);
+    ConsoleStatus status = CONSOLE_OK;
+    const byte *uidBytes = cmd.args;
+    byte uidSize = cmd.length;
+
+    if (!cmd.args)
+    {
+        consoleReply(&Serial, seq, index, cmd.op, CONSOLE_MALFORMED);
+        return;
+    }
+
+    switch (cmd.op)
+    {
+    case CMD_STATUS:
+        consoleReplyBegin(&frame, seq, index, cmd.op, CONSOLE_OK, 6);
+        frame.write(AGENT);
+        frame.write(MODE);
+        frame.write(JOB);
+        frame.write(hostJob.armed);
+        frame.write(hostJob.id & 0xFF);
+        frame.write(hostJob.id >> 8);
+        frame.end();
+        return;
+
+    case CMD_STATS:
+    {
+        uint16_t values[3] = {stackPeakUsage(), freeHeap(), uidIndexCount()};
+        consoleReplyBegin(&frame, seq, index, cmd.op, CONSOLE_OK, 11 + 4 * COUNTER_COUNT);
+        for (byte i = 0; i < 4; i++)
+            frame.write((byte)(bootMicros >> (8 * i)));
+        for (byte v = 0; v < 3; v++)
+        {
+            frame.write(values[v] & 0xFF);
+            frame.write(values[v] >> 8);
+        }
+        frame.write(auditLogCount());
+        for (byte c = 0; c < COUNTER_COUNT; c++)
+        {
+            uint32_t count = counterValue((Counter)c);
+            for (byte i = 0; i < 4; i++)
+                frame.write((byte)(count >> (8 * i)));
+        }
+        frame.end();
+        return;
+    }
+
+    case CMD_MODE:
+        if (cmd.length != 2 || cmd.args[0] > MODE_WRITE || cmd.args[1] > SET)
+            status = CONSOLE_BAD_ARGS;
+        else if (cmd.args[0] == MODE_WRITE && !BoxRole::CAN_WRITE)
+            status = CONSOLE_UNSUPPORTED;
+        else if (cmd.args[0] == MODE_WRITE && cmd.args[1] == SET)
+            status = CONSOLE_BAD_ARGS; // SET only in READ mode, as with the buttons
+        else
+        {
+            MODE = (Mode)cmd.args[0];
+            JOB = (Job)cmd.args[1];
+            lcd_idle(&lcd, MODE, JOB);
+        }
+        consoleReplyBegin(&frame, seq, index, cmd.op, status, 2);
+        frame.write(MODE);
+        frame.write(JOB);
+        frame.end();
+        return;
+
+    case CMD_UID_PUT:
+        uidBytes++;
+        uidSize--;
+        // fall through
+    case CMD_UID_REMOVE:
+    case CMD_UID_LOOKUP:
+        if (cmd.length == 0 || (uidSize != 4 && uidSize != 7 && uidSize != 10))
+            status = CONSOLE_BAD_ARGS;
+        else if (cmd.op == CMD_UID_LOOKUP)
+        {
+            consoleReplyBegin(&frame, seq, index, cmd.op, CONSOLE_OK, 1);
+            frame.write(uidIndexLookup(uidBytes, uidSize));
+            frame.end();
+            return;
+        }
+        else if (cmd.op == CMD_UID_PUT && cmd.args[0] != UID_ALLOWED && cmd.args[0] != UID_DENIED)
+            status = CONSOLE_BAD_ARGS;
+        else if (cmd.op == CMD_UID_PUT ? uidIndexPut(uidBytes, uidSize, (UidStatus)cmd.args[0])
+                                       : uidIndexRemove(uidBytes, uidSize))
+            grantCacheClear(); // A cached grant must not outlive a list change
+        else
+            status = CONSOLE_FAILED;
+        break;
+
+    case CMD_LOG:
+        auditLogExport(&Serial);
+        break;
+
+    case CMD_TRACE:
+        if (!RF_TRACE)
+            status = CONSOLE_UNSUPPORTED;
+        else
+        {
+            traceExport(&Serial);
+            if (cmd.length > 0 && cmd.args[0] == 1)
+                traceClear();
+        }
+        break;
+
+    case CMD_DUMP:
+        dumpNext = true;
+        break;
+
+    case CMD_JOB:
+    {
+        JobAck ack = armHostJob(cmd.args, cmd.length);
+        consoleReplyBegin(&frame, seq, index, cmd.op, ack == JOB_ACCEPTED ? CONSOLE_OK : CONSOLE_FAILED, 1);
+        frame.write(ack);
+        frame.end();
+        return;
+    }
+
+    case CMD_JOB_CANCEL:
+        if (cmd.length != 2)
+            status = CONSOLE_BAD_ARGS;
+        else if (!cancelHostJob(jobId(cmd.args, cmd.length)))
+            status = CONSOLE_FAILED;
+        break;
+
+    default:
+        status = CONSOLE_UNKNOWN;
+        break;
+    }
+
+    consoleReply(&Serial, seq, index, cmd.op, status);
+}
+
+/**
+ * @brief Write the card presented for the armed host job
+ * @details Same write path as WRITE mode (provisionCard() / writeBuffer()), with the
+ *          job passphrase and an optional UID check. Ends the card session.
+ */
+void runHostJob()
+{
+    if (hostJob.uid.size > 0 &&
+        (hostJob.uid.size != rfid.uid.size || memcmp(hostJob.uid.uidByte, rfid.uid.uidByte, rfid.uid.size) != 0))
+    {
+        events.publish(EV_UID_MISMATCH);
+    }
+    else
+    {
+        // Job passphrase written as given, the master credential with its version tag
+        byte credential[16];
+        byte records[RECORDS_MAX_SIZE];
+        String master;
+        const byte *data = (const byte *)hostJob.passphrase.c_str();
+        int length = hostJob.passphrase.length();
+
+        if (CREDENTIAL_MODE == CREDENTIAL_UID_MAC)
+        {
+            if (length > 0)
+            {
+                byte key[MAC_KEY_SIZE];
+                deriveMacKey(hostJob.passphrase, key);
+                buildCredentialBlock(key, SECRET_VERSION_NONE, credential);
+            }
+            else
+                buildCredentialBlock(macKey, secretRingVersion(), credential);
+            data = credential;
+            length = sizeof(credential);
+        }
+        else if (CREDENTIAL_MODE == CREDENTIAL_RECORDS)
+        {
+            // Fields of the "badge" command, bound to this card
+            if (length > 0)
+            {
+                byte key[MAC_KEY_SIZE];
+                deriveMacKey(hostJob.passphrase, key);
+                length = buildIssueRecords(NULL, key, SECRET_VERSION_NONE, records);
+            }
+            else
+                length = buildIssueRecords(NULL, macKey, secretRingVersion(), records);
+            data = records;
+        }
+        else if (length == 0 && passphraseLost)
+        {
+            events.publish(EV_EEPROM_WRITE_FAILED); // Master passphrase lost: SET again
+            endCardSession();
+            return;
+        }
+        else if (length == 0)
+        {
+            master = passphrase;
+            appendVersionTag(&master, secretRingVersion());
+            data = (const byte *)master.c_str();
+            length = master.length();
+        }
+
+        if (REKEY_ON_WRITE && !(hostJob.flags & JOB_FLAG_NO_REKEY))
+            provisionCard(data, length);
+        else
+            writeBuffer(data, length, blocks, BLOCKS_COUNT);
+    }
+
+    endCardSession(); // Fills outcome while the events are drained
+}
+
+/**
+ * @brief Send the outcome of the card session to the host and release the job slot
+ */
+void finishHostJob()
+{
+    sendJobResult(&Serial, hostJob.id, outcome, cardDurationMs, rfid.uid);
+    hostJob.armed = false;
+    hostJob.passphrase = ""; // Do not keep the job secret in RAM
+    fired = false;
+}
+
+/**
+ * @brief Start or stop a clone session from a serial command
+ * @param arg Command argument: "" (backup to serial), " card" or " stop"
+ */
+void cloneCommand(const char *arg)
+{
+    if (strcmp(arg, " stop") == 0)
+    {
+        cloneCancel();
+        lcd_idle(&lcd, MODE, JOB);
+        Serial.println(F("Clone aborted"));
+        return;
+    }
+
+    if (strcmp(arg, " card") == 0)
+        cloneBegin(CLONE_TO_CARD, accessBits);
+    else if (arg[0] == '\0')
+        cloneBegin(CLONE_TO_SERIAL, accessBits);
+    else
+    {
+        Serial.println(F("Usage: clone [card|stop]"));
+        return;
+    }
+
+    lcd_clone_step(&lcd, false, 0);
+    Serial.println(F("Clone: present the source card"));
+}
+
+/**
+ * @brief Set or print the records written on the next cards
+ * @param arg Command argument: "" to print, " <id>" or " <id> <permissions hex>"
+ */
+void badgeCommand(const char *arg)
+{
+    if (arg[0] == ' ')
+    {
+        char *end;
+        issueRecords.badgeId = strtoul(arg + 1, &end, 10);
+        if (issueRecords.badgeId != 0)
+            issueRecords.present |= recordBit(REC_BADGE_ID);
+        else
+            issueRecords.present &= ~recordBit(REC_BADGE_ID);
+        if (*end == ' ')
+            issueRecords.permissions = strtoul(end + 1, NULL, 16);
+    }
+    else if (arg[0] != '\0')
+    {
+        Serial.println(F("Usage: badge [<id> [<permissions hex>]]"));
+        return;
+    }
+
+    Serial.print(F("Badge: "));
+    if (issueRecords.present & recordBit(REC_BADGE_ID))
+        Serial.print(issueRecords.badgeId);
+    else
+        Serial.print(F("kept"));
+    Serial.print(F(", permissions: "));
+    Serial.println(issueRecords.permissions, HEX);
+}
+
+/**
+ * @brief Set or print the entries loaded on the next cards
+ * @param arg Command argument: "" to print, " <n>" to limit, " off" for unlimited badges
+ */
+void usesCommand(const char *arg)
+{
+    if (strcmp(arg, " off") == 0)
+        issueUses = 0;
+    else if (arg[0] == ' ' && isdigit(arg[1]))
+        issueUses = strtol(arg + 1, NULL, 10);
+    else if (arg[0] != '\0')
+    {
+        Serial.println(F("Usage: uses [<n> | off]"));
+        return;
+    }
+
+    Serial.print(F("Uses: "));
+    if (issueUses > 0)
+        Serial.println(issueUses);
+    else
+        Serial.println(F("unlimited"));
+}
+
+/**
+ * @brief Update the UID index from a serial command
+ * @param arg UID in hex
+ * @param status UID_ALLOWED / UID_DENIED to insert, UID_UNKNOWN to remove
+ */
+void uidCommand(const char *arg, UidStatus status)
+{
+    byte uidBytes[10];
+    byte size = parseHexBytes(arg, uidBytes, sizeof(uidBytes));
+
+    if (size != 4 && size != 7 && size != 10)
+    {
+        Serial.println(F("Invalid UID: expected 4, 7 or 10 hex bytes"));
+        return;
+    }
+
+    bool done = status == UID_UNKNOWN ? uidIndexRemove(uidBytes, size)
+                                      : uidIndexPut(uidBytes, size, status);
+    if (done)
+        grantCacheClear(); // A cached grant must not outlive a list change
+    Serial.println(done ? F("OK") : (status == UID_UNKNOWN ? F("UID not listed") : F("UID index full")));
+}
+
+/**
+ * @brief Print the statistics dump on serial
+ * @details Boot time, memory telemetry and authentication counters.
+ */
+void printStats()
+{
+    Serial.println(F("--- STATS ---"));
+    printBootTime();
+    printMemoryStats();
+    printKeyringStats();
+    printSecretRing();
+    printGrantCacheStats();
+    printCounters();
+    printPowerStats();
+    if (CREDENTIAL_MODE == CREDENTIAL_PASSPHRASE)
+        printDigestTiming();
+    Serial.println(F("-------------"));
+}
+
+// ============================================================================
+// RFID CARD OPERATIONS
+// ============================================================================
+
+/**
+ * Function to change the sector key for a specific MIFARE Classic sector
+ * @param trailerBlock The trailer block number of the sector to change
+ * @param newKey Pointer to the new 6-byte key to set for the sector, in flash (secrets.h)
+ * @return true if the key change was successful, false otherwise
+ *
+ * @note The sector must already be authenticated (see provisionCard())
+ * @note Failures are published as events, rendered after the card is halted
+ */
+bool changeSectorKey(byte trailerBlock, const byte *newKey)
+{
+    MFRC522::StatusCode status;
+
+    // Prepare new trailer block data with new key and access bits
+    byte buffer[16];
+    for (byte i = 0; i < 6; i++)
+    {
+        buffer[i] = pgm_read_byte(newKey + i); // New Key A
+    }
+    for (byte i = 0; i < 4; i++)
+    {
+        buffer[6 + i] = accessBits[i]; // Access Bits
+    }
+    for (byte i = 0; i < 6; i++)
+    {
+        buffer[10 + i] = pgm_read_byte(newKey + i); // New Key B (same as Key A for simplicity)
+    }
+
+    // Write the new trailer block
+    status = rfid.MIFARE_Write(trailerBlock, buffer, 16);
+    if (status != MFRC522::STATUS_OK)
+    {
+        events.publish(EV_BLOCK_WRITE_FAILED, trailerBlock, status);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Authenticate with RFID card using Key A
+ * @details Performs MIFARE Classic authentication for a specific block using Key A.
+ *          This is required before any read or write operation can be performed.
+ *          The keys of KEYRING are probed starting from the one cached for this card
+ *          (see keyring.h). A failure is published as EV_AUTH_FAILED with the block
+ *          and the status code of the last attempt.
+ * @param block The block number to authenticate (0-63 for MIFARE Classic 1K)
+ * @return true if authentication successful, false if failed
+ */
+bool authenticateA(byte block)
+{
+    MFRC522::StatusCode status;
+    keyringAuthenticate(&rfid, block, &status);
+
+    if (status != MFRC522::STATUS_OK)
+    {
+        events.publish(EV_AUTH_FAILED, block, status);
+        return false;
+    }
+    else
+        return true;
+}
+
+/**
+ * @brief Verify RFID card compatibility with system requirements
+ * @details MIFARE Classic cards support every operation. Ultralight / NTAG tags
+ *          (ultralight.h) carry the same credential in pages, but the sector based
+ *          dump and clone do not apply to them. Their pages can be read by anyone
+ *          without authentication, so they only carry UID-bound credentials: never
+ *          the passphrase (CREDENTIAL_PASSPHRASE cards, SET master cards).
+ * @return true if the card is compatible with the pending operation, false otherwise
+ */
+bool checkCompatibility()
+{
+    MFRC522::PICC_Type piccType = rfid.PICC_GetType(rfid.uid.sak);
+
+    if (cardIsUltralight)
+        return CREDENTIAL_MODE != CREDENTIAL_PASSPHRASE && JOB == RUN && !dumpNext &&
+               (!BoxRole::CAN_WRITE || cloneStage() == CLONE_IDLE);
+
+    return piccType == MFRC522::PICC_TYPE_MIFARE_MINI ||
+           piccType == MFRC522::PICC_TYPE_MIFARE_1K ||
+           piccType == MFRC522::PICC_TYPE_MIFARE_4K;
+}
+
+/**
+ * @brief Halt the card and render the feedback collected during the exchange
+ * @details Closes the RF critical section: the card is put to sleep, the reader
+ *          stops encryption and only then the queued events are drained to the
+ *          LCD, serial and buzzer consumers.
+ */
+void endCardSession()
+{
+    rfid.PICC_HaltA();      // Put card to sleep
+    rfid.PCD_StopCrypto1(); // Stop encryption on reader
+    cardDurationMs = millis() - cardStartMs;
+    drainEvents();
+}
+
+/**
+ * @brief Authenticate and read a single block
+ * @details Failures are published as EV_AUTH_FAILED / EV_BLOCK_READ_FAILED.
+ * @param block Block number
+ * @param buffer Destination buffer, at least 18 bytes (16 data bytes + 2 CRC bytes)
+ * @return true if the block was read
+ */
+bool readBlock(byte block, byte *buffer)
+{
+    byte len = 18;
+
+    if (!authenticateA(block))
+        return false;
+
+    MFRC522::StatusCode status = rfid.MIFARE_Read(block, buffer, &len);
+    if (status != MFRC522::STATUS_OK)
+    {
+        events.publish(EV_BLOCK_READ_FAILED, block, status);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Build the UID-MAC credential block of the card in the field
+ * @param key Device key of the secret
+ * @param version Secret version stored in the block
+ * @param credential Destination (16 bytes)
+ */
+void buildCredentialBlock(const byte *key, byte version, byte *credential)
+{
+    buildUidMacBlock(key, rfid.uid, credential);
+    credential[UID_MAC_SECRET_VERSION] = version;
+}
+
+/**
+ * @brief Check the digest of a card passphrase against the current and retired secrets
+ * @details A tagged card is compared with one secret only: its version selects it.
+ *          Untagged cards are compared with the current secret, then with each
+ *          retired secret.
+ * @param digest deriveMacKey() of the passphrase without version tag (readCredentialDigest())
+ * @param version Card version
+ * @return Match result, SECRET_INVALID while the box has no secret (secretSet)
+ */
+SecretMatch matchPassphrase(const byte *digest, byte version)
+{
+    if (!secretSet)
+        return SECRET_INVALID; // Public key: nothing may match it
+
+    if ((version == SECRET_VERSION_NONE || version == secretRingVersion()) && memcmp(digest, macKey, MAC_KEY_SIZE) == 0)
+        return version == SECRET_VERSION_NONE ? SECRET_OUTDATED : SECRET_CURRENT;
+
+    byte retired[MAC_KEY_SIZE];
+    for (byte slot = 0; slot < SECRET_RING_SLOTS; slot++)
+    {
+        byte candidate = version != SECRET_VERSION_NONE ? version : secretRingSlotVersion(slot);
+        if (secretRingKey(candidate, retired) && memcmp(digest, retired, MAC_KEY_SIZE) == 0)
+            return SECRET_OUTDATED;
+        if (version != SECRET_VERSION_NONE)
+            break; // Tagged card: only its own version
+    }
+    return SECRET_INVALID;
+}
+
+/**
+ * @brief Check a UID-MAC credential block against the current and retired keys
+ * @param block Credential block read from the card
+ * @return Match result, SECRET_INVALID while the box has no secret (secretSet)
+ */
+SecretMatch matchUidMac(const byte *block)
+{
+    byte version = block[UID_MAC_SECRET_VERSION];
+    if (!secretSet)
+        return SECRET_INVALID; // Public key: anyone could forge the block
+
+    if ((version == SECRET_VERSION_NONE || version == secretRingVersion()) && verifyUidMacBlock(macKey, rfid.uid, block))
+        return version == SECRET_VERSION_NONE ? SECRET_OUTDATED : SECRET_CURRENT;
+
+    byte retired[MAC_KEY_SIZE];
+    for (byte slot = 0; slot < SECRET_RING_SLOTS; slot++)
+    {
+        byte candidate = version != SECRET_VERSION_NONE ? version : secretRingSlotVersion(slot);
+        if (secretRingKey(candidate, retired) && verifyUidMacBlock(retired, rfid.uid, block))
+            return SECRET_OUTDATED;
+        if (version != SECRET_VERSION_NONE)
+            break; // Versioned card: only its own key
+    }
+    return SECRET_INVALID;
+}
+
+/**
+ * @brief Read and check the records of the card in the field (CREDENTIAL_RECORDS)
+ * @details The first block gives the secret version, hence the key; then blocks are
+ *          fed to the parser one by one and reading stops at the block where the
+ *          credential record ends: the fields after it are never read.
+ *          An unversioned card is checked with the current key only.
+ *          A valid card leaves its fields in cardRecords.
+ * @param match Match result, SECRET_INVALID for a blank or foreign card, or while the
+ *              box has no secret (secretSet)
+ * @param version Secret version of the card
+ * @return true if the blocks were read, false on RF failure (event published)
+ *
+ * @note Runs inside the RF critical section: no LCD/serial output, only events
+ */
+bool readCardRecords(SecretMatch *match, byte *version)
+{
+    RecordsReader reader;
+    byte buffer[18]; // 16 data bytes + 2 CRC bytes
+    byte key[MAC_KEY_SIZE];
+    byte count = 0;
+    bool more = true;
+
+    *match = SECRET_INVALID;
+    *version = SECRET_VERSION_NONE;
+
+    while (more && count < BLOCKS_COUNT)
+    {
+        if (!(cardIsUltralight ? readUltralightBlock(count, buffer) : readBlock(blocks[count], buffer)))
+            return false;
+        count++;
+
+        if (count == 1)
+        {
+            if (!recordsHeader(buffer, version))
+                break; // Blank or foreign card
+            if (*version == SECRET_VERSION_NONE || *version == secretRingVersion())
+                memcpy(key, macKey, MAC_KEY_SIZE);
+            else if (!secretRingKey(*version, key))
+                break; // Retired too long ago
+            recordsBegin(&reader, key, rfid.uid);
+        }
+        more = recordsFeed(&reader, buffer);
+    }
+
+    events.publish(EV_CARD_READ, count);
+    if (!more && recordsValid(&reader) && secretSet) // Public key: anyone could forge the records
+    {
+        cardRecords = reader.records;
+        *match = *version == secretRingVersion() ? SECRET_CURRENT : SECRET_OUTDATED;
+    }
+    return true;
+}
+
+/**
+ * @brief Payload for the card in the field from the "badge" command fields
+ * @param previous Fields of the valid card being re-issued, NULL for a new card
+ * @param key Device key of the secret
+ * @param version Secret version of the key
+ * @param data Destination (RECORDS_MAX_SIZE bytes)
+ * @return Payload length
+ */
+byte buildIssueRecords(const CardRecords *previous, const byte *key, byte version, byte *data)
+{
+    CardRecords fields = issueRecords;
+    fields.issue = 1;
+    fields.present |= recordBit(REC_ISSUE);
+
+    if (previous != NULL)
+    {
+        fields.issue = previous->issue + 1;
+        if (!(fields.present & recordBit(REC_BADGE_ID)) && (previous->present & recordBit(REC_BADGE_ID)))
+        {
+            fields.badgeId = previous->badgeId; // Same badge, new issue
+            fields.present |= recordBit(REC_BADGE_ID);
+        }
+    }
+    return buildRecords(&fields, key, version, rfid.uid, data);
+}
+
+/**
+ * @brief Rewrite an accepted card with the current secret and version
+ * @details Runs before the door opens, while the badge is still held. Data blocks
+ *          only, the sector keys are not touched; with INCREMENTAL_WRITE only the
+ *          blocks that change are written (one block to tag an untagged card).
+ *          The passphrase is followed by one empty block, so leftovers of a longer
+ *          old passphrase are never read back.
+ * @param oldVersion Secret version the card had
+ */
+void upgradeCard(byte oldVersion)
+{
+    bool written;
+    if (CREDENTIAL_MODE == CREDENTIAL_UID_MAC)
+    {
+        byte credential[16];
+        buildCredentialBlock(macKey, secretRingVersion(), credential);
+        written = writeBuffer(credential, sizeof(credential), blocks, 1);
+    }
+    else if (CREDENTIAL_MODE == CREDENTIAL_RECORDS)
+    {
+        byte data[RECORDS_MAX_SIZE]; // Same fields, new MAC and version
+        byte length = buildRecords(&cardRecords, macKey, secretRingVersion(), rfid.uid, data);
+        written = writeBuffer(data, length, blocks, (length + 15) / 16);
+    }
+    else
+    {
+        String data = passphrase;
+        appendVersionTag(&data, secretRingVersion());
+        int count = min((int)(data.length() + 15) / 16 + 1, BLOCKS_COUNT);
+        written = writeBuffer((const byte *)data.c_str(), data.length(), blocks, count);
+    }
+
+    if (written)
+        events.publish(EV_CARD_UPGRADED, oldVersion);
+}
+
+/**
+ * @brief Read passphrase data from multiple RFID card blocks
  * @details Sequentially reads data from all specified blocks and concatenates them
  *          into a single passphrase string. The function handles authentication,
  *          error checking, and stops reading when empty blocks are encountered.
@@ -503,244 +1680,894 @@ bool checkCompatibility()
  * @param blocksArray Pointer to array of block numbers to read from
  * @param blocksCount Number of blocks in the array
  * @return Concatenated passphrase string from all blocks, or empty string if error occurred
+ *         (failure event published) or the card is blank (EV_CARD_BLANK published)
  *
- * @note The function automatically handles RFID communication cleanup (halt and stop crypto)
+ * @note Runs inside the RF critical section: no LCD/serial output, only events
+ * @note The caller closes the exchange with endCardSession()
  * @note Reading stops early if an empty block is encountered to avoid processing null data
  */
 String readTag(int *blocksArray, int blocksCount)
 {
-    byte len = 18;          // Buffer size: 16 data bytes + 2 CRC bytes
     String finalValue = ""; // Accumulated passphrase from all blocks
-
-    Serial.println(F("Reading data from all blocks..."));
-    Serial.println();
+    byte blocksRead = 0;
 
     // Process each block in sequence
     for (int i = 0; i < blocksCount; i++)
     {
-        byte currentBlock = blocksArray[i];
-        byte buffer[len];       // Temporary buffer for block data
-        String blockValue = ""; // ASCII content of current block
+        byte buffer[18]; // Temporary buffer for block data: 16 data bytes + 2 CRC bytes
 
-        // Authenticate before reading each block
-        if (!authenticateA(currentBlock))
-        {
-            Serial.print(F("CRITICAL ERROR: Authentication failed for block "));
-            Serial.println(currentBlock);
-            Serial.println(F("Stopping read operation due to authentication failure."));
-            Serial.println();
-            lcd_authentication_error(&lcd);
-            return ""; // Authentication failure is critical - abort entire operation
-        }
+        // Authentication or read failure is critical - abort entire operation
+        if (!(cardIsUltralight ? readUltralightBlock(i, buffer) : readBlock(blocksArray[i], buffer)))
+            return "";
 
-        // Attempt to read data from the authenticated block
-        MFRC522::StatusCode status = rfid.MIFARE_Read(currentBlock, buffer, &len);
-        if (status != MFRC522::STATUS_OK)
-        {
-            Serial.print(F("CRITICAL ERROR: Reading failed on block "));
-            Serial.print(currentBlock);
-            Serial.print(F(": "));
-            Serial.println(rfid.GetStatusCodeName(status));
-            Serial.println(F("Stopping read operation due to read failure."));
-            Serial.println();
-            lcd_read_block_error(&lcd, currentBlock);
-            return ""; // Read failure is critical - abort entire operation
-        }
-        else
-        {
-            // Successfully read block - process the data
-            Serial.print(F("Data in block "));
-            Serial.print(currentBlock);
-            Serial.println(F(":"));
-            dump_byte_array(buffer, len - 2); // Display raw hex data (excluding CRC)
-            Serial.println();
-
-            // Convert binary data to ASCII string
-            blockValue = bufferToString(buffer, len - 2);
-            blockValue.trim(); // Remove leading/trailing whitespace
-            Serial.print(F("Block "));
-            Serial.print(currentBlock);
-            Serial.print(F(" content: "));
-            Serial.println(blockValue);
-            Serial.println();
-
-            // Check for empty block - indicates end of passphrase data
-            if (blockValue.length() == 0)
-            {
-                Serial.print(F("Found empty block "));
-                Serial.print(currentBlock);
-                Serial.println(F(", stopping read operation."));
-                Serial.println();
-                break; // Stop reading when empty block is found
-            }
+        // Convert binary data to ASCII string
+        String blockValue = bufferToString(buffer, 16);
+        blockValue.trim(); // Remove leading/trailing whitespace
 
-            // Append block content to final passphrase
-            finalValue += blockValue;
-        }
+        // Check for empty block - indicates end of passphrase data
+        if (blockValue.length() == 0)
+            break; // Stop reading when empty block is found
+
+        // Append block content to final passphrase
+        finalValue += blockValue;
+        blocksRead++;
     }
 
     // Clean up the final result
     finalValue.trim();
+    events.publish(EV_CARD_READ, blocksRead);
+    if (finalValue.length() == 0)
+        events.publish(EV_CARD_BLANK); // Read fine, nothing written on the card
 
-    Serial.print(F("Final concatenated value: "));
-    Serial.println(finalValue);
-    Serial.println();
+    return finalValue;
+}
 
-    // Properly terminate RFID communication
-    rfid.PICC_HaltA();      // Put card to sleep
-    rfid.PCD_StopCrypto1(); // Stop encryption on reader
+/**
+ * @brief Read the passphrase of the card straight into its digest
+ * @details Same rules as readTag(): null bytes dropped, each block trimmed, reading
+ *          stops at the first empty block. But every block is fed to the incremental
+ *          deriveMacKey() as soon as it is read, so the passphrase is never assembled
+ *          in RAM. The last two bytes are held back until the end: they may be the
+ *          version tag (takeVersionTag(), secret-ring.h), which is not hashed.
+ *          Hashing time and total time are kept for the "stats" command.
+ *
+ * @param blocksArray Pointer to array of block numbers to read from
+ * @param blocksCount Number of blocks in the array
+ * @param digest Destination (MAC_KEY_SIZE bytes)
+ * @param version Secret version of the card, SECRET_VERSION_NONE if untagged
+ * @return true if a non-empty passphrase was read, false on error or blank card, a
+ *         version tag alone counting as blank (failure event or EV_CARD_BLANK published)
+ *
+ * @note Runs inside the RF critical section: no LCD/serial output, only events
+ */
+bool readCredentialDigest(int *blocksArray, int blocksCount, byte *digest, byte *version)
+{
+    SecretDigest hash;
+    byte held[2];       // Last two bytes, maybe the version tag
+    byte heldCount = 0;
+    byte blocksRead = 0;
+    int hashed = 0;     // Passphrase bytes fed to the digest, version tag excluded
+    unsigned long start = micros();
 
-    return finalValue;
+    secretDigestBegin(&hash);
+    digestMicros = 0;
+    *version = SECRET_VERSION_NONE;
+
+    for (int i = 0; i < blocksCount; i++)
+    {
+        byte buffer[18]; // 16 data bytes + 2 CRC bytes
+
+        // Authentication or read failure is critical - abort entire operation
+        if (!(cardIsUltralight ? readUltralightBlock(i, buffer) : readBlock(blocksArray[i], buffer)))
+            return false;
+
+        unsigned long hashStart = micros();
+
+        // Block content as readTag() sees it: no null bytes, trimmed
+        byte length = 0;
+        for (byte j = 0; j < 16; j++)
+            if (buffer[j] != 0x00)
+                buffer[length++] = buffer[j];
+        byte first = 0;
+        while (first < length && isspace(buffer[first]))
+            first++;
+        while (length > first && isspace(buffer[length - 1]))
+            length--;
+
+        if (length == first)
+            break; // Empty block: end of the passphrase
+
+        for (byte j = first; j < length; j++)
+        {
+            if (heldCount == 2)
+            {
+                secretDigestUpdate(&hash, held, 1);
+                hashed++;
+                held[0] = held[1];
+                heldCount--;
+            }
+            held[heldCount++] = buffer[j];
+        }
+        blocksRead++;
+        digestMicros += micros() - hashStart;
+    }
+
+    // Version tag: marker + version, or a marker alone (upgrade torn in between)
+    unsigned long hashStart = micros();
+    if (heldCount > 0 && held[heldCount - 1] == SECRET_TAG_MARKER)
+        heldCount--;
+    else if (heldCount == 2 && held[0] == SECRET_TAG_MARKER && (held[1] & SECRET_TAG_VERSION_BIT))
+    {
+        *version = held[1] & ~SECRET_TAG_VERSION_BIT;
+        heldCount = 0;
+    }
+    secretDigestUpdate(&hash, held, heldCount);
+    hashed += heldCount;
+    secretDigestEnd(&hash, digest);
+    digestMicros += micros() - hashStart;
+
+    readMicros = micros() - start;
+    digestBlocks = blocksRead;
+    events.publish(EV_CARD_READ, blocksRead);
+    if (hashed == 0)
+        events.publish(EV_CARD_BLANK); // Read fine, nothing written on the card but a version tag
+    return hashed > 0;
+}
+
+/**
+ * @brief Print the cost of hashing the last credential read
+ * @details Hashing runs between two block reads: its share of the read time is the
+ *          latency it adds to a tap.
+ */
+void printDigestTiming()
+{
+    Serial.print(F("Last credential read: "));
+    Serial.print(digestBlocks);
+    Serial.print(F(" blocks, "));
+    Serial.print(readMicros);
+    Serial.print(F(" us, hashing "));
+    Serial.print(digestMicros);
+    Serial.println(F(" us"));
 }
 
 /**
  * @brief Write passphrase data to multiple RFID card blocks
  * @details Distributes a passphrase string across multiple MIFARE Classic blocks,
- *          writing 16 bytes per block. The function handles authentication,
- *          data padding, and clearing of unused blocks. Remaining blocks are
- *          filled with null bytes to ensure clean card state.
+ *          writing 16 bytes per block (see writeBuffer()).
  *
  * @param data Pointer to string containing passphrase to write to card
  * @param blocksArray Pointer to array of block numbers to write to
  * @param blocksCount Number of blocks available for writing
  * @return true if all blocks written successfully, false if any error occurred
+ */
+bool writeTag(String *data, int *blocksArray, int blocksCount)
+{
+    return writeBuffer((const byte *)data->c_str(), data->length(), blocksArray, blocksCount);
+}
+
+/**
+ * @brief Write raw data to multiple RFID card blocks
+ * @details Distributes the data across multiple MIFARE Classic blocks, writing
+ *          16 bytes per block. The function handles authentication, data padding,
+ *          and clearing of unused blocks. Remaining blocks are filled with null
+ *          bytes to ensure clean card state.
+ *          Each sector is authenticated once; with INCREMENTAL_WRITE blocks that
+ *          already hold the right bytes are not rewritten (see updateBlock()).
+ *
+ * @param data Bytes to write
+ * @param dataLength Number of bytes to write
+ * @param blocksArray Pointer to array of block numbers to write to
+ * @param blocksCount Number of blocks available for writing
+ * @return true if all blocks written successfully, false if any error occurred
  *
- * @note Each block holds exactly 16 bytes; longer passphrases span multiple blocks
+ * @note Each block holds exactly 16 bytes; longer data spans multiple blocks
  * @note Unused blocks are cleared with null bytes to prevent data leakage
- * @note Function automatically handles RFID communication cleanup
+ * @note Runs inside the RF critical section: no LCD/serial output, only events
+ * @note The caller closes the exchange with endCardSession()
  */
-bool writeTag(String *data, int *blocksArray, int blocksCount)
+bool writeBuffer(const byte *data, int dataLength, int *blocksArray, int blocksCount)
 {
-    int dataLength = data->length();
-    int dataIndex = 0; // Current position in the source data string
+    byte written = 0;       // Blocks physically written
+    byte skipped = 0;       // Blocks already up to date
+    int sector = -1;        // Sector currently authenticated
 
-    Serial.println(F("Writing data to all blocks..."));
-    Serial.print(F("Data to write: "));
-    Serial.println(*data);
-    Serial.print(F("Data length: "));
-    Serial.println(dataLength);
-    Serial.println();
+    if (cardIsUltralight)
+        return writeUltralight(data, dataLength, blocksCount, false);
 
-    // Process each block in sequence
+    // Process each block in sequence: data blocks first, then the remaining
+    // blocks are cleared with null bytes so no old data remains on the card
     for (int i = 0; i < blocksCount; i++)
     {
         byte currentBlock = blocksArray[i];
         byte buffer[16]; // MIFARE Classic blocks are exactly 16 bytes
+        bool changed;
 
-        // Initialize buffer with null bytes
-        memset(buffer, 0x00, 16);
+        if (usageReserved(currentBlock))
+            continue; // Entry counter sector, never cleared (usage-counter.h)
 
-        // Fill buffer with data or leave as nulls if no more data
-        for (int j = 0; j < 16; j++)
-        {
-            if (dataIndex < dataLength)
-            {
-                buffer[j] = (*data)[dataIndex];
-                dataIndex++;
-            }
-            else
-            {
-                buffer[j] = 0x00; // Pad remaining space with null bytes
-            }
-        }
+        // Fill buffer with data, padding remaining space with null bytes
+        fillBlock(data, dataLength, i, buffer);
 
-        // Authenticate before writing to each block
-        if (!authenticateA(currentBlock))
+        // Authenticate once per sector
+        if (currentBlock / 4 != sector)
         {
-            Serial.print(F("CRITICAL ERROR: Authentication failed for block "));
-            Serial.println(currentBlock);
-            Serial.println(F("Stopping write operation due to authentication failure."));
-            Serial.println();
-            lcd_authentication_error(&lcd);
-            return false; // Authentication failure is critical - abort operation
+            if (!authenticateA(currentBlock))
+                return false; // Authentication failure is critical - abort operation
+            sector = currentBlock / 4;
         }
 
-        // Attempt to write data to the authenticated block
-        MFRC522::StatusCode status = rfid.MIFARE_Write(currentBlock, buffer, 16);
+        if (!updateBlock(currentBlock, buffer, &changed))
+            return false; // Read or write failure is critical - abort operation
+        changed ? written++ : skipped++;
+    }
+
+    events.publish(EV_CARD_WRITTEN, written);
+    if (skipped > 0)
+        events.publish(EV_BLOCKS_UNCHANGED, skipped);
+    return true; // All operations completed successfully
+}
+
+/**
+ * @brief Content of the n-th data block for the given data
+ * @param data Bytes to write
+ * @param dataLength Number of bytes to write
+ * @param index Position of the block in the blocks array
+ * @param buffer Destination, 16 bytes: data slice padded with null bytes
+ */
+void fillBlock(const byte *data, int dataLength, int index, byte *buffer)
+{
+    int dataIndex = index * 16;
+    for (byte j = 0; j < 16; j++, dataIndex++)
+        buffer[j] = dataIndex < dataLength ? data[dataIndex] : 0x00;
+}
+
+/**
+ * @brief Write one block of the authenticated sector
+ * @details With INCREMENTAL_WRITE the block is read first and MIFARE_Write is
+ *          skipped when it already holds the same 16 bytes: a read is faster than
+ *          a write and spares the card's EEPROM.
+ * @param block Block number (its sector must be authenticated)
+ * @param buffer 16 bytes to write
+ * @param written Set to true if the block was written, false if skipped
+ * @return true if the block holds the data, false on RF failure (event published)
+ */
+bool updateBlock(byte block, byte *buffer, bool *written)
+{
+    MFRC522::StatusCode status;
+    *written = false;
+
+    if (INCREMENTAL_WRITE)
+    {
+        byte current[18]; // 16 data bytes + 2 CRC bytes
+        byte len = sizeof(current);
+        status = rfid.MIFARE_Read(block, current, &len);
         if (status != MFRC522::STATUS_OK)
         {
-            Serial.print(F("CRITICAL ERROR: Writing failed on block "));
-            Serial.print(currentBlock);
-            Serial.print(F(": "));
-            Serial.println(rfid.GetStatusCodeName(status));
-            Serial.println(F("Stopping write operation due to write failure."));
-            Serial.println();
-            lcd_write_block_error(&lcd);
-            return false; // Write failure is critical - abort operation
+            events.publish(EV_BLOCK_READ_FAILED, block, status);
+            return false;
         }
-        else
-        {
-            // Successfully wrote to block - log the operation
-            Serial.print(F("Successfully wrote to block "));
-            Serial.print(currentBlock);
-            Serial.print(F(" - Data: "));
+        if (memcmp(current, buffer, 16) == 0)
+            return true; // Already up to date
+    }
 
-            // Display the ASCII content written to this block
-            String blockData = "";
-            for (int k = 0; k < 16; k++)
-            {
-                if (buffer[k] != 0x00)
-                    blockData += (char)buffer[k];
-            }
-            Serial.println(blockData);
+    status = rfid.MIFARE_Write(block, buffer, 16);
+    if (status != MFRC522::STATUS_OK)
+    {
+        events.publish(EV_BLOCK_WRITE_FAILED, block, status);
+        return false;
+    }
+
+    *written = true;
+    return true;
+}
+
+/**
+ * @brief Check if the authenticated sector already has the provisioning key and access bits
+ * @details Key A always reads back as zeros: the key is proven by the authentication
+ *          itself (first KEYRING entry, crypto_key), the access bits are read back.
+ * @param trailer Trailer block of the authenticated sector
+ * @return true if the trailer does not need to be rewritten
+ */
+bool trailerUpToDate(byte trailer)
+{
+    byte current[18];
+    byte len = sizeof(current);
+
+    if (keyringLastIndex() != 0)
+        return false;
+    if (rfid.MIFARE_Read(trailer, current, &len) != MFRC522::STATUS_OK)
+        return false; // Unknown state: rewrite
+    return memcmp(current + 6, accessBits, 4) == 0;
+}
+
+/**
+ * @brief Write, re-key and verify the card in a single pass
+ * @details For each sector of the blocks array:
+ *          1. authenticate once, with whichever KEYRING key the sector has
+ *          2. write the data blocks (unused blocks cleared with null bytes),
+ *             skipping those already up to date with INCREMENTAL_WRITE
+ *          3. write the trailer with crypto_key and accessBits (changeSectorKey()),
+ *             unless the sector already has both
+ *          4. authenticate again with crypto_key and read the data blocks back
+ *          A sector where nothing changed needs no verification.
+ *          The USAGE_SECTOR sector has no data blocks; once it is an entry counter
+ *          its trailer is left alone (usage-counter.h).
+ *
+ *          Progress is recorded in the EEPROM journal (journal.h) after every verified
+ *          sector: if the card is pulled half way, presenting it again with the same
+ *          data resumes from the first sector not yet verified.
+ *
+ * @param data Bytes to write
+ * @param dataLength Number of bytes to write
+ * @return true if every sector was written, re-keyed and verified
+ *
+ * @note Runs inside the RF critical section: no LCD/serial output, only events
+ * @note The caller closes the exchange with endCardSession()
+ */
+bool provisionCard(const byte *data, int dataLength)
+{
+    MFRC522::StatusCode status;
+    byte buffer[18]; // 16 data bytes + 2 CRC bytes
+    byte expected[16];
+    byte written = 0; // Data blocks physically written
+    byte skipped = 0; // Data blocks already up to date
+    byte rekeyed = 0; // Trailers rewritten
+
+    if (cardIsUltralight)
+        return writeUltralight(data, dataLength, BLOCKS_COUNT, true); // Password instead of sector keys
+
+    uint16_t dataCrc = 0xFFFF;
+    for (int i = 0; i < dataLength; i++)
+        dataCrc = crc16Update(dataCrc, data[i]);
+
+    byte first = journalResumeSector(rfid.uid, dataCrc);
+    if (first > 0)
+        events.publish(EV_PROVISION_RESUMED, first);
+    else
+        journalOpen(rfid.uid, dataCrc);
+
+    for (byte sector = first; sector < TRAILER_BLOCKS_COUNT; sector++)
+    {
+        byte trailer = trailerBlocks[sector];
+        int index = sector * DATA_BLOCKS_PER_SECTOR; // First data block of the sector
+        byte dataBlocks = usageReserved(trailer) ? 0 : DATA_BLOCKS_PER_SECTOR;
+        bool changed = false;
+
+        // 1. One authentication covers the whole sector
+        if (!authenticateA(trailer))
+            return false;
+
+        // 2. Data blocks
+        for (byte k = 0; k < dataBlocks; k++)
+        {
+            bool blockWritten;
+            fillBlock(data, dataLength, index + k, expected);
+            if (!updateBlock(blocks[index + k], expected, &blockWritten))
+                return false;
+            blockWritten ? written++ : skipped++;
+            changed |= blockWritten;
         }
 
-        // Check if all data has been written
-        if (dataIndex >= dataLength)
+        // 3. Trailer: new key and access bits
+        if (!trailerUpToDate(trailer) && !(dataBlocks == 0 && usageIsCounter(&rfid, trailer)))
         {
-            Serial.println(F("All data written successfully. Remaining blocks will be cleared."));
-            Serial.println();
+            if (!changeSectorKey(trailer, crypto_key))
+                return false;
+            rekeyed++;
+            changed = true;
+        }
 
-            // Clear any remaining blocks to ensure no old data remains
-            for (int remainingBlock = i + 1; remainingBlock < blocksCount; remainingBlock++)
+        // 4. Verify: the new key must be accepted and the data must read back unchanged
+        if (changed)
+        {
+            if (!keyringAuthenticatePreferred(&rfid, trailer, &status))
             {
-                byte nullBuffer[16];
-                memset(nullBuffer, 0x00, 16); // Create buffer of null bytes
+                events.publish(EV_AUTH_FAILED, trailer, status);
+                return false;
+            }
 
-                if (!authenticateA(blocksArray[remainingBlock]))
+            for (byte k = 0; k < dataBlocks; k++)
+            {
+                byte len = sizeof(buffer);
+                fillBlock(data, dataLength, index + k, expected);
+                status = rfid.MIFARE_Read(blocks[index + k], buffer, &len);
+                if (status != MFRC522::STATUS_OK)
                 {
-                    Serial.print(F("CRITICAL ERROR: Authentication failed for clearing block "));
-                    Serial.println(blocksArray[remainingBlock]);
-                    Serial.println(F("Stopping write operation due to authentication failure."));
-                    lcd_authentication_error(&lcd);
+                    events.publish(EV_BLOCK_READ_FAILED, blocks[index + k], status);
                     return false;
                 }
-
-                MFRC522::StatusCode clearStatus = rfid.MIFARE_Write(blocksArray[remainingBlock], nullBuffer, 16);
-                if (clearStatus != MFRC522::STATUS_OK)
+                if (memcmp(buffer, expected, 16) != 0)
                 {
-                    Serial.print(F("CRITICAL ERROR: Failed to clear block "));
-                    Serial.print(blocksArray[remainingBlock]);
-                    Serial.print(F(": "));
-                    Serial.println(rfid.GetStatusCodeName(clearStatus));
-                    Serial.println(F("Stopping write operation due to write failure."));
-                    lcd_write_block_error(&lcd);
+                    events.publish(EV_VERIFY_FAILED, blocks[index + k]);
                     return false;
                 }
-                else
-                {
-                    Serial.print(F("Cleared block "));
-                    Serial.println(blocksArray[remainingBlock]);
-                }
             }
-            break; // Exit loop after clearing remaining blocks
         }
+
+        journalAdvance(sector + 1);
     }
 
-    // Properly terminate RFID communication
-    rfid.PICC_HaltA();      // Put card to sleep
-    rfid.PCD_StopCrypto1(); // Stop encryption on reader
+    journalClose();
+    events.publish(EV_SECTOR_REKEYED, rekeyed);
+    events.publish(EV_CARD_WRITTEN, written);
+    if (skipped > 0)
+        events.publish(EV_BLOCKS_UNCHANGED, skipped);
+    return true;
+}
 
-    Serial.println(F("Write operation completed successfully."));
-    Serial.println();
+/**
+ * @brief Read one credential block of an Ultralight / NTAG tag
+ * @details No authentication: one READ returns the 4 pages of the block.
+ *          A failure is published as EV_BLOCK_READ_FAILED with the first page.
+ * @param index Position of the block in the credential
+ * @param buffer Destination buffer, at least 18 bytes (16 data bytes + 2 CRC bytes)
+ * @return true if the block was read
+ */
+bool readUltralightBlock(byte index, byte *buffer)
+{
+    MFRC522::StatusCode status = ultralightReadBlock(&rfid, index, buffer);
+    if (status != MFRC522::STATUS_OK)
+    {
+        events.publish(EV_BLOCK_READ_FAILED, ultralightPage(index), status);
+        return false;
+    }
+    return true;
+}
 
-    return true; // All operations completed successfully
+/**
+ * @brief Write raw data to an Ultralight / NTAG tag
+ * @details Same layout as writeBuffer(): data blocks first, then the remaining blocks
+ *          cleared with null bytes, only the blocks that change with INCREMENTAL_WRITE.
+ *          A write protected tag is unlocked with ntag_password first. The data must
+ *          leave at least one empty block on the tag, where the reader stops.
+ *          With protect an unprotected tag gets ntag_password on its user pages and
+ *          the blocks are read back, like provisionCard() does for Classic cards.
+ *
+ * @param data Bytes to write
+ * @param dataLength Number of bytes to write
+ * @param blocksCount Number of credential blocks to write (capped to the tag memory)
+ * @param protect Write protect the tag and verify (provisionCard())
+ * @return true if all blocks were written successfully
+ *
+ * @note Runs inside the RF critical section: no LCD/serial output, only events
+ */
+bool writeUltralight(const byte *data, int dataLength, int blocksCount, bool protect)
+{
+    MFRC522::StatusCode status;
+    UltralightInfo info;
+    bool locked = false;
+    byte page;
+    byte written = 0; // Blocks physically written
+    byte skipped = 0; // Blocks already up to date
+
+    status = ultralightIdentify(&rfid, &info);
+    if (status == MFRC522::STATUS_OK)
+        status = ultralightIsProtected(&rfid, info, &locked);
+    if (status != MFRC522::STATUS_OK)
+    {
+        events.publish(EV_BLOCK_READ_FAILED, info.configPage, status);
+        return false;
+    }
+
+    byte count = min(blocksCount, (int)info.dataBlocks);
+    int needed = (dataLength + 15) / 16;
+    if (needed > count || needed >= info.dataBlocks)
+    {
+        events.publish(EV_BLOCK_WRITE_FAILED, ultralightPage(info.dataBlocks - 1), MFRC522::STATUS_NO_ROOM);
+        return false;
+    }
+
+    if (locked)
+    {
+        status = ultralightUnlock(&rfid);
+        if (status != MFRC522::STATUS_OK)
+        {
+            events.publish(EV_AUTH_FAILED, UL_FIRST_DATA_PAGE, status);
+            return false;
+        }
+    }
+
+    for (byte i = 0; i < count; i++)
+    {
+        byte expected[16];
+        fillBlock(data, dataLength, i, expected);
+
+        if (INCREMENTAL_WRITE)
+        {
+            byte current[18];
+            if (!readUltralightBlock(i, current))
+                return false;
+            if (memcmp(current, expected, 16) == 0)
+            {
+                skipped++;
+                continue;
+            }
+        }
+
+        status = ultralightWriteBlock(&rfid, i, expected, &page);
+        if (status != MFRC522::STATUS_OK)
+        {
+            events.publish(EV_BLOCK_WRITE_FAILED, page, status);
+            return false;
+        }
+        written++;
+    }
+
+    if (protect && !locked && info.configPage != UL_CONFIG_NONE)
+    {
+        status = ultralightProtect(&rfid, info, &page);
+        if (status != MFRC522::STATUS_OK)
+        {
+            events.publish(EV_BLOCK_WRITE_FAILED, page, status);
+            return false;
+        }
+        events.publish(EV_TAG_PROTECTED);
+    }
+
+    // Verify: the data must read back unchanged
+    for (byte i = 0; protect && written > 0 && i < count; i++)
+    {
+        byte expected[16];
+        byte current[18];
+        fillBlock(data, dataLength, i, expected);
+        if (!readUltralightBlock(i, current))
+            return false;
+        if (memcmp(current, expected, 16) != 0)
+        {
+            events.publish(EV_VERIFY_FAILED, ultralightPage(i));
+            return false;
+        }
+    }
+
+    events.publish(EV_CARD_WRITTEN, written);
+    if (skipped > 0)
+        events.publish(EV_BLOCKS_UNCHANGED, skipped);
+    return true;
+}
+
+// ============================================================================
+// DEFERRED FEEDBACK (EVENT CONSUMERS)
+// ============================================================================
+
+/**
+ * @brief Render one event on serial, LCD and buzzer
+ * @param ev Event popped from the queue
+ */
+void dispatchEvent(const Event &ev)
+{
+    switch (ev.type)
+    {
+    case EV_UID_DETECTED:
+        uid = uidToString(rfid.uid);
+        Serial.print(F("Card detected UID: "));
+        Serial.println(uid);
+        Serial.println();
+        break;
+
+    case EV_UID_READ_FAILED:
+        Serial.println(F("Failed to read card serial."));
+        lcd_uid_reading_error(&lcd);
+        beep(3); // Triple beep indicates read error
+        break;
+
+    case EV_UID_MISMATCH:
+        Serial.println(F("Job refused: unexpected card UID"));
+        lcd_job_wrong_card(&lcd);
+        beep(3);
+        break;
+
+    case EV_INCOMPATIBLE_CARD:
+        Serial.println(F("This device only works with MIFARE Classic cards."));
+        lcd_compatibility_error(&lcd);
+        beep(3); // Triple beep indicates compatibility error
+        break;
+
+    case EV_UID_DENIED:
+        Serial.println(F("Access denied: UID denylisted"));
+        lcd_uid_denied(&lcd);
+        beep(3);
+        break;
+
+    case EV_UID_NOT_ALLOWED:
+        Serial.println(F("Access denied: UID not allowlisted"));
+        lcd_uid_not_allowed(&lcd);
+        beep(3);
+        break;
+
+    case EV_AUTH_FAILED:
+        Serial.print(F("CRITICAL ERROR: Authentication failed for block "));
+        Serial.print(ev.arg);
+        Serial.print(F(": "));
+        Serial.println(rfid.GetStatusCodeName((MFRC522::StatusCode)ev.status));
+        lcd_authentication_error(&lcd);
+        beep(3);
+        break;
+
+    case EV_BLOCK_READ_FAILED:
+        Serial.print(F("CRITICAL ERROR: Reading failed on block "));
+        Serial.print(ev.arg);
+        Serial.print(F(": "));
+        Serial.println(rfid.GetStatusCodeName((MFRC522::StatusCode)ev.status));
+        lcd_read_block_error(&lcd, ev.arg);
+        beep(3);
+        break;
+
+    case EV_BLOCK_WRITE_FAILED:
+        Serial.print(F("CRITICAL ERROR: Writing failed on block "));
+        Serial.print(ev.arg);
+        Serial.print(F(": "));
+        Serial.println(rfid.GetStatusCodeName((MFRC522::StatusCode)ev.status));
+        lcd_write_block_error(&lcd);
+        beep(3); // Triple beep indicates write error
+        break;
+
+    case EV_CARD_READ:
+        Serial.print(F("Read "));
+        Serial.print(ev.arg);
+        Serial.println(F(" data blocks"));
+        break;
+
+    case EV_CARD_BLANK:
+        Serial.println(F("Card is blank: no credential found"));
+        beep(3); // Triple beep indicates read error
+        lcd_blank_card(&lcd);
+        break;
+
+    case EV_CARD_WRITTEN:
+        Serial.print(F("Write operation completed successfully: "));
+        Serial.print(ev.arg);
+        Serial.println(F(" blocks written"));
+        beep(1, 1000); // Long beep indicates write operation finished
+        lcd_writing_success(&lcd);
+        break;
+
+    case EV_BLOCKS_UNCHANGED:
+        Serial.print(F("Blocks already up to date (skipped): "));
+        Serial.println(ev.arg);
+        break;
+
+    case EV_CARD_UPGRADED:
+        Serial.print(F("Card re-issued from secret version "));
+        Serial.print(ev.arg);
+        Serial.print(F(" to "));
+        Serial.println(secretRingVersion());
+        break;
+
+    case EV_SECTOR_REKEYED:
+        Serial.print(F("Re-keyed and verified sectors: "));
+        Serial.println(ev.arg);
+        break;
+
+    case EV_TAG_PROTECTED:
+        Serial.println(F("Tag write protected with the NTAG password"));
+        break;
+
+    case EV_VERIFY_FAILED:
+        Serial.print(F("CRITICAL ERROR: Verify failed on block "));
+        Serial.println(ev.arg);
+        lcd_write_block_error(&lcd);
+        beep(3);
+        break;
+
+    case EV_PROVISION_RESUMED:
+        Serial.print(F("Resuming interrupted provisioning from sector index "));
+        Serial.println(ev.arg);
+        break;
+
+    case EV_ACCESS_GRANTED:
+        Serial.println(ev.arg ? F("Access granted (cached)") : F("Access granted"));
+        beep(1, 600); // Success confirmation beep
+        lcd_reading_success(&lcd);
+        break;
+
+    case EV_ACCESS_DENIED:
+        Serial.println(F("Access denied: invalid passphrase"));
+        beep(3); // Triple beep indicates invalid card
+        lcd_invalid_passphrase(&lcd);
+        break;
+
+    case EV_USES_LEFT:
+        Serial.print(F("Entries left on the badge: "));
+        Serial.println(ev.arg);
+        break;
+
+    case EV_USES_EXHAUSTED:
+        Serial.println(F("Access denied: no entries left on the badge"));
+        beep(3);
+        lcd_uses_exhausted(&lcd);
+        break;
+
+    case EV_USES_LOADED:
+        Serial.print(F("Entries loaded on the badge: "));
+        Serial.println(ev.arg);
+        break;
+
+    case EV_CLONE_STEP:
+        Serial.print(ev.status == CLONE_TARGET ? F("Clone: present the target card, chunk ")
+                                               : F("Clone: present the source card, chunk "));
+        Serial.println(ev.arg);
+        lcd_clone_step(&lcd, ev.status == CLONE_TARGET, ev.arg);
+        beep(1);
+        break;
+
+    case EV_CLONE_WRONG_CARD:
+        Serial.println(ev.status == CLONE_TARGET ? F("Clone: wrong card, present the target card")
+                                                 : F("Clone: wrong card, present the source card"));
+        lcd_clone_wrong_card(&lcd);
+        beep(3);
+        break;
+
+    case EV_CLONE_DONE:
+        Serial.print(F("Clone completed, chunks copied: "));
+        Serial.print(ev.arg);
+        Serial.print(F(", unreadable: "));
+        Serial.println(ev.status);
+        lcd_clone_done(&lcd, ev.status);
+        beep(1, 1000);
+        break;
+
+    case EV_PASSPHRASE_SET:
+        beep(1, 1000); // Long success beep
+        lcd_passphrase_set_success(&lcd);
+        break;
+
+    case EV_EEPROM_WRITE_FAILED:
+        beep(3); // Triple beep indicates error
+        lcd_EEPROM_writing_error(&lcd);
+        break;
+    }
+}
+
+/**
+ * @brief Update the lifetime counters (counters.h) for an event
+ * @param ev Event popped from the queue
+ */
+void countEvent(const Event &ev)
+{
+    switch (ev.type)
+    {
+    case EV_UID_DETECTED:
+        counterIncrement(CNT_TAPS);
+        break;
+    case EV_ACCESS_GRANTED:
+        counterIncrement(CNT_GRANTS);
+        break;
+    case EV_ACCESS_DENIED:
+    case EV_CARD_BLANK:
+    case EV_UID_DENIED:
+    case EV_UID_NOT_ALLOWED:
+    case EV_USES_EXHAUSTED:
+        counterIncrement(CNT_REJECTS);
+        break;
+    case EV_AUTH_FAILED:
+        counterIncrement(CNT_AUTH_FAILURES);
+        break;
+    case EV_BLOCK_READ_FAILED:
+        counterIncrement(CNT_READ_ERRORS);
+        break;
+    case EV_CARD_WRITTEN:
+        counterIncrement(CNT_WRITE_SUCCESSES);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Record the outcome of the transaction and append its audit record
+ * @details Only terminal events produce a record, so one tap costs one record.
+ *          Failed anticollision is not logged: there is no UID to record.
+ *          The outcome is also kept in `outcome` for the host job result.
+ * @param ev Event popped from the queue
+ */
+void recordOutcome(const Event &ev)
+{
+    AuditResult result;
+    byte block = AUDIT_NO_BLOCK;
+
+    switch (ev.type)
+    {
+    case EV_ACCESS_GRANTED:
+        result = AUDIT_GRANTED;
+        break;
+    case EV_ACCESS_DENIED:
+    case EV_CARD_BLANK:
+        result = AUDIT_DENIED;
+        break;
+    case EV_UID_DENIED:
+    case EV_UID_NOT_ALLOWED:
+        result = AUDIT_UID_DENIED;
+        break;
+    case EV_USES_EXHAUSTED:
+        result = AUDIT_USES_EXHAUSTED;
+        break;
+    case EV_UID_MISMATCH:
+        result = AUDIT_UID_MISMATCH;
+        break;
+    case EV_INCOMPATIBLE_CARD:
+        result = AUDIT_INCOMPATIBLE;
+        break;
+    case EV_AUTH_FAILED:
+        result = AUDIT_AUTH_FAILED;
+        block = ev.arg;
+        break;
+    case EV_BLOCK_READ_FAILED:
+        result = AUDIT_READ_FAILED;
+        block = ev.arg;
+        break;
+    case EV_BLOCK_WRITE_FAILED:
+    case EV_VERIFY_FAILED:
+        result = AUDIT_WRITE_FAILED;
+        block = ev.arg;
+        break;
+    case EV_CARD_WRITTEN:
+        result = AUDIT_WRITTEN;
+        outcome.written = ev.arg;
+        break;
+    case EV_BLOCKS_UNCHANGED:
+        outcome.skipped = ev.arg;
+        return;
+    case EV_PASSPHRASE_SET:
+        result = AUDIT_SET;
+        break;
+    case EV_EEPROM_WRITE_FAILED:
+        result = AUDIT_SET_FAILED;
+        break;
+    default:
+        return; // Progress event, not a transaction outcome
+    }
+
+    outcome.result = result;
+    outcome.block = block;
+    auditLogAppend(result, rfid.uid, block, cardDurationMs);
+}
+
+/**
+ * @brief Drain the event queue into the feedback consumers
+ * @details Must only be called outside the RF critical section (card halted or absent).
+ */
+void drainEvents()
+{
+    Event ev;
+    while (events.pop(&ev))
+    {
+        countEvent(ev);
+        recordOutcome(ev);
+        dispatchEvent(ev);
+    }
+
+    if (events.droppedCount())
+    {
+        Serial.print(F("Warning: dropped events: "));
+        Serial.println(events.droppedCount());
+    }
+    events.clear();
 }
 
 // ============================================================================
 // SYSTEM OUTPUT CONTROL
 // ============================================================================
 
+/**
+ * @brief Hold the error state until the current card operation is acknowledged
+ * @details Writer builds block until the operator presses the RESET button.
+ *          Reader builds have no RESET button: the error indicator is held for
+ *          ERROR_HOLD_MS and the device goes back to waiting for cards by itself.
+ */
+void waitForAcknowledge()
+{
+    if (BoxRole::HAS_RESET_BUTTON)
+    {
+        triggerErrorAndWaitForReset(&btnReset, &fired);
+        return;
+    }
+
+    digitalWrite(ERROR_PIN, HIGH);
+    delay(ERROR_HOLD_MS);
+    digitalWrite(ERROR_PIN, LOW);
+    fired = false;
+}
+
 /**
  * @brief Execute access control action based on validation result
  * @details Controls the physical outputs of the system (relay, lock mechanism, etc.)
@@ -0,0 +1,158 @@
+/**
+ * @file secret-ring.cpp
+ * @brief Implementation of the versioned secret ring
+ * @author Dag
+ */
+
+#include "secret-ring.h"
+#include "credential.h"
+#include "def.h"
+
+static const int SLOT_SIZE = 2 + MAC_KEY_SIZE;
+static const int SLOTS_ADDR = EEPROM_SECRET_RING_ADDR + 2;
+
+static byte currentVersion = 1; // RAM copy of the EEPROM header
+
+/** @brief Read a version / ~version pair, SECRET_VERSION_NONE if invalid */
+static byte readVersion(int address)
+{
+    byte version = EEPROM.read(address);
+    if ((byte)~EEPROM.read(address + 1) != version || version == SECRET_VERSION_NONE || version > SECRET_VERSION_MAX)
+        return SECRET_VERSION_NONE;
+    return version;
+}
+
+static void writeVersion(int address, byte version)
+{
+    EEPROM.update(address, version);
+    EEPROM.update(address + 1, ~version);
+}
+
+static int slotAddress(byte version)
+{
+    return SLOTS_ADDR + (version % SECRET_RING_SLOTS) * SLOT_SIZE;
+}
+
+static byte nextVersion(byte version)
+{
+    return version == SECRET_VERSION_MAX ? 1 : version + 1;
+}
+
+void secretRingInit()
+{
+    currentVersion = readVersion(EEPROM_SECRET_RING_ADDR);
+    if (currentVersion != SECRET_VERSION_NONE)
+        return;
+
+    // Header torn by a power loss in secretRingRotate(): the slots still hold the
+    // retired versions, the current one follows the newest
+    byte versions[SECRET_RING_SLOTS];
+    for (byte slot = 0; slot < SECRET_RING_SLOTS; slot++)
+        versions[slot] = readVersion(SLOTS_ADDR + slot * SLOT_SIZE);
+    for (byte slot = 0; slot < SECRET_RING_SLOTS; slot++)
+    {
+        if (versions[slot] == SECRET_VERSION_NONE)
+            continue;
+        byte next = nextVersion(versions[slot]);
+        bool newest = true;
+        for (byte other = 0; other < SECRET_RING_SLOTS; other++)
+            newest = newest && versions[other] != next;
+        if (newest)
+        {
+            currentVersion = next;
+            writeVersion(EEPROM_SECRET_RING_ADDR, currentVersion);
+            return;
+        }
+    }
+
+    // First boot: version 1, every slot empty
+    currentVersion = 1;
+    for (byte slot = 0; slot < SECRET_RING_SLOTS; slot++)
+        writeVersion(SLOTS_ADDR + slot * SLOT_SIZE, 0xFF); // ~0xFF != 0xFF: invalid
+    writeVersion(EEPROM_SECRET_RING_ADDR, currentVersion);
+}
+
+byte secretRingVersion()
+{
+    return currentVersion;
+}
+
+void secretRingRotate(const byte *retiredKey)
+{
+    int address = slotAddress(currentVersion);
+
+    writeVersion(address, 0xFF); // Slot invalid while its key is rewritten
+    for (byte i = 0; i < MAC_KEY_SIZE; i++)
+        EEPROM.update(address + 2 + i, retiredKey[i]);
+    writeVersion(address, currentVersion);
+
+    currentVersion = nextVersion(currentVersion);
+    writeVersion(EEPROM_SECRET_RING_ADDR, currentVersion);
+}
+
+bool secretRingKey(byte version, byte *key)
+{
+    if (version == SECRET_VERSION_NONE || version == currentVersion)
+        return false;
+
+    int address = slotAddress(version);
+    if (readVersion(address) != version)
+        return false; // Retired too long ago: the slot was reused
+
+    for (byte i = 0; i < MAC_KEY_SIZE; i++)
+        key[i] = EEPROM.read(address + 2 + i);
+    return true;
+}
+
+bool secretRingLastRetired(byte *key)
+{
+    return secretRingKey(currentVersion == 1 ? SECRET_VERSION_MAX : currentVersion - 1, key);
+}
+
+byte secretRingSlotVersion(byte slot)
+{
+    byte version = readVersion(SLOTS_ADDR + slot * SLOT_SIZE);
+    return version == currentVersion ? SECRET_VERSION_NONE : version;
+}
+
+void printSecretRing()
+{
+    Serial.print(F("Secret version: "));
+    Serial.print(currentVersion);
+    Serial.print(F(", retired accepted:"));
+    for (byte slot = 0; slot < SECRET_RING_SLOTS; slot++)
+    {
+        byte version = secretRingSlotVersion(slot);
+        if (version != SECRET_VERSION_NONE)
+        {
+            Serial.print(' ');
+            Serial.print(version);
+        }
+    }
+    Serial.println();
+}
+
+void appendVersionTag(String *data, byte version)
+{
+    *data += (char)SECRET_TAG_MARKER;
+    *data += (char)(SECRET_TAG_VERSION_BIT | version);
+}
+
+byte takeVersionTag(String *data)
+{
+    unsigned int length = data->length();
+
+    // Upgrade torn between the two tag bytes: marker only
+    if (length >= 1 && (*data)[length - 1] == (char)SECRET_TAG_MARKER)
+    {
+        data->remove(length - 1);
+        return SECRET_VERSION_NONE;
+    }
+
+    if (length < 2 || (*data)[length - 2] != (char)SECRET_TAG_MARKER || !((*data)[length - 1] & SECRET_TAG_VERSION_BIT))
+        return SECRET_VERSION_NONE;
+
+    byte version = (*data)[length - 1] & ~SECRET_TAG_VERSION_BIT;
+    data->remove(length - 2);
+    return version;
+}
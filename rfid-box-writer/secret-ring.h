@@ -0,0 +1,105 @@
+/**
+ * @file secret-ring.h
+ * @brief Versioned ring of the previous credential secrets
+ * @details Rotating the passphrase used to split the fleet in two until every door
+ *          and every card was updated. Now every secret has a version (1..126): the
+ *          current one is the master passphrase / UID-MAC key as before, the last
+ *          SECRET_RING_SLOTS retired ones are kept here as their 16-byte derived key
+ *          (deriveMacKey(), credential.h), never in clear.
+ *
+ *          Cards carry the version they were written with, so the reader compares
+ *          against exactly one secret: version v lives in slot v % SECRET_RING_SLOTS.
+ *          Unversioned (older) cards are checked against the current secret and then
+ *          against each slot.
+ *
+ * EEPROM layout (EEPROM_SECRET_RING_SIZE = 56 bytes):
+ * -----------------------------------------------------------------
+ * Byte 0      Current version
+ * Byte 1      ~Current version (torn by a rotation: the version after the newest
+ *             slot; erased: version 1, empty ring)
+ * Byte 2-55   3 slots: version (1) | ~version (1) | derived key (16)
+ * -----------------------------------------------------------------
+ *
+ * Card version tag:
+ * -----------------------------------------------------------------
+ * CREDENTIAL_PASSPHRASE  passphrase | 0x01 | 0x80 + version  (appended: re-tagging a
+ *                        card with the same passphrase rewrites a single block)
+ * CREDENTIAL_UID_MAC     byte UID_MAC_SECRET_VERSION of the credential block
+ * CREDENTIAL_RECORDS     byte 3 of the records header (records.h)
+ * -----------------------------------------------------------------
+ * @author Dag
+ */
+
+#ifndef RFID_SECRET_RING_H
+#define RFID_SECRET_RING_H
+
+#include "Arduino.h"
+
+const byte SECRET_RING_SLOTS = 3;    // Retired secrets still accepted
+const byte SECRET_VERSION_NONE = 0;  // Card without version tag
+const byte SECRET_VERSION_MAX = 126; // Versions wrap to 1 after this
+const byte SECRET_TAG_MARKER = 0x01; // Not a printable passphrase character
+const byte SECRET_TAG_VERSION_BIT = 0x80; // Set in the byte after the marker
+
+// Across the wrap SECRET_VERSION_MAX and 1 are consecutive: they must not share a slot
+static_assert(SECRET_VERSION_MAX % SECRET_RING_SLOTS == 0, "SECRET_VERSION_MAX must be a multiple of SECRET_RING_SLOTS");
+
+/**
+ * @brief Result of a card credential check
+ */
+enum SecretMatch : byte
+{
+    SECRET_INVALID,  // No accepted secret matches
+    SECRET_CURRENT,  // Current secret and version
+    SECRET_OUTDATED  // Retired secret, or current secret without version tag
+};
+
+/** @brief Load the current version, format the ring on first boot, repair a torn header */
+void secretRingInit();
+
+/** @brief Version of the current secret */
+byte secretRingVersion();
+
+/**
+ * @brief Retire the current secret and move to the next version
+ * @details Call before the new secret is stored: if power fails in between, the old
+ *          secret is simply known under two versions.
+ * @param retiredKey Derived key of the secret being replaced (MAC_KEY_SIZE bytes)
+ */
+void secretRingRotate(const byte *retiredKey);
+
+/**
+ * @brief Derived key of a retired version
+ * @param version Card version
+ * @param key Destination (MAC_KEY_SIZE bytes)
+ * @return false if the version is not (or no longer) in the ring
+ */
+bool secretRingKey(byte version, byte *key);
+
+/**
+ * @brief Derived key of the secret retired by the last rotation
+ * @details A SET that lost power after secretRingRotate() but before the new secret
+ *          was stored leaves the box without a current key: this is the one to keep.
+ * @param key Destination (MAC_KEY_SIZE bytes)
+ * @return false if no secret was retired yet
+ */
+bool secretRingLastRetired(byte *key);
+
+/** @brief Version stored in a slot, SECRET_VERSION_NONE if empty */
+byte secretRingSlotVersion(byte slot);
+
+/** @brief Print the current version and the retired ones */
+void printSecretRing();
+
+/**
+ * @brief Append the version tag to a passphrase before it is written to a card
+ */
+void appendVersionTag(String *data, byte version);
+
+/**
+ * @brief Remove the version tag from a passphrase read from a card
+ * @return Card version, SECRET_VERSION_NONE if the card has no tag
+ */
+byte takeVersionTag(String *data);
+
+#endif // RFID_SECRET_RING_H
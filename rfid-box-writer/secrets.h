@@ -0,0 +1,55 @@
+/**
+ * @file secrets.h
+ * @brief Build secrets, GENERATED by secrets-generator-util: do not edit by hand
+ * @details Every value lives in flash (PROGMEM) and is read with pgm_read_byte() /
+ *          memcpy_P(): nothing is copied to SRAM or allocated at boot.
+ *          Key generation 1: KEYRING lists crypto_key first, then the keys
+ *          of the previous generations still accepted, then the factory key.
+ */
+
+#ifndef RFID_SECRETS_H
+#define RFID_SECRETS_H
+
+#include <MFRC522.h>
+
+// Build identifier, printed with the firmware version
+const char BUILD_ID[] PROGMEM = "v1.0.0-demo";
+
+/**
+ * @brief Factory secret of the build
+ * @details Used only by a box whose EEPROM holds no secret yet (never SET): writers
+ *          install the passphrase, readers only its digest (deriveMacKey()).
+ *          The first SET replaces it and retires it like any other secret.
+ */
+const char FACTORY_PASSPHRASE[] PROGMEM = "";
+// Empty: no passphrase in this build, a writer must be SET before writing cards
+const byte FACTORY_DIGEST[16] PROGMEM = {0x0B, 0x29, 0x10, 0xA0, 0x56, 0x17, 0x54, 0x6C, 0xE2, 0x82, 0xBA, 0x5E, 0x4F, 0xA7, 0x59, 0x43}; // MAC_KEY_SIZE (credential.h)
+
+/**
+ * @brief MIFARE Classic Key A written on the sectors of provisioned cards
+ */
+const byte crypto_key[MFRC522::MF_KEY_SIZE] PROGMEM = {0x01, 0x02, 0x13, 0x51, 0x09, 0x0F};
+
+/**
+ * @brief Candidate Key A values for authentication (keyring.h), in probe order
+ */
+const byte KEYRING[][MFRC522::MF_KEY_SIZE] PROGMEM = {
+    {0x01, 0x02, 0x13, 0x51, 0x09, 0x0F},
+    {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+};
+const byte KEYRING_SIZE = sizeof(KEYRING) / sizeof(KEYRING[0]);
+
+/**
+ * @brief Key B of the entry counter sector (usage-counter.h)
+ * @details Loads entries on limited-use badges. Only writers use it: readers hold
+ *          Key A, which can only take entries.
+ */
+const byte usage_key[MFRC522::MF_KEY_SIZE] PROGMEM = {0x55, 0x53, 0x45, 0x53, 0x4B, 0x42};
+
+/**
+ * @brief NTAG / Ultralight EV1 write password and PACK (ultralight.h)
+ */
+const byte ntag_password[4] PROGMEM = {0x52, 0x46, 0x49, 0x44};
+const byte ntag_pack[2] PROGMEM = {0x42, 0x58};
+
+#endif // RFID_SECRETS_H
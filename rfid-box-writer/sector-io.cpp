@@ -0,0 +1,170 @@
+/**
+ * @file sector-io.cpp
+ * @brief Implementation of the sector-at-a-time card access
+ * @author Dag
+ */
+
+#include "sector-io.h"
+#include "keyring.h"
+#include "frame.h"
+
+static const byte BIG_SECTOR_BLOCK = 128; // First block of the 16-block sectors (4K)
+
+byte chunkCount(MFRC522::PICC_Type type)
+{
+    switch (type)
+    {
+    case MFRC522::PICC_TYPE_MIFARE_MINI:
+        return 5;
+    case MFRC522::PICC_TYPE_MIFARE_1K:
+        return 16;
+    case MFRC522::PICC_TYPE_MIFARE_4K:
+        return 64; // 32 sectors x 4 blocks + 8 sectors x 16 blocks
+    default:
+        return 0;
+    }
+}
+
+byte chunkTrailer(byte chunk)
+{
+    byte first = chunk * CHUNK_BLOCKS;
+    if (first < BIG_SECTOR_BLOCK)
+        return first + 3;
+    return first - (first - BIG_SECTOR_BLOCK) % 16 + 15;
+}
+
+bool chunkHasTrailer(byte chunk)
+{
+    return chunkTrailer(chunk) == chunk * CHUNK_BLOCKS + CHUNK_BLOCKS - 1;
+}
+
+bool accessBitsValid(const byte *bits)
+{
+    byte c1 = bits[1] >> 4;
+    byte c2 = bits[2] & 0x0F;
+    byte c3 = bits[2] >> 4;
+
+    return (bits[0] & 0x0F) == (~c1 & 0x0F) &&
+           (bits[0] >> 4) == (~c2 & 0x0F) &&
+           (bits[1] & 0x0F) == (~c3 & 0x0F);
+}
+
+bool readChunk(TracedMFRC522 *rfid, SectorChunk *chunk)
+{
+    MFRC522::StatusCode status;
+    byte buffer[18]; // 16 data bytes + 2 CRC bytes
+    byte first = chunk->index * CHUNK_BLOCKS;
+
+    memset(chunk->data, 0, CHUNK_SIZE);
+    chunk->keyIndex = NO_KEY_INDEX;
+
+    if (!keyringAuthenticate(rfid, chunkTrailer(chunk->index), &status))
+    {
+        chunk->status = status;
+        return reselectCard(rfid) == MFRC522::STATUS_OK; // No key: skip the sector if the card is still there
+    }
+    chunk->keyIndex = keyringLastIndex();
+
+    for (byte i = 0; i < CHUNK_BLOCKS; i++)
+    {
+        byte len = sizeof(buffer);
+        status = rfid->MIFARE_Read(first + i, buffer, &len);
+        if (status != MFRC522::STATUS_OK)
+        {
+            chunk->status = status;
+            memset(chunk->data, 0, CHUNK_SIZE);
+            return reselectCard(rfid) == MFRC522::STATUS_OK;
+        }
+        memcpy(chunk->data + i * 16, buffer, 16);
+    }
+
+    chunk->status = MFRC522::STATUS_OK;
+    return true;
+}
+
+MFRC522::StatusCode writeChunk(TracedMFRC522 *rfid, const SectorChunk *chunk, const byte *defaultAccessBits, byte *failedBlock)
+{
+    MFRC522::StatusCode status;
+    byte buffer[16];
+    byte first = chunk->index * CHUNK_BLOCKS;
+
+    *failedBlock = chunkTrailer(chunk->index);
+    if (!keyringAuthenticate(rfid, *failedBlock, &status))
+        return status;
+
+    for (byte i = 0; i < CHUNK_BLOCKS; i++)
+    {
+        byte block = first + i;
+        memcpy(buffer, chunk->data + i * 16, 16);
+
+        if (block == 0)
+            continue; // Manufacturer block: read-only on genuine cards
+
+        if (block == chunkTrailer(chunk->index))
+        {
+            keyringKey(chunk->keyIndex, buffer); // Key A reads back as zeros
+            if (!accessBitsValid(buffer + 6))
+                memcpy(buffer + 6, defaultAccessBits, 4);
+        }
+
+        status = rfid->MIFARE_Write(block, buffer, 16);
+        if (status != MFRC522::STATUS_OK)
+        {
+            *failedBlock = block;
+            return status;
+        }
+    }
+
+    return MFRC522::STATUS_OK;
+}
+
+byte dumpCard(TracedMFRC522 *rfid, Print *out)
+{
+    SectorChunk chunk;
+    byte chunks = chunkCount(rfid->PICC_GetType(rfid->uid.sak));
+    byte unreadable = 0;
+
+    sendCardInfo(out, rfid->uid, chunks);
+    for (chunk.index = 0; chunk.index < chunks; chunk.index++)
+    {
+        bool present = readChunk(rfid, &chunk);
+        if (chunk.status != MFRC522::STATUS_OK)
+            unreadable++;
+        sendChunk(out, &chunk);
+        if (!present)
+            return 0xFF; // No FRAME_CARD_END: the host sees a truncated dump
+    }
+    sendCardEnd(out, chunks, unreadable);
+    return unreadable;
+}
+
+void sendCardInfo(Print *out, const MFRC522::Uid &uid, byte chunks)
+{
+    FrameWriter frame(out);
+    frame.begin(FRAME_CARD_INFO, uid.size + 3);
+    frame.write(uid.size);
+    frame.write(uid.uidByte, uid.size);
+    frame.write(uid.sak);
+    frame.write(chunks);
+    frame.end();
+}
+
+void sendChunk(Print *out, const SectorChunk *chunk)
+{
+    FrameWriter frame(out);
+    frame.begin(FRAME_SECTOR, CHUNK_SIZE + 3);
+    frame.write(chunk->index);
+    frame.write(chunk->status);
+    frame.write(chunk->keyIndex);
+    frame.write(chunk->data, CHUNK_SIZE);
+    frame.end();
+}
+
+void sendCardEnd(Print *out, byte sent, byte unreadable)
+{
+    FrameWriter frame(out);
+    frame.begin(FRAME_CARD_END, 2);
+    frame.write(sent);
+    frame.write(unreadable);
+    frame.end();
+}
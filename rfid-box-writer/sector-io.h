@@ -0,0 +1,113 @@
+/**
+ * @file sector-io.h
+ * @brief Sector-at-a-time MIFARE Classic card access
+ * @details Whole-card operations (clone, backup, dump) never hold a card image in
+ *          SRAM: the card is processed in chunks of 4 blocks (64 bytes). On Mini and
+ *          1K cards a chunk is exactly one sector; the 16-block sectors of a 4K card
+ *          (32-39) are split in 4 chunks, so memory use stays at 64 bytes for any card.
+ *
+ *          Chunk c covers blocks 4c .. 4c+3. Every chunk is authenticated on the
+ *          trailer of its sector through the keyring (keyring.h).
+ *
+ * Frames sent to the host (frame.h):
+ * -----------------------------------------------------------------
+ * FRAME_CARD_INFO    UID size (1) | UID (size) | SAK (1) | chunk count (1)
+ * FRAME_SECTOR       chunk (1) | status (1) | key index (1) | data (64)
+ * FRAME_CARD_END     chunks sent (1) | chunks unreadable (1)
+ * -----------------------------------------------------------------
+ * status is the MFRC522::StatusCode of the authentication or read (0 = OK);
+ * key index is the KEYRING entry that opened the sector, 0xFF if none.
+ * Data of unreadable chunks is sent as zeros.
+ * @author Dag
+ */
+
+#ifndef RFID_SECTOR_IO_H
+#define RFID_SECTOR_IO_H
+
+#include "Arduino.h"
+#include <MFRC522.h>
+#include "rf-trace.h"
+
+const byte CHUNK_BLOCKS = 4;                // Blocks per chunk
+const byte CHUNK_SIZE = CHUNK_BLOCKS * 16;  // Bytes per chunk
+const byte NO_KEY_INDEX = 0xFF;
+
+/**
+ * @brief One chunk of card memory (67 bytes)
+ */
+struct SectorChunk
+{
+    byte index;            // Chunk number
+    byte status;           // MFRC522::StatusCode of the read, STATUS_OK if data is valid
+    byte keyIndex;         // KEYRING entry that authenticated the sector, NO_KEY_INDEX if none
+    byte data[CHUNK_SIZE]; // Block contents
+};
+
+/**
+ * @brief Number of chunks of a card
+ * @param type Card type (Mini: 5, 1K: 16, 4K: 64)
+ * @return Chunk count, 0 for non MIFARE Classic cards
+ */
+byte chunkCount(MFRC522::PICC_Type type);
+
+/**
+ * @brief Trailer block of the sector containing a chunk
+ */
+byte chunkTrailer(byte chunk);
+
+/**
+ * @brief The chunk contains the sector trailer (last chunk of its sector)
+ */
+bool chunkHasTrailer(byte chunk);
+
+/**
+ * @brief Authenticate and read one chunk
+ * @details On failure the card is selected again, so the next chunk can be tried.
+ * @param rfid Reader, with the card selected
+ * @param chunk Destination; chunk->index selects the chunk to read
+ * @return false if the card left the field (the chunk is not usable and the card
+ *         does not answer anymore), true otherwise: check chunk->status
+ */
+bool readChunk(TracedMFRC522 *rfid, SectorChunk *chunk);
+
+/**
+ * @brief Authenticate and write one chunk to a card
+ * @details Block 0 (manufacturer data) is never written. The trailer is written last:
+ *          Key A, which always reads back as zeros, is replaced by the key that opened
+ *          the source sector; access bits that fail the integrity check are replaced
+ *          by accessBits (data.h), so a damaged source cannot lock the target sector.
+ * @param rfid Reader, with the target card selected
+ * @param chunk Chunk read from the source card
+ * @param defaultAccessBits Access bits used when the source ones are invalid
+ * @param failedBlock Set to the failing block on error
+ * @return MFRC522::STATUS_OK or the status code of the failing operation
+ */
+MFRC522::StatusCode writeChunk(TracedMFRC522 *rfid, const SectorChunk *chunk, const byte *defaultAccessBits, byte *failedBlock);
+
+/**
+ * @brief Check the redundancy of MIFARE Classic access bits
+ * @param bits Trailer bytes 6-8
+ * @return true if every condition bit matches its inverted copy
+ */
+bool accessBitsValid(const byte *bits);
+
+/**
+ * @brief Stream the whole card as frames: FRAME_CARD_INFO, one FRAME_SECTOR per chunk, FRAME_CARD_END
+ * @details One chunk at a time: each chunk is read at full RF speed into a 64-byte
+ *          buffer and sent before the next one is read.
+ * @param rfid Reader, with the card selected
+ * @param out Destination stream
+ * @return Number of unreadable chunks, 0xFF if the card left the field
+ */
+byte dumpCard(TracedMFRC522 *rfid, Print *out);
+
+/** @brief Send FRAME_CARD_INFO for the current card */
+void sendCardInfo(Print *out, const MFRC522::Uid &uid, byte chunks);
+
+/** @brief Send one FRAME_SECTOR */
+void sendChunk(Print *out, const SectorChunk *chunk);
+
+/** @brief Send FRAME_CARD_END */
+void sendCardEnd(Print *out, byte sent, byte unreadable);
+
+#endif // RFID_SECTOR_IO_H
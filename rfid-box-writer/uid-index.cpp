@@ -0,0 +1,282 @@
+/**
+ * @file uid-index.cpp
+ * @brief Implementation of the EEPROM UID allow/deny index
+ * @author Dag
+ */
+
+#include "uid-index.h"
+#include "def.h"
+
+// Header
+static const byte UID_INDEX_MAGIC[2] = {'U', 'X'};
+static const byte SECTIONS = 6;       // DENY 4/7/10, ALLOW 4/7/10
+static const int COUNTS_ADDR = EEPROM_UID_INDEX_ADDR + 2;
+static const int OP_ADDR = COUNTS_ADDR + SECTIONS;
+static const byte OP_SIZE = 5 + 10;   // Pending operation, longest UID
+static const byte HEADER_SIZE = 2 + SECTIONS + OP_SIZE;
+static const int TABLE_ADDR = EEPROM_UID_INDEX_ADDR + HEADER_SIZE;
+static const int TABLE_SIZE = EEPROM_UID_INDEX_SIZE - HEADER_SIZE;
+
+// Pending operation record (see uid-index.h)
+static const byte OP_NONE = 0xFF;
+static const byte OP_INSERT = 'I';
+static const byte OP_REMOVE = 'R';
+static const int OP_SECTION = OP_ADDR + 1;
+static const int OP_POSITION = OP_ADDR + 2;
+static const int OP_CHUNKS = OP_ADDR + 3;
+static const int OP_COUNT = OP_ADDR + 4;
+static const int OP_UID = OP_ADDR + 5;
+
+// UID size of each section
+static const byte SECTION_UID_SIZE[SECTIONS] = {4, 7, 10, 4, 7, 10};
+
+// ============================================================================
+// SECTION HELPERS
+// ============================================================================
+
+/** @brief Section index for a list and UID size, or -1 if the size is invalid */
+static int8_t sectionOf(UidStatus status, byte size)
+{
+    byte base = status == UID_DENIED ? 0 : 3;
+    switch (size)
+    {
+    case 4:
+        return base;
+    case 7:
+        return base + 1;
+    case 10:
+        return base + 2;
+    default:
+        return -1;
+    }
+}
+
+static byte sectionCount(byte section)
+{
+    return EEPROM.read(COUNTS_ADDR + section);
+}
+
+/** @brief EEPROM address of the first entry of a section */
+static int sectionAddr(byte section)
+{
+    int addr = TABLE_ADDR;
+    for (byte s = 0; s < section; s++)
+        addr += sectionCount(s) * SECTION_UID_SIZE[s];
+    return addr;
+}
+
+/** @brief Bytes used by all sections */
+static int tableUsed()
+{
+    return sectionAddr(SECTIONS) - TABLE_ADDR;
+}
+
+/** @brief Compare the UID with the entry at addr (memcmp semantics) */
+static int compareEntry(int addr, const byte *uid, byte size)
+{
+    for (byte i = 0; i < size; i++)
+    {
+        byte stored = EEPROM.read(addr + i);
+        if (stored != uid[i])
+            return stored < uid[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Binary search (lower bound) in a section
+ * @param found Set to true if the UID is at the returned position
+ * @return Position of the UID, or where it should be inserted
+ */
+static byte lowerBound(byte section, const byte *uid, byte size, bool *found)
+{
+    int base = sectionAddr(section);
+    byte lo = 0;
+    byte hi = sectionCount(section);
+
+    while (lo < hi)
+    {
+        byte mid = (lo + hi) / 2;
+        if (compareEntry(base + mid * size, uid, size) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    *found = lo < sectionCount(section) && compareEntry(base + lo * size, uid, size) == 0;
+    return lo;
+}
+
+/**
+ * @brief Run or resume the pending operation
+ * @details The entries after the insertion or removal point are moved by one UID,
+ *          in chunks of the UID size, top down to insert and bottom up to remove.
+ *          OP_CHUNKS is committed after each chunk: a chunk cut half way is copied
+ *          again from sources it cannot have overwritten yet. The section count is
+ *          committed last, then the record is cleared. The counts do not change
+ *          until then, so the shifted range is recomputed from them on resume.
+ */
+static void runOperation()
+{
+    byte op = EEPROM.read(OP_ADDR);
+    byte section = EEPROM.read(OP_SECTION);
+    byte pos = EEPROM.read(OP_POSITION);
+    byte count = EEPROM.read(OP_COUNT);
+
+    // A count that already changed means only the record was left to clear
+    if (section < SECTIONS && sectionCount(section) == count && pos < count + (op == OP_INSERT))
+    {
+        byte size = SECTION_UID_SIZE[section];
+        int addr = sectionAddr(section) + pos * size;
+        int from = op == OP_INSERT ? addr : addr + size;
+        int end = TABLE_ADDR + tableUsed();
+        byte chunks = (end - from + size - 1) / size;
+
+        for (byte chunk = EEPROM.read(OP_CHUNKS); chunk < chunks; chunk++)
+        {
+            if (op == OP_INSERT)
+                for (int a = end - 1 - chunk * size; a >= from && a >= end - (chunk + 1) * size; a--)
+                    EEPROM.update(a + size, EEPROM.read(a));
+            else
+                for (int a = from + chunk * size; a < end && a < from + (chunk + 1) * size; a++)
+                    EEPROM.update(a - size, EEPROM.read(a));
+            EEPROM.update(OP_CHUNKS, chunk + 1);
+        }
+
+        if (op == OP_INSERT)
+            for (byte i = 0; i < size; i++)
+                EEPROM.update(addr + i, EEPROM.read(OP_UID + i));
+        EEPROM.update(COUNTS_ADDR + section, op == OP_INSERT ? count + 1 : count - 1);
+    }
+
+    EEPROM.update(OP_ADDR, OP_NONE);
+}
+
+/** @brief Record an operation in the header, then run it */
+static void startOperation(byte op, byte section, byte pos, const byte *uid, byte size)
+{
+    EEPROM.update(OP_SECTION, section);
+    EEPROM.update(OP_POSITION, pos);
+    EEPROM.update(OP_CHUNKS, 0);
+    EEPROM.update(OP_COUNT, sectionCount(section));
+    for (byte i = 0; i < size; i++)
+        EEPROM.update(OP_UID + i, uid[i]);
+    EEPROM.update(OP_ADDR, op); // Commit
+    runOperation();
+}
+
+static bool removeFrom(byte section, const byte *uid, byte size)
+{
+    bool found;
+    byte pos = lowerBound(section, uid, size, &found);
+    if (!found)
+        return false;
+
+    startOperation(OP_REMOVE, section, pos, uid, size);
+    return true;
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+
+void uidIndexInit()
+{
+    if (EEPROM.read(EEPROM_UID_INDEX_ADDR) == UID_INDEX_MAGIC[0] &&
+        EEPROM.read(EEPROM_UID_INDEX_ADDR + 1) == UID_INDEX_MAGIC[1] &&
+        tableUsed() <= TABLE_SIZE)
+    {
+        // Operation cut by a power loss: complete it before the first lookup
+        byte op = EEPROM.read(OP_ADDR);
+        if (op == OP_INSERT || op == OP_REMOVE)
+            runOperation();
+        return;
+    }
+
+    EEPROM.update(EEPROM_UID_INDEX_ADDR, UID_INDEX_MAGIC[0]);
+    EEPROM.update(EEPROM_UID_INDEX_ADDR + 1, UID_INDEX_MAGIC[1]);
+    for (byte s = 0; s < SECTIONS; s++)
+        EEPROM.update(COUNTS_ADDR + s, 0);
+    EEPROM.update(OP_ADDR, OP_NONE);
+}
+
+UidStatus uidIndexLookup(const byte *uid, byte size)
+{
+    int8_t deny = sectionOf(UID_DENIED, size);
+    if (deny < 0)
+        return UID_UNKNOWN;
+
+    bool found;
+    lowerBound(deny, uid, size, &found);
+    if (found)
+        return UID_DENIED;
+
+    lowerBound(sectionOf(UID_ALLOWED, size), uid, size, &found);
+    return found ? UID_ALLOWED : UID_UNKNOWN;
+}
+
+bool uidIndexPut(const byte *uid, byte size, UidStatus status)
+{
+    int8_t section = sectionOf(status, size);
+    if (section < 0 || status == UID_UNKNOWN)
+        return false;
+
+    bool found;
+    byte pos = lowerBound(section, uid, size, &found);
+    if (!found)
+    {
+        if (tableUsed() + size > TABLE_SIZE || sectionCount(section) == 0xFF)
+            return false; // Table full
+        startOperation(OP_INSERT, section, pos, uid, size);
+    }
+
+    // A UID lives in one list only. It is removed from the other list after the
+    // insertion: a power loss in between leaves it in both, where deny wins.
+    removeFrom(sectionOf(status == UID_DENIED ? UID_ALLOWED : UID_DENIED, size), uid, size);
+    return true;
+}
+
+bool uidIndexRemove(const byte *uid, byte size)
+{
+    int8_t deny = sectionOf(UID_DENIED, size);
+    if (deny < 0)
+        return false;
+
+    bool removed = removeFrom(deny, uid, size);
+    removed |= removeFrom(sectionOf(UID_ALLOWED, size), uid, size);
+    return removed;
+}
+
+uint16_t uidIndexCount()
+{
+    uint16_t count = 0;
+    for (byte s = 0; s < SECTIONS; s++)
+        count += sectionCount(s);
+    return count;
+}
+
+void printUidIndex()
+{
+    for (byte s = 0; s < SECTIONS; s++)
+    {
+        int addr = sectionAddr(s);
+        byte size = SECTION_UID_SIZE[s];
+
+        for (byte n = 0; n < sectionCount(s); n++, addr += size)
+        {
+            Serial.print(s < 3 ? F("deny ") : F("allow"));
+            for (byte i = 0; i < size; i++)
+            {
+                byte b = EEPROM.read(addr + i);
+                Serial.print(b < 0x10 ? F(" 0") : F(" "));
+                Serial.print(b, HEX);
+            }
+            Serial.println();
+        }
+    }
+
+    Serial.print(uidIndexCount());
+    Serial.print(F(" UIDs, "));
+    Serial.print(TABLE_SIZE - tableUsed());
+    Serial.println(F(" bytes free"));
+}
@@ -0,0 +1,93 @@
+/**
+ * @file uid-index.h
+ * @brief EEPROM-backed UID allow/deny index with binary search lookup
+ * @details Replaces the linear `isValidUid()` scan over hard-coded UID strings of the
+ *          previous firmware with a compact binary table stored in EEPROM, editable
+ *          over serial. A single lost badge can be revoked without rotating the
+ *          passphrase of the whole fleet.
+ *
+ * Region layout (EEPROM_UID_INDEX_ADDR, EEPROM_UID_INDEX_SIZE bytes):
+ * -----------------------------------------------------------------
+ * Byte 0-1   Magic 'U' 'X'
+ * Byte 2-7   Entry count per section
+ * Byte 8     Pending operation ('I' insert, 'R' remove, 0xFF none)
+ * Byte 9-12  Section, position, chunks already moved, section count before it
+ * Byte 13-22 UID being inserted
+ * Byte 23-   Sections, back to back, each sorted ascending:
+ *            DENY 4B | DENY 7B | DENY 10B | ALLOW 4B | ALLOW 7B | ALLOW 10B
+ * -----------------------------------------------------------------
+ *
+ * Entries carry no per-record header: a 4-byte UID costs exactly 4 bytes. The
+ * 489-byte table holds up to 122 UIDs of 4 bytes (69 of 7, 48 of 10): the whole
+ * EEPROM is allocated, so a fleet with hundreds of badges to list needs a
+ * larger part or external storage. Lookup is a binary search in the section
+ * matching the UID size (at most 7 probes per section).
+ *
+ * Power safety: inserting or removing a UID moves every entry after it, which
+ * takes hundreds of EEPROM writes. The operation is recorded in the header
+ * first and its progress is committed as it goes; uidIndexInit() completes an
+ * operation cut by a power loss, so the sections never end up misaligned.
+ * @author Dag
+ */
+
+#ifndef RFID_UID_INDEX_H
+#define RFID_UID_INDEX_H
+
+#include "Arduino.h"
+
+/**
+ * @brief UID classification
+ */
+enum UidStatus : byte
+{
+    UID_UNKNOWN, // Not listed
+    UID_ALLOWED, // Listed in the allowlist
+    UID_DENIED   // Listed in the denylist: rejected right after anticollision
+};
+
+/**
+ * @brief Format the index region if it does not hold a valid table
+ * @details Called once at boot. An empty or foreign region is reset to an empty table;
+ *          an insertion or removal cut by a power loss is completed.
+ */
+void uidIndexInit();
+
+/**
+ * @brief Look up a UID
+ * @param uid UID bytes
+ * @param size UID size (4, 7 or 10)
+ * @return UID_DENIED, UID_ALLOWED or UID_UNKNOWN
+ */
+UidStatus uidIndexLookup(const byte *uid, byte size);
+
+/**
+ * @brief Insert a UID in the allowlist or denylist
+ * @details Keeps the section sorted. A UID already present in the other list is moved:
+ *          it is inserted first and then removed from the other list, so the move
+ *          needs room for one more UID.
+ * @param uid UID bytes
+ * @param size UID size (4, 7 or 10)
+ * @param status UID_ALLOWED or UID_DENIED
+ * @return true if stored (or already present), false if the table is full or size is invalid
+ */
+bool uidIndexPut(const byte *uid, byte size, UidStatus status);
+
+/**
+ * @brief Remove a UID from both lists
+ * @param uid UID bytes
+ * @param size UID size (4, 7 or 10)
+ * @return true if the UID was listed and has been removed
+ */
+bool uidIndexRemove(const byte *uid, byte size);
+
+/**
+ * @brief Number of listed UIDs (both lists)
+ */
+uint16_t uidIndexCount();
+
+/**
+ * @brief Print every listed UID on Serial, one per line, with its status
+ */
+void printUidIndex();
+
+#endif // RFID_UID_INDEX_H
@@ -0,0 +1,148 @@
+/**
+ * @file ultralight.cpp
+ * @brief Implementation of the Ultralight / NTAG backend
+ * @author Dag
+ */
+
+#include "ultralight.h"
+#include "data.h"
+#include "keyring.h"
+
+static const byte CMD_GET_VERSION = 0x60;
+static const byte UL_DATA_BLOCKS = 3; // 48-byte Ultralight user memory
+
+/**
+ * @brief Tags known by their GET_VERSION storage size byte
+ */
+struct UltralightModel
+{
+    byte storage;    // GET_VERSION byte 6
+    byte dataBlocks; // User memory / 16
+    byte configPage; // CFG0 page
+};
+
+static const UltralightModel MODELS[] PROGMEM = {
+    {0x0B, 3, 0x10},  // Ultralight EV1 MF0UL11, 48 bytes
+    {0x0E, 8, 0x25},  // Ultralight EV1 MF0UL21, 128 bytes
+    {0x0F, 9, 0x29},  // NTAG213, 144 bytes
+    {0x11, 31, 0x83}, // NTAG215, 504 bytes
+    {0x13, 55, 0xE3}, // NTAG216, 888 bytes
+};
+
+bool isUltralight(byte sak)
+{
+    return MFRC522::PICC_GetType(sak) == MFRC522::PICC_TYPE_MIFARE_UL;
+}
+
+MFRC522::StatusCode ultralightIdentify(TracedMFRC522 *rfid, UltralightInfo *info)
+{
+    byte command[3] = {CMD_GET_VERSION};
+    byte version[10]; // 8 bytes + CRC
+    byte length = sizeof(version);
+
+    info->dataBlocks = UL_DATA_BLOCKS;
+    info->configPage = UL_CONFIG_NONE;
+
+    MFRC522::StatusCode status = rfid->PCD_CalculateCRC(command, 1, command + 1);
+    if (status == MFRC522::STATUS_OK)
+        status = rfid->PCD_TransceiveData(command, sizeof(command), version, &length, nullptr, 0, true);
+    if (status != MFRC522::STATUS_OK)
+        return reselectCard(rfid); // No GET_VERSION: plain Ultralight, now idle
+
+    for (byte i = 0; i < sizeof(MODELS) / sizeof(MODELS[0]); i++)
+    {
+        if (pgm_read_byte(&MODELS[i].storage) == version[6])
+        {
+            info->dataBlocks = pgm_read_byte(&MODELS[i].dataBlocks);
+            info->configPage = pgm_read_byte(&MODELS[i].configPage);
+            break;
+        }
+    }
+    return MFRC522::STATUS_OK;
+}
+
+MFRC522::StatusCode ultralightReadBlock(TracedMFRC522 *rfid, byte index, byte *buffer)
+{
+    byte length = 18;
+    return rfid->MIFARE_Read(ultralightPage(index), buffer, &length);
+}
+
+MFRC522::StatusCode ultralightWriteBlock(TracedMFRC522 *rfid, byte index, const byte *data, byte *page)
+{
+    for (byte i = 0; i < UL_PAGES_PER_BLOCK; i++)
+    {
+        byte bytes[4];
+        memcpy(bytes, data + i * 4, 4);
+        *page = ultralightPage(index) + i;
+
+        MFRC522::StatusCode status = rfid->MIFARE_Ultralight_Write(*page, bytes, sizeof(bytes));
+        if (status != MFRC522::STATUS_OK)
+            return status;
+    }
+    return MFRC522::STATUS_OK;
+}
+
+MFRC522::StatusCode ultralightIsProtected(TracedMFRC522 *rfid, const UltralightInfo &info, bool *protectedPages)
+{
+    byte config[18];
+    byte length = sizeof(config);
+
+    *protectedPages = false;
+    if (info.configPage == UL_CONFIG_NONE)
+        return MFRC522::STATUS_OK;
+
+    MFRC522::StatusCode status = rfid->MIFARE_Read(info.configPage, config, &length);
+    if (status == MFRC522::STATUS_OK)
+        *protectedPages = config[3] <= UL_FIRST_DATA_PAGE;
+    return status;
+}
+
+MFRC522::StatusCode ultralightUnlock(TracedMFRC522 *rfid)
+{
+    byte password[4];
+    byte pack[2];
+    memcpy_P(password, ntag_password, sizeof(password));
+
+    MFRC522::StatusCode status = rfid->PCD_NTAG216_AUTH(password, pack);
+    if (status == MFRC522::STATUS_OK && memcmp_P(pack, ntag_pack, sizeof(pack)) != 0)
+        status = MFRC522::STATUS_MIFARE_NACK; // Tag answering for a different password
+    return status;
+}
+
+MFRC522::StatusCode ultralightProtect(TracedMFRC522 *rfid, const UltralightInfo &info, byte *page)
+{
+    byte config[18];
+    byte length = sizeof(config);
+    byte bytes[4];
+
+    // CFG0 and CFG1 are kept, except AUTH0 and the PROT bit
+    *page = info.configPage;
+    MFRC522::StatusCode status = rfid->MIFARE_Read(info.configPage, config, &length);
+    if (status != MFRC522::STATUS_OK)
+        return status;
+
+    memcpy_P(bytes, ntag_password, 4);
+    *page = info.configPage + 2;
+    status = rfid->MIFARE_Ultralight_Write(*page, bytes, 4);
+    if (status != MFRC522::STATUS_OK)
+        return status;
+
+    memcpy_P(bytes, ntag_pack, 2);
+    bytes[2] = bytes[3] = 0;
+    *page = info.configPage + 3;
+    status = rfid->MIFARE_Ultralight_Write(*page, bytes, 4);
+    if (status != MFRC522::STATUS_OK)
+        return status;
+
+    memcpy(bytes, config + 4, 4);
+    bytes[0] &= 0x7F; // PROT = 0: reads stay free
+    *page = info.configPage + 1;
+    status = rfid->MIFARE_Ultralight_Write(*page, bytes, 4);
+    if (status != MFRC522::STATUS_OK)
+        return status;
+
+    memcpy(bytes, config, 4);
+    bytes[3] = UL_FIRST_DATA_PAGE; // AUTH0 last: protection starts only with a complete password
+    *page = info.configPage;
+    return rfid->MIFARE_Ultralight_Write(*page, bytes, 4);
+}
@@ -0,0 +1,100 @@
+/**
+ * @file ultralight.h
+ * @brief MIFARE Ultralight / NTAG card backend
+ * @details Ultralight and NTAG21x tags have 4-byte pages and no Crypto1: one READ
+ *          returns 4 pages (16 bytes) without authentication. The credential keeps
+ *          the MIFARE Classic format, its n-th 16-byte block is stored in pages
+ *          4 + 4n .. 7 + 4n, so reading a 64-byte credential takes 4 commands
+ *          instead of 4 reads plus one authentication per sector.
+ *
+ *          NTAG21x and Ultralight EV1 have a 32-bit write password (PWD_AUTH).
+ *          The writer protects the user pages against writes with ntag_password
+ *          (secrets.h); reads stay free, so readers never authenticate. The tags
+ *          are therefore only accepted for UID-bound credentials (UID-MAC, records):
+ *          the passphrase is never written to or read from them (checkCompatibility()).
+ *          PWD_AUTH sends the password in clear: it guards against overwriting, it
+ *          is not a secret.
+ *
+ * Configuration pages (offset from the config page of the chip):
+ * -----------------------------------------------------------------
+ * +0  CFG0:   MIRROR | RFU | MIRROR_PAGE | AUTH0 (first protected page)
+ * +1  CFG1:   ACCESS (bit 7 PROT: 0 = write protection only) | RFU
+ * +2  PWD:    4-byte password, reads back as zeros
+ * +3  PACK:   2-byte password acknowledge | RFU
+ * -----------------------------------------------------------------
+ * @author Dag
+ */
+
+#ifndef RFID_ULTRALIGHT_H
+#define RFID_ULTRALIGHT_H
+
+#include "Arduino.h"
+#include <MFRC522.h>
+#include "rf-trace.h"
+
+const byte UL_FIRST_DATA_PAGE = 4; // Pages 0-3: UID, lock bytes, capability container
+const byte UL_PAGES_PER_BLOCK = 4; // One READ returns 4 pages
+const byte UL_CONFIG_NONE = 0;     // No password support (Ultralight, Ultralight C)
+
+/**
+ * @brief Memory layout of the tag in the field
+ */
+struct UltralightInfo
+{
+    byte dataBlocks; // 16-byte credential blocks in the user memory
+    byte configPage; // CFG0 page, UL_CONFIG_NONE if the tag has no password
+};
+
+/** @brief The SAK is the one of an Ultralight / NTAG tag */
+bool isUltralight(byte sak);
+
+/** @brief First page of the n-th credential block */
+inline byte ultralightPage(byte index)
+{
+    return UL_FIRST_DATA_PAGE + index * UL_PAGES_PER_BLOCK;
+}
+
+/**
+ * @brief Identify the tag with GET_VERSION
+ * @details Tags without GET_VERSION (Ultralight, Ultralight C) answer with a NAK
+ *          and go idle: they are selected again and get the 48-byte Ultralight
+ *          layout, without password.
+ * @param rfid Reader, with the tag selected
+ * @param info Destination
+ * @return STATUS_OK, or the status of the reselect if the tag left the field
+ */
+MFRC522::StatusCode ultralightIdentify(TracedMFRC522 *rfid, UltralightInfo *info);
+
+/**
+ * @brief Read one credential block (4 pages)
+ * @param buffer Destination, at least 18 bytes (16 data bytes + 2 CRC bytes)
+ */
+MFRC522::StatusCode ultralightReadBlock(TracedMFRC522 *rfid, byte index, byte *buffer);
+
+/**
+ * @brief Write one credential block (4 pages)
+ * @param page Set to the page that failed
+ */
+MFRC522::StatusCode ultralightWriteBlock(TracedMFRC522 *rfid, byte index, const byte *data, byte *page);
+
+/**
+ * @brief Check whether the credential pages are write protected
+ * @param protectedPages Set to true if AUTH0 covers the first data page
+ */
+MFRC522::StatusCode ultralightIsProtected(TracedMFRC522 *rfid, const UltralightInfo &info, bool *protectedPages);
+
+/**
+ * @brief Authenticate with ntag_password (PWD_AUTH) and check the PACK
+ * @return STATUS_OK, STATUS_MIFARE_NACK if the password or the PACK is wrong
+ */
+MFRC522::StatusCode ultralightUnlock(TracedMFRC522 *rfid);
+
+/**
+ * @brief Write protect the user pages with ntag_password
+ * @details PWD and PACK are written before AUTH0: a tag pulled half way stays
+ *          unprotected, never protected with a partial password.
+ * @param page Set to the page that failed
+ */
+MFRC522::StatusCode ultralightProtect(TracedMFRC522 *rfid, const UltralightInfo &info, byte *page);
+
+#endif // RFID_ULTRALIGHT_H
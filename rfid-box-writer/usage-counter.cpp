@@ -0,0 +1,180 @@
+/**
+ * @file usage-counter.cpp
+ * @brief Implementation of the usage-limited badge counter
+ * @author Dag
+ */
+
+#include "usage-counter.h"
+#include "data.h"
+#include "keyring.h"
+#include "ultralight.h"
+
+static const byte VALUE_BLOCK = USAGE_SECTOR * 4; // Block 0 of the sector
+static const byte TRAILER_BLOCK = USAGE_SECTOR * 4 + 3;
+
+/**
+ * @brief Decode a MIFARE value block
+ * @details Value, inverted value and value again, then the address byte four times,
+ *          inverted in the odd positions. Anything else is not a counter.
+ * @param data 16 bytes read from the block
+ * @param value Decoded value
+ * @return true if the block is a well-formed value block of VALUE_BLOCK
+ */
+static bool decodeValue(const byte *data, int32_t *value)
+{
+    for (byte i = 0; i < 4; i++)
+        if (data[i] != data[i + 8] || data[i] != (byte)~data[i + 4])
+            return false;
+    if (data[12] != VALUE_BLOCK || data[14] != VALUE_BLOCK ||
+        data[13] != (byte)~VALUE_BLOCK || data[15] != (byte)~VALUE_BLOCK)
+        return false;
+
+    *value = (int32_t)((uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24);
+    return true;
+}
+
+/** @brief The card has a counter sector at all (MIFARE Classic 1K / 4K, a Mini stops at sector 4) */
+static bool usageSupported(TracedMFRC522 *rfid)
+{
+    if (USAGE_SECTOR == 0 || isUltralight(rfid->uid.sak))
+        return false;
+    return MFRC522::PICC_GetType(rfid->uid.sak) != MFRC522::PICC_TYPE_MIFARE_MINI;
+}
+
+/**
+ * @brief Read and decode the value block of the authenticated sector
+ * @param valid Set to false if the block is not a counter
+ * @return false on RF failure (event published)
+ */
+static bool readValue(TracedMFRC522 *rfid, EventQueue *events, int32_t *value, bool *valid)
+{
+    byte buffer[18]; // 16 data bytes + 2 CRC bytes
+    byte len = sizeof(buffer);
+
+    MFRC522::StatusCode status = rfid->MIFARE_Read(VALUE_BLOCK, buffer, &len);
+    if (status != MFRC522::STATUS_OK)
+    {
+        events->publish(EV_BLOCK_READ_FAILED, VALUE_BLOCK, status);
+        return false;
+    }
+    *valid = decodeValue(buffer, value);
+    return true;
+}
+
+UsageResult usageCharge(TracedMFRC522 *rfid, EventQueue *events)
+{
+    MFRC522::StatusCode status;
+    int32_t value;
+    bool valid;
+
+    if (!usageSupported(rfid))
+        return USAGE_UNLIMITED;
+
+    if (!keyringAuthenticate(rfid, VALUE_BLOCK, &status))
+    {
+        events->publish(EV_AUTH_FAILED, VALUE_BLOCK, status);
+        return USAGE_FAILED;
+    }
+    if (!readValue(rfid, events, &value, &valid))
+        return USAGE_FAILED;
+    if (!valid)
+        return USAGE_UNLIMITED;
+    if (value <= 0)
+        return USAGE_EXHAUSTED;
+
+    // Decrement only loads the card's transfer buffer: nothing is stored until Transfer
+    status = rfid->MIFARE_Decrement(VALUE_BLOCK, 1);
+    if (status == MFRC522::STATUS_OK)
+        status = rfid->MIFARE_Transfer(VALUE_BLOCK);
+    if (status != MFRC522::STATUS_OK)
+    {
+        events->publish(EV_BLOCK_WRITE_FAILED, VALUE_BLOCK, status);
+        return USAGE_FAILED;
+    }
+
+    events->publish(EV_USES_LEFT, min(value - 1, (int32_t)255));
+    return USAGE_CHARGED;
+}
+
+bool usageIsCounter(TracedMFRC522 *rfid, byte trailer)
+{
+    byte buffer[18];
+    byte len = sizeof(buffer);
+
+    if (rfid->MIFARE_Read(trailer, buffer, &len) != MFRC522::STATUS_OK)
+        return false;
+    return memcmp(buffer + 6, USAGE_ACCESS_BITS, 4) == 0;
+}
+
+bool usageIssue(TracedMFRC522 *rfid, EventQueue *events, int32_t uses)
+{
+    MFRC522::StatusCode status;
+    MFRC522::MIFARE_Key key;
+    int32_t value;
+    bool valid;
+
+    if (!usageSupported(rfid))
+        return false;
+
+    if (!keyringAuthenticate(rfid, TRAILER_BLOCK, &status))
+    {
+        events->publish(EV_AUTH_FAILED, TRAILER_BLOCK, status);
+        return false;
+    }
+
+    if (usageIsCounter(rfid, TRAILER_BLOCK))
+    {
+        // Only Key B can raise the counter
+        memcpy_P(key.keyByte, usage_key, MFRC522::MF_KEY_SIZE);
+        status = rfid->PCD_Authenticate(MFRC522::PICC_CMD_MF_AUTH_KEY_B, TRAILER_BLOCK, &key, &rfid->uid);
+        if (status != MFRC522::STATUS_OK)
+        {
+            events->publish(EV_AUTH_FAILED, TRAILER_BLOCK, status);
+            return false;
+        }
+        status = rfid->MIFARE_SetValue(VALUE_BLOCK, uses);
+        if (status != MFRC522::STATUS_OK)
+        {
+            events->publish(EV_BLOCK_WRITE_FAILED, VALUE_BLOCK, status);
+            return false;
+        }
+    }
+    else
+    {
+        // Value first: a card pulled before the trailer is written stays an open sector
+        status = rfid->MIFARE_SetValue(VALUE_BLOCK, uses);
+        if (status != MFRC522::STATUS_OK)
+        {
+            events->publish(EV_BLOCK_WRITE_FAILED, VALUE_BLOCK, status);
+            return false;
+        }
+
+        byte trailer[16];
+        memcpy_P(trailer, crypto_key, MFRC522::MF_KEY_SIZE);
+        memcpy(trailer + 6, USAGE_ACCESS_BITS, 4);
+        memcpy_P(trailer + 10, usage_key, MFRC522::MF_KEY_SIZE);
+        status = rfid->MIFARE_Write(TRAILER_BLOCK, trailer, 16);
+        if (status != MFRC522::STATUS_OK)
+        {
+            events->publish(EV_BLOCK_WRITE_FAILED, TRAILER_BLOCK, status);
+            return false;
+        }
+    }
+
+    // Verify as a reader: Key A, value block readable and holding uses
+    if (!keyringAuthenticatePreferred(rfid, TRAILER_BLOCK, &status))
+    {
+        events->publish(EV_AUTH_FAILED, TRAILER_BLOCK, status);
+        return false;
+    }
+    if (!readValue(rfid, events, &value, &valid))
+        return false;
+    if (!valid || value != uses || !usageIsCounter(rfid, TRAILER_BLOCK))
+    {
+        events->publish(EV_VERIFY_FAILED, VALUE_BLOCK);
+        return false;
+    }
+
+    events->publish(EV_USES_LOADED, min(uses, (int32_t)255));
+    return true;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file usage-counter.h
+ * @brief Entry counter of usage-limited badges, on a MIFARE Classic value block
+ * @details A contractor badge allows a fixed number of entries. The count is not kept
+ *          in a data block rewritten at each tap: block 0 of USAGE_SECTOR (config.h)
+ *          is a value block, and the card itself applies the update.
+ *
+ *          Sector of a limited badge, as written by usageIssue():
+ *          -----------------------------------------------------------------
+ *          block 0   value block: remaining entries, address byte = block number
+ *          block 1-2 left as they are, read-only
+ *          trailer   Key A crypto_key | USAGE_ACCESS_BITS | Key B usage_key (secrets.h)
+ *          -----------------------------------------------------------------
+ *          Access conditions (C1 C2 C3):
+ *          block 0   110  read A|B, write B, increment B, decrement / transfer / restore A|B
+ *          block 1-2 100  read A|B, write B: no value can be restored from them
+ *          trailer   011  keys and access bits written with Key B only, Key B not readable
+ *
+ *          Readers only hold Key A: they read and decrement the counter, they can never
+ *          raise it or re-key the sector. A granted tap reads the value and, if
+ *          positive, sends Decrement 1 and Transfer in the session that validated the
+ *          card. The card commits the new value at Transfer: a badge pulled before it
+ *          keeps its entries and is not granted, a badge pulled after it may lose that
+ *          entry, never gain one.
+ *
+ *          A sector whose block 0 is not a value block is not a counter: the badge is
+ *          unlimited. Ultralight / NTAG tags have no value blocks and are never limited.
+ * @author Dag
+ */
+
+#ifndef RFID_USAGE_COUNTER_H
+#define RFID_USAGE_COUNTER_H
+
+#include "Arduino.h"
+#include <MFRC522.h>
+#include "config.h"
+#include "events.h"
+#include "rf-trace.h"
+
+/**
+ * @brief Access bits of a counter sector (see the table above), general purpose byte 0x69
+ */
+const byte USAGE_ACCESS_BITS[4] = {0x68, 0x77, 0x89, 0x69};
+
+/**
+ * @brief Outcome of a tap on the counter
+ */
+enum UsageResult : byte
+{
+    USAGE_UNLIMITED, // No counter on the card, or USAGE_SECTOR is 0
+    USAGE_CHARGED,   // One entry taken (EV_USES_LEFT published)
+    USAGE_EXHAUSTED, // No entry left: the tap must be denied
+    USAGE_FAILED     // Authentication or RF error, failure published: the tap must be denied
+};
+
+/** @brief The block belongs to the counter sector and never carries credential data */
+inline bool usageReserved(int block)
+{
+    return USAGE_SECTOR != 0 && block / 4 == USAGE_SECTOR;
+}
+
+/**
+ * @brief Take one entry from the badge in the field
+ * @details The sector is authenticated with Key A (keyring.h). An authentication or
+ *          read failure is not taken as "unlimited": a badge pulled at that moment
+ *          would otherwise be granted for free.
+ * @param rfid Reader, with the card selected
+ * @param events Failures, EV_USES_LEFT on success
+ */
+UsageResult usageCharge(TracedMFRC522 *rfid, EventQueue *events);
+
+/**
+ * @brief Load entries on the badge in the field (writer builds)
+ * @details A plain sector gets its value block first, then the trailer that locks it.
+ *          A sector that already is a counter is rewritten with Key B. The value is
+ *          read back with Key A, as a reader sees it.
+ * @param rfid Reader, with the card selected
+ * @param events Failures, EV_USES_LOADED on success
+ * @param uses Entries, at least 1
+ * @return true if the counter holds uses
+ */
+bool usageIssue(TracedMFRC522 *rfid, EventQueue *events, int32_t uses);
+
+/**
+ * @brief The authenticated sector is already a counter (its access bits are)
+ * @param rfid Reader, with the sector authenticated
+ * @param trailer Trailer block of the sector
+ */
+bool usageIsCounter(TracedMFRC522 *rfid, byte trailer);
+
+#endif // RFID_USAGE_COUNTER_H
@@ -0,0 +1,499 @@
+/**
+ * @file box-console.cpp
+ * @brief Command line client of the RFID Box framed console (rfid-box-writer/console.h)
+ * @details The commands are packed into FRAME_CONSOLE batches (up to the 80-byte
+ *          receive buffer of the box) and sent without waiting for each reply: one
+ *          round trip per batch, --window batches in flight. Every reply is printed
+ *          on stdout as a JSON line, in command order. Frames exported by a command
+ *          (log, trace) are attached to its reply as hex.
+ *
+ *          The port is probed with CMD_STATUS until the box answers, since opening
+ *          it may reset the board.
+ *
+ *          Commands (arguments or '-' to read them from stdin, one per line):
+ *              status | stats | mode read|write [run|set] | allow UID | deny UID |
+ *              forget UID | lookup UID | log | trace [clear] | dump | cancel JOB_ID
+ *
+ *          Build: g++ -std=c++17 -O2 -Wall -o box-console box-console.cpp
+ *          Usage: box-console [--baud N] [--timeout MS] [--window N] PORT COMMAND...
+ * @author Dag
+ */
+
+#include "frame.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace rfid;
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+const size_t BATCH_MAX = 80; // cmdLine of the sketch
+const long PROBE_INTERVAL_MS = 500;
+
+// ConsoleOp / ConsoleStatus (rfid-box-writer/console.h)
+const uint8_t CMD_STATUS = 0x01;
+const uint8_t CMD_STATS = 0x02;
+const uint8_t CMD_MODE = 0x03;
+const uint8_t CMD_UID_PUT = 0x10;
+const uint8_t CMD_UID_REMOVE = 0x11;
+const uint8_t CMD_UID_LOOKUP = 0x12;
+const uint8_t CMD_LOG = 0x20;
+const uint8_t CMD_TRACE = 0x21;
+const uint8_t CMD_DUMP = 0x22;
+const uint8_t CMD_JOB_CANCEL = 0x31;
+
+const char *const STATUS_NAMES[] = {"ok", "unknown", "bad_args", "unsupported", "failed", "malformed"};
+const char *const UID_STATUS_NAMES[] = {"unknown", "allowed", "denied"}; // uid-index.h
+const char *const COUNTER_NAMES[] = {"taps", "grants", "rejects", "auth_failures", "read_errors",
+                                     "writes", "watchdog_recoveries"}; // counters.h
+
+struct Options
+{
+    speed_t baud = B9600;
+    long timeoutMs = 3000;
+    size_t window = 1; // Batches in flight: the box has a 64-byte receive buffer
+};
+
+struct Command
+{
+    std::string text;
+    uint8_t op = 0;
+    std::vector<uint8_t> args;
+    std::vector<uint8_t> exported; // Frame sent before the reply (log, trace)
+};
+
+struct Batch
+{
+    uint8_t seq = 0;
+    size_t first = 0; // Index of its first command
+    size_t count = 0;
+    size_t replies = 0;
+};
+
+std::string hex(const std::vector<uint8_t> &data)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    std::string s;
+    for (uint8_t b : data)
+    {
+        s += digits[b >> 4];
+        s += digits[b & 0x0F];
+    }
+    return s;
+}
+
+std::string jsonString(const std::string &s)
+{
+    std::string out = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+bool parseUid(const std::string &text, std::vector<uint8_t> *uid)
+{
+    std::string digits;
+    for (char c : text)
+        if (c != ' ' && c != ':')
+            digits += c;
+    if (digits.size() % 2 != 0)
+        return false;
+    uid->clear();
+    for (size_t i = 0; i < digits.size(); i += 2)
+        uid->push_back(static_cast<uint8_t>(std::stoul(digits.substr(i, 2), nullptr, 16)));
+    return uid->size() == 4 || uid->size() == 7 || uid->size() == 10;
+}
+
+/** @brief Encode a command line, false if it is not a console command */
+bool parseCommand(const std::string &text, Command *cmd)
+{
+    std::istringstream in(text);
+    std::string verb, arg, rest;
+    in >> verb >> arg;
+    std::getline(in, rest);
+    cmd->text = text;
+
+    try
+    {
+        if (verb == "status" || verb == "stats" || verb == "log" || verb == "dump")
+        {
+            cmd->op = verb == "status" ? CMD_STATUS : verb == "stats" ? CMD_STATS : verb == "log" ? CMD_LOG : CMD_DUMP;
+            return arg.empty();
+        }
+        if (verb == "trace")
+        {
+            cmd->op = CMD_TRACE;
+            if (arg == "clear")
+                cmd->args = {1};
+            return arg.empty() || arg == "clear";
+        }
+        if (verb == "mode")
+        {
+            std::string job = rest.empty() ? "run" : rest.substr(rest.find_first_not_of(' '));
+            cmd->op = CMD_MODE;
+            cmd->args = {static_cast<uint8_t>(arg == "write"), static_cast<uint8_t>(job == "set")};
+            return (arg == "read" || arg == "write") && (job == "run" || job == "set");
+        }
+        if (verb == "allow" || verb == "deny" || verb == "forget" || verb == "lookup")
+        {
+            std::vector<uint8_t> uid;
+            if (!parseUid(arg + rest, &uid))
+                return false;
+            cmd->op = verb == "forget" ? CMD_UID_REMOVE : verb == "lookup" ? CMD_UID_LOOKUP : CMD_UID_PUT;
+            if (cmd->op == CMD_UID_PUT)
+                cmd->args.push_back(verb == "allow" ? 1 : 2); // UID_ALLOWED, UID_DENIED
+            cmd->args.insert(cmd->args.end(), uid.begin(), uid.end());
+            return true;
+        }
+        if (verb == "cancel")
+        {
+            unsigned long id = std::stoul(arg);
+            cmd->op = CMD_JOB_CANCEL;
+            cmd->args = {static_cast<uint8_t>(id), static_cast<uint8_t>(id >> 8)};
+            return id <= 0xFFFF;
+        }
+    }
+    catch (const std::exception &)
+    {
+    }
+    return false;
+}
+
+uint32_t le(const std::vector<uint8_t> &d, size_t pos, size_t size)
+{
+    uint32_t v = 0;
+    for (size_t i = 0; i < size; i++)
+        v |= static_cast<uint32_t>(d[pos + i]) << (8 * i);
+    return v;
+}
+
+/** @brief JSON line of a reply: status, then the decoded data of the command */
+std::string replyJson(const Command &cmd, uint8_t status, const std::vector<uint8_t> &data)
+{
+    std::ostringstream out;
+    out << "{\"cmd\":" << jsonString(cmd.text) << ",\"status\":\""
+        << (status < sizeof(STATUS_NAMES) / sizeof(*STATUS_NAMES) ? STATUS_NAMES[status] : "?") << "\"";
+
+    if (cmd.op == CMD_STATUS && data.size() >= 6)
+        out << ",\"agent\":\"" << (data[0] ? "writer" : "reader") << "\",\"mode\":\"" << (data[1] ? "write" : "read")
+            << "\",\"job\":\"" << (data[2] ? "set" : "run") << "\",\"armed\":" << (data[3] ? "true" : "false")
+            << ",\"job_id\":" << le(data, 4, 2);
+    else if (cmd.op == CMD_MODE && data.size() >= 2)
+        out << ",\"mode\":\"" << (data[0] ? "write" : "read") << "\",\"job\":\"" << (data[1] ? "set" : "run") << "\"";
+    else if (cmd.op == CMD_UID_LOOKUP && data.size() >= 1 && data[0] < 3)
+        out << ",\"uid\":\"" << UID_STATUS_NAMES[data[0]] << "\"";
+    else if (cmd.op == CMD_STATS && data.size() >= 11)
+    {
+        out << ",\"boot_us\":" << le(data, 0, 4) << ",\"stack_peak\":" << le(data, 4, 2) << ",\"free_heap\":"
+            << le(data, 6, 2) << ",\"uids\":" << le(data, 8, 2) << ",\"audit_records\":" << unsigned(data[10]);
+        for (size_t c = 0; c < sizeof(COUNTER_NAMES) / sizeof(*COUNTER_NAMES) && 11 + 4 * c + 4 <= data.size(); c++)
+            out << ",\"" << COUNTER_NAMES[c] << "\":" << le(data, 11 + 4 * c, 4);
+    }
+    if (!cmd.exported.empty())
+        out << ",\"frame\":\"" << hex(cmd.exported) << "\"";
+    out << "}";
+    return out.str();
+}
+
+/** @brief Pack the commands into batches of at most BATCH_MAX payload bytes */
+std::vector<Batch> makeBatches(const std::vector<Command> &commands)
+{
+    std::vector<Batch> batches;
+    size_t size = BATCH_MAX;
+    for (size_t i = 0; i < commands.size(); i++)
+    {
+        size_t cost = 2 + commands[i].args.size();
+        if (size + cost > BATCH_MAX)
+        {
+            batches.emplace_back();
+            batches.back().seq = static_cast<uint8_t>(1 + (batches.size() - 1) % 255); // 0: probe
+            batches.back().first = i;
+            size = 1; // Sequence number
+        }
+        batches.back().count++;
+        size += cost;
+    }
+    return batches;
+}
+
+std::vector<uint8_t> batchPayload(const Batch &batch, const std::vector<Command> &commands)
+{
+    std::vector<uint8_t> payload = {batch.seq};
+    for (size_t i = batch.first; i < batch.first + batch.count; i++)
+    {
+        payload.push_back(commands[i].op);
+        payload.push_back(static_cast<uint8_t>(commands[i].args.size()));
+        payload.insert(payload.end(), commands[i].args.begin(), commands[i].args.end());
+    }
+    return payload;
+}
+
+bool openPort(const char *path, speed_t baud, int *fd)
+{
+    *fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (*fd < 0)
+        return false;
+
+    termios tio;
+    if (tcgetattr(*fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, baud);
+        cfsetospeed(&tio, baud);
+        tcsetattr(*fd, TCSANOW, &tio);
+    }
+    return true;
+}
+
+/**
+ * @brief Serial port with its frame decoder
+ */
+class Link
+{
+public:
+    explicit Link(int fd) : fd(fd) {}
+
+    /** @brief Wait for the next valid frame, false on timeout or read error */
+    bool next(Clock::time_point deadline)
+    {
+        for (;;)
+        {
+            while (pos < received.size())
+                if (decoder.feed(received[pos++]))
+                    return true;
+
+            long left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            if (left <= 0)
+                return false;
+            pollfd p = {fd, POLLIN, 0};
+            if (poll(&p, 1, static_cast<int>(left)) <= 0)
+                continue;
+
+            received.resize(256);
+            ssize_t n = read(fd, received.data(), received.size());
+            if (n < 0 && errno != EAGAIN)
+                return false;
+            received.resize(n > 0 ? n : 0);
+            pos = 0;
+        }
+    }
+
+    bool send(uint8_t type, const std::vector<uint8_t> &payload)
+    {
+        std::vector<uint8_t> frame = encodeFrame(type, payload);
+        size_t sent = 0;
+        while (sent < frame.size())
+        {
+            ssize_t n = write(fd, frame.data() + sent, frame.size() - sent);
+            if (n < 0 && errno != EAGAIN)
+                return false;
+            if (n > 0)
+                sent += n;
+            else
+            {
+                pollfd p = {fd, POLLOUT, 0};
+                poll(&p, 1, 100);
+            }
+        }
+        return true;
+    }
+
+    const FrameDecoder &frame() const { return decoder; }
+
+private:
+    int fd;
+    FrameDecoder decoder;
+    std::vector<uint8_t> received;
+    size_t pos = 0;
+};
+
+Clock::time_point after(long ms)
+{
+    return Clock::now() + std::chrono::milliseconds(ms);
+}
+
+/** @brief CMD_STATUS until the box answers (it may be booting after the port was opened) */
+bool probe(Link *link, long timeoutMs)
+{
+    Clock::time_point deadline = after(timeoutMs);
+    while (Clock::now() < deadline)
+    {
+        if (!link->send(FRAME_CONSOLE, {0, CMD_STATUS, 0}))
+            return false;
+        Clock::time_point retry = after(PROBE_INTERVAL_MS);
+        while (link->next(retry))
+            if (link->frame().type() == FRAME_CONSOLE_REPLY && link->frame().payload()[0] == 0)
+                return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Send the batches, --window at a time, and print the replies
+ * @return Exit status: 0 if every command succeeded
+ */
+int run(Link *link, std::vector<Command> &commands, const Options &options)
+{
+    std::vector<Batch> batches = makeBatches(commands);
+    std::vector<uint8_t> exported;
+    size_t sent = 0;
+    size_t done = 0;
+    int failures = 0;
+
+    while (done < batches.size())
+    {
+        for (; sent < batches.size() && sent - done < options.window; sent++)
+            if (!link->send(FRAME_CONSOLE, batchPayload(batches[sent], commands)))
+            {
+                std::cerr << "write: " << strerror(errno) << "\n";
+                return 1;
+            }
+
+        if (!link->next(after(options.timeoutMs)))
+        {
+            std::cerr << "No reply to batch " << unsigned(batches[done].seq) << "\n";
+            return 1;
+        }
+
+        const std::vector<uint8_t> &payload = link->frame().payload();
+        uint8_t type = link->frame().type();
+        if (type == FRAME_AUDIT_LOG || type == FRAME_TRACE)
+        {
+            exported = payload; // Belongs to the next reply
+            continue;
+        }
+        if (type != FRAME_CONSOLE_REPLY || payload.size() < 4)
+            continue;
+
+        for (size_t b = done; b < sent; b++)
+        {
+            Batch &batch = batches[b];
+            if (batch.seq != payload[0] || payload[1] >= batch.count)
+                continue;
+
+            Command &cmd = commands[batch.first + payload[1]];
+            cmd.exported.swap(exported);
+            exported.clear();
+            std::cout << replyJson(cmd, payload[3], std::vector<uint8_t>(payload.begin() + 4, payload.end())) << "\n";
+            if (payload[3] != 0)
+                failures++;
+
+            batch.replies = payload[3] == 5 ? batch.count : batch.replies + 1; // Malformed: the batch ends
+            break;
+        }
+        while (done < sent && batches[done].replies >= batches[done].count)
+            done++;
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+int usage()
+{
+    std::cerr << "Usage: box-console [--baud N] [--timeout MS] [--window N] PORT COMMAND...\n"
+              << "  COMMAND  status | stats | mode read|write [run|set] | allow UID | deny UID | forget UID |\n"
+              << "           lookup UID | log | trace [clear] | dump | cancel JOB_ID ('-': one per line on stdin)\n";
+    return 2;
+}
+
+speed_t baudConstant(unsigned long baud)
+{
+    switch (baud)
+    {
+    case 9600:
+        return B9600;
+    case 19200:
+        return B19200;
+    case 38400:
+        return B38400;
+    case 57600:
+        return B57600;
+    case 115200:
+        return B115200;
+    default:
+        return B0;
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--timeout" && hasValue)
+            options.timeoutMs = std::stol(argv[++i]);
+        else if (arg == "--window" && hasValue)
+            options.window = std::max(1UL, std::stoul(argv[++i]));
+        else if (arg == "--baud" && hasValue)
+        {
+            options.baud = baudConstant(std::stoul(argv[++i]));
+            if (options.baud == B0)
+                return usage();
+        }
+        else if (arg.size() > 1 && arg[0] == '-')
+            return usage();
+        else
+            args.push_back(arg);
+    }
+    if (args.size() < 2)
+        return usage();
+
+    std::vector<std::string> lines(args.begin() + 1, args.end());
+    if (lines.size() == 1 && lines[0] == "-")
+    {
+        lines.clear();
+        for (std::string line; std::getline(std::cin, line);)
+            if (!line.empty() && line[0] != '#')
+                lines.push_back(line);
+    }
+
+    std::vector<Command> commands(lines.size());
+    for (size_t i = 0; i < lines.size(); i++)
+        if (!parseCommand(lines[i], &commands[i]))
+        {
+            std::cerr << "Invalid command: " << lines[i] << "\n";
+            return usage();
+        }
+
+    int fd;
+    if (!openPort(args[0].c_str(), options.baud, &fd))
+    {
+        std::cerr << args[0] << ": " << strerror(errno) << "\n";
+        return 1;
+    }
+
+    Link link(fd);
+    if (!probe(&link, options.timeoutMs))
+    {
+        std::cerr << args[0] << ": no answer from the box\n";
+        return 1;
+    }
+    int status = run(&link, commands, options);
+    close(fd);
+    return status;
+}
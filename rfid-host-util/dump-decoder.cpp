@@ -0,0 +1,255 @@
+/**
+ * @file dump-decoder.cpp
+ * @brief Decode RFID Box card dumps (FRAME_CARD_INFO / FRAME_SECTOR / FRAME_CARD_END)
+ * @details Reads a serial capture (file or stdin), extracts the CRC-checked frames
+ *          and prints every card as a hex listing, as JSON (one object per line),
+ *          or writes a raw memory image per card (<UID>.mfd, unreadable chunks as zeros).
+ *
+ *          Build: g++ -std=c++17 -O2 -Wall -o dump-decoder dump-decoder.cpp
+ *          Usage: dump-decoder [--hex | --json | --raw DIR] [CAPTURE]
+ * @author Dag
+ */
+
+#include "frame.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace rfid;
+
+namespace
+{
+
+const size_t CHUNK_SIZE = 64;
+const uint8_t NO_KEY_INDEX = 0xFF;
+
+enum OutputFormat
+{
+    OUTPUT_HEX,
+    OUTPUT_JSON,
+    OUTPUT_RAW
+};
+
+struct Chunk
+{
+    bool received = false;
+    uint8_t status = 0;
+    uint8_t keyIndex = NO_KEY_INDEX;
+};
+
+struct CardImage
+{
+    std::vector<uint8_t> uid;
+    uint8_t sak = 0;
+    std::vector<Chunk> chunks;
+    std::vector<uint8_t> memory; // chunks * 64 bytes
+};
+
+std::string hex(const uint8_t *data, size_t len, const char *separator)
+{
+    std::string out;
+    char digits[3];
+    for (size_t i = 0; i < len; i++)
+    {
+        snprintf(digits, sizeof(digits), "%02X", data[i]);
+        if (i > 0)
+            out += separator;
+        out += digits;
+    }
+    return out;
+}
+
+const char *typeName(uint8_t sak)
+{
+    switch (sak & 0x7F)
+    {
+    case 0x09:
+        return "MIFARE Mini";
+    case 0x08:
+        return "MIFARE 1K";
+    case 0x18:
+        return "MIFARE 4K";
+    default:
+        return "unknown";
+    }
+}
+
+void printHex(const CardImage &card)
+{
+    std::cout << "Card UID " << hex(card.uid.data(), card.uid.size(), " ")
+              << "  SAK " << hex(&card.sak, 1, "") << " (" << typeName(card.sak) << ")\n";
+
+    for (size_t c = 0; c < card.chunks.size(); c++)
+    {
+        const Chunk &chunk = card.chunks[c];
+        std::cout << "Chunk " << c << " (blocks " << c * 4 << "-" << c * 4 + 3 << "): ";
+        if (!chunk.received)
+        {
+            std::cout << "MISSING\n";
+            continue;
+        }
+        if (chunk.status != 0)
+        {
+            std::cout << "UNREADABLE (status " << int(chunk.status) << ")\n";
+            continue;
+        }
+        std::cout << "key " << int(chunk.keyIndex) << "\n";
+        for (size_t b = 0; b < 4; b++)
+        {
+            char label[16];
+            snprintf(label, sizeof(label), "  %3zu: ", c * 4 + b);
+            std::cout << label << hex(&card.memory[c * CHUNK_SIZE + b * 16], 16, " ") << "\n";
+        }
+    }
+    std::cout << "\n";
+}
+
+void printJson(const CardImage &card)
+{
+    std::cout << "{\"uid\":\"" << hex(card.uid.data(), card.uid.size(), "") << "\",\"sak\":" << int(card.sak)
+              << ",\"type\":\"" << typeName(card.sak) << "\",\"chunks\":[";
+    for (size_t c = 0; c < card.chunks.size(); c++)
+    {
+        const Chunk &chunk = card.chunks[c];
+        if (c > 0)
+            std::cout << ",";
+        std::cout << "{\"index\":" << c << ",\"received\":" << (chunk.received ? "true" : "false")
+                  << ",\"status\":" << int(chunk.status) << ",\"key\":";
+        if (chunk.keyIndex == NO_KEY_INDEX)
+            std::cout << "null";
+        else
+            std::cout << int(chunk.keyIndex);
+        std::cout << ",\"blocks\":[";
+        for (size_t b = 0; b < 4; b++)
+            std::cout << (b ? "," : "") << "\"" << hex(&card.memory[c * CHUNK_SIZE + b * 16], 16, "") << "\"";
+        std::cout << "]}";
+    }
+    std::cout << "]}\n";
+}
+
+bool writeRaw(const CardImage &card, const std::string &dir)
+{
+    std::string path = dir + "/" + hex(card.uid.data(), card.uid.size(), "") + ".mfd";
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(card.memory.data()), card.memory.size());
+    if (!file)
+    {
+        std::cerr << "Cannot write " << path << "\n";
+        return false;
+    }
+    std::cerr << "Wrote " << path << "\n";
+    return true;
+}
+
+int usage()
+{
+    std::cerr << "Usage: dump-decoder [--hex | --json | --raw DIR] [CAPTURE]\n";
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    OutputFormat format = OUTPUT_HEX;
+    std::string rawDir;
+    std::string input;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--hex") == 0)
+            format = OUTPUT_HEX;
+        else if (strcmp(argv[i], "--json") == 0)
+            format = OUTPUT_JSON;
+        else if (strcmp(argv[i], "--raw") == 0 && i + 1 < argc)
+        {
+            format = OUTPUT_RAW;
+            rawDir = argv[++i];
+        }
+        else if (argv[i][0] == '-')
+            return usage();
+        else
+            input = argv[i];
+    }
+
+    std::ifstream file;
+    if (!input.empty())
+    {
+        file.open(input, std::ios::binary);
+        if (!file)
+        {
+            std::cerr << "Cannot open " << input << "\n";
+            return 1;
+        }
+    }
+    std::istream &in = input.empty() ? std::cin : file;
+
+    FrameDecoder decoder;
+    CardImage card;
+    bool open = false;
+    int cards = 0;
+    bool ok = true;
+
+    auto emit = [&]() {
+        if (format == OUTPUT_HEX)
+            printHex(card);
+        else if (format == OUTPUT_JSON)
+            printJson(card);
+        else
+            ok &= writeRaw(card, rawDir);
+        cards++;
+        open = false;
+    };
+
+    char c;
+    while (in.get(c))
+    {
+        if (!decoder.feed(static_cast<uint8_t>(c)))
+            continue;
+
+        const std::vector<uint8_t> &p = decoder.payload();
+        switch (decoder.type())
+        {
+        case FRAME_CARD_INFO:
+            if (open)
+                emit(); // Previous card ended without FRAME_CARD_END
+            if (p.empty() || p.size() != size_t(p[0]) + 3)
+                break;
+            card = CardImage();
+            card.uid.assign(p.begin() + 1, p.begin() + 1 + p[0]);
+            card.sak = p[p[0] + 1];
+            card.chunks.resize(p[p[0] + 2]);
+            card.memory.assign(card.chunks.size() * CHUNK_SIZE, 0);
+            open = true;
+            break;
+
+        case FRAME_SECTOR:
+            if (!open || p.size() != CHUNK_SIZE + 3 || p[0] >= card.chunks.size())
+                break;
+            card.chunks[p[0]].received = true;
+            card.chunks[p[0]].status = p[1];
+            card.chunks[p[0]].keyIndex = p[2];
+            std::copy(p.begin() + 3, p.end(), card.memory.begin() + p[0] * CHUNK_SIZE);
+            break;
+
+        case FRAME_CARD_END:
+            if (open)
+                emit();
+            break;
+        }
+    }
+
+    if (open)
+        emit(); // Truncated capture: output what was received
+
+    if (decoder.errorCount())
+        std::cerr << "Discarded frames (bad length or CRC): " << decoder.errorCount() << "\n";
+    if (cards == 0)
+        std::cerr << "No card dump found\n";
+
+    return ok && cards > 0 ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal Arduino core for running the RFID Box sketch on Linux
+ * @details Only the subset used by rfid-box-writer: integer types, String, Print,
+ *          Serial (bound to a pseudo-terminal by box-emulator.cpp), time and GPIO.
+ *          delay() advances a virtual clock instead of sleeping.
+ * @author Dag
+ */
+
+#ifndef RFID_EMU_ARDUINO_H
+#define RFID_EMU_ARDUINO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define DEC 10
+#define HEX 16
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+class __FlashStringHelper;
+
+inline uint8_t pgm_read_byte(const void *p) { return *static_cast<const uint8_t *>(p); }
+inline uint16_t pgm_read_word(const void *p) { return *static_cast<const uint16_t *>(p); }
+inline const void *pgm_read_ptr(const void *p) { return *static_cast<const void *const *>(p); }
+inline void *memcpy_P(void *d, const void *s, size_t n) { return memcpy(d, s, n); }
+inline int memcmp_P(const void *a, const void *b, size_t n) { return memcmp(a, b, n); }
+inline size_t strlen_P(const char *s) { return strlen(s); }
+
+using std::max;
+using std::min;
+template <class A, class B>
+auto min(A a, B b) -> decltype(a < b ? a : b) { return a < b ? a : b; }
+template <class A, class B>
+auto max(A a, B b) -> decltype(a > b ? a : b) { return a > b ? a : b; }
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+/**
+ * @brief Arduino String on top of std::string
+ */
+class String
+{
+public:
+    String() {}
+    String(const char *c) : s(c ? c : "") {}
+    String(const __FlashStringHelper *c) : s(reinterpret_cast<const char *>(c)) {}
+    String(char c) : s(1, c) {}
+    String(long v, int base = DEC) { char b[34]; snprintf(b, sizeof(b), base == HEX ? "%lx" : "%ld", v); s = b; }
+    String(unsigned long v, int base = DEC) { char b[34]; snprintf(b, sizeof(b), base == HEX ? "%lx" : "%lu", v); s = b; }
+    String(int v, int base = DEC) : String(static_cast<long>(v), base) {}
+    String(unsigned v, int base = DEC) : String(static_cast<unsigned long>(v), base) {}
+    String(unsigned char v, int base = DEC) : String(static_cast<unsigned long>(v), base) {}
+
+    unsigned int length() const { return s.size(); }
+    char charAt(unsigned i) const { return s[i]; }
+    char operator[](unsigned i) const { return s[i]; }
+    char &operator[](unsigned i) { return s[i]; }
+    const char *c_str() const { return s.c_str(); }
+    bool reserve(unsigned n) { s.reserve(n); return true; }
+    void remove(unsigned i) { if (i < s.size()) s.erase(i); }
+    void remove(unsigned i, unsigned n) { if (i < s.size()) s.erase(i, n); }
+    void trim()
+    {
+        size_t a = s.find_first_not_of(" \t\r\n");
+        size_t b = s.find_last_not_of(" \t\r\n");
+        s = a == std::string::npos ? std::string() : s.substr(a, b - a + 1);
+    }
+    void toCharArray(char *b, unsigned n) const { if (n) { strncpy(b, s.c_str(), n); b[n - 1] = 0; } }
+    void getBytes(unsigned char *b, unsigned n) const { toCharArray(reinterpret_cast<char *>(b), n); }
+
+    String &operator+=(const String &o) { s += o.s; return *this; }
+    String &operator+=(const char *o) { s += o; return *this; }
+    String &operator+=(char c) { s += c; return *this; }
+    String &operator+=(const __FlashStringHelper *o) { s += reinterpret_cast<const char *>(o); return *this; }
+    bool operator==(const String &o) const { return s == o.s; }
+    bool operator==(const char *o) const { return s == o; }
+    bool operator!=(const String &o) const { return s != o.s; }
+
+private:
+    std::string s;
+};
+
+inline String operator+(const String &a, const String &b)
+{
+    String r = a;
+    r += b;
+    return r;
+}
+
+/**
+ * @brief Arduino Print: text formatting on top of write()
+ */
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t *b, size_t n)
+    {
+        for (size_t i = 0; i < n; i++)
+            write(b[i]);
+        return n;
+    }
+
+    size_t print(const char *c) { return write(reinterpret_cast<const uint8_t *>(c), strlen(c)); }
+    size_t print(const __FlashStringHelper *c) { return print(reinterpret_cast<const char *>(c)); }
+    size_t print(const String &c) { return print(c.c_str()); }
+    size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+    size_t print(long v, int base = DEC) { char b[34]; snprintf(b, sizeof(b), base == HEX ? "%lX" : "%ld", v); return print(b); }
+    size_t print(unsigned long v, int base = DEC) { char b[34]; snprintf(b, sizeof(b), base == HEX ? "%lX" : "%lu", v); return print(b); }
+    size_t print(int v, int base = DEC) { return print(static_cast<long>(v), base); }
+    size_t print(unsigned v, int base = DEC) { return print(static_cast<unsigned long>(v), base); }
+    size_t print(unsigned char v, int base = DEC) { return print(static_cast<unsigned long>(v), base); }
+    size_t print(double v, int digits = 2) { char b[34]; snprintf(b, sizeof(b), "%.*f", digits, v); return print(b); }
+
+    size_t println() { return print("\r\n"); }
+    template <class T>
+    size_t println(T v) { return print(v) + println(); }
+    template <class T>
+    size_t println(T v, int f) { return print(v, f) + println(); }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual int availableForWrite() { return 64; }
+    void flush() {}
+};
+
+/**
+ * @brief Serial port bound to the master side of a pseudo-terminal
+ */
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int peek() override;
+    operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif // RFID_EMU_ARDUINO_H
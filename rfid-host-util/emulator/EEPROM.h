@@ -0,0 +1,55 @@
+/**
+ * @file EEPROM.h
+ * @brief Emulated 1 KB EEPROM, optionally backed by a file (box-emulator --eeprom)
+ * @author Dag
+ */
+
+#ifndef RFID_EMU_EEPROM_H
+#define RFID_EMU_EEPROM_H
+
+#include "Arduino.h"
+
+class EEPROMClass
+{
+public:
+    static const int SIZE = 1024;
+
+    uint8_t read(int address) { return mem[address]; }
+    void write(int address, uint8_t value);
+    void update(int address, uint8_t value)
+    {
+        if (mem[address] != value)
+            write(address, value);
+    }
+    uint16_t length() { return SIZE; }
+
+    template <class T>
+    T &get(int address, T &value)
+    {
+        memcpy(&value, mem + address, sizeof(T));
+        return value;
+    }
+
+    template <class T>
+    const T &put(int address, const T &value)
+    {
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(&value);
+        for (size_t i = 0; i < sizeof(T); i++)
+            update(address + i, p[i]);
+        return value;
+    }
+
+    /** @brief Load the content from a file (erased EEPROM if missing) and keep it in sync */
+    void attach(const char *path);
+
+    /** @brief Raw content, bypassing the write hook (fault-injection soak) */
+    uint8_t *data() { return mem; }
+
+private:
+    uint8_t mem[SIZE];
+    int fd = -1;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // RFID_EMU_EEPROM_H
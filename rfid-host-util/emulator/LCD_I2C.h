@@ -0,0 +1,28 @@
+/**
+ * @file LCD_I2C.h
+ * @brief Emulated 16x2 I2C LCD: the text is discarded
+ * @author Dag
+ */
+
+#ifndef RFID_EMU_LCD_I2C_H
+#define RFID_EMU_LCD_I2C_H
+
+#include "Arduino.h"
+
+class LCD_I2C : public Print
+{
+public:
+    LCD_I2C(uint8_t, uint8_t, uint8_t) {}
+    void begin() {}
+    void backlight() {}
+    void noBacklight() {}
+    void home() {}
+    void clear() {}
+    void setCursor(uint8_t, uint8_t) {}
+    void autoscroll() {}
+    void noAutoscroll() {}
+    size_t write(uint8_t) override { return 1; }
+    using Print::write;
+};
+
+#endif // RFID_EMU_LCD_I2C_H
@@ -0,0 +1,143 @@
+/**
+ * @file MFRC522.h
+ * @brief Emulated MFRC522 reader with the API of https://github.com/miguelbalboa/rfid
+ * @details Only the subset used by rfid-box-writer. The card in the field is a
+ *          MIFARE Classic or NTAG213 model (mfrc522-emu.h), there is no register
+ *          level emulation.
+ * @author Dag
+ */
+
+#ifndef RFID_EMU_MFRC522_H
+#define RFID_EMU_MFRC522_H
+
+#include "Arduino.h"
+
+class MFRC522
+{
+public:
+    enum PCD_Register : byte
+    {
+        CommandReg = 0x01 << 1,
+        ComIEnReg = 0x02 << 1,
+        DivIEnReg = 0x03 << 1,
+        ComIrqReg = 0x04 << 1,
+        DivIrqReg = 0x05 << 1,
+        TModeReg = 0x2A << 1,
+        TReloadRegL = 0x2D << 1,
+        VersionReg = 0x37 << 1
+    };
+
+    enum PCD_Command : byte
+    {
+        PCD_Idle = 0x00,
+        PCD_SoftReset = 0x0F
+    };
+
+    enum PICC_Command : byte
+    {
+        PICC_CMD_REQA = 0x26,
+        PICC_CMD_WUPA = 0x52,
+        PICC_CMD_HLTA = 0x50,
+        PICC_CMD_MF_AUTH_KEY_A = 0x60,
+        PICC_CMD_MF_AUTH_KEY_B = 0x61,
+        PICC_CMD_MF_READ = 0x30,
+        PICC_CMD_MF_WRITE = 0xA0,
+        PICC_CMD_MF_DECREMENT = 0xC0,
+        PICC_CMD_MF_INCREMENT = 0xC1,
+        PICC_CMD_MF_RESTORE = 0xC2,
+        PICC_CMD_MF_TRANSFER = 0xB0,
+        PICC_CMD_UL_WRITE = 0xA2
+    };
+
+    enum MIFARE_Misc
+    {
+        MF_ACK = 0xA,
+        MF_KEY_SIZE = 6
+    };
+
+    enum PICC_Type : byte
+    {
+        PICC_TYPE_UNKNOWN,
+        PICC_TYPE_ISO_14443_4,
+        PICC_TYPE_ISO_18092,
+        PICC_TYPE_MIFARE_MINI,
+        PICC_TYPE_MIFARE_1K,
+        PICC_TYPE_MIFARE_4K,
+        PICC_TYPE_MIFARE_UL,
+        PICC_TYPE_MIFARE_PLUS,
+        PICC_TYPE_MIFARE_DESFIRE,
+        PICC_TYPE_TNP3XXX,
+        PICC_TYPE_NOT_COMPLETE = 0xff
+    };
+
+    enum StatusCode : byte
+    {
+        STATUS_OK,
+        STATUS_ERROR,
+        STATUS_COLLISION,
+        STATUS_TIMEOUT,
+        STATUS_NO_ROOM,
+        STATUS_INTERNAL_ERROR,
+        STATUS_INVALID,
+        STATUS_CRC_WRONG,
+        STATUS_MIFARE_NACK = 0xff
+    };
+
+    typedef struct
+    {
+        byte size;
+        byte uidByte[10];
+        byte sak;
+    } Uid;
+
+    typedef struct
+    {
+        byte keyByte[MF_KEY_SIZE];
+    } MIFARE_Key;
+
+    Uid uid;
+
+    MFRC522(byte chipSelectPin, byte resetPowerDownPin);
+    virtual ~MFRC522() {}
+
+    void PCD_Init();
+    void PCD_WriteRegister(PCD_Register reg, byte value);
+    byte PCD_ReadRegister(PCD_Register reg);
+    void PCD_AntennaOn();
+    void PCD_AntennaOff();
+    void PCD_SoftPowerDown();
+    void PCD_SoftPowerUp();
+    void PCD_StopCrypto1();
+    void PCD_DumpVersionToSerial();
+
+    StatusCode PCD_CalculateCRC(byte *data, byte length, byte *result);
+    StatusCode PCD_TransceiveData(byte *sendData, byte sendLen, byte *backData, byte *backLen,
+                                  byte *validBits = nullptr, byte rxAlign = 0, bool checkCRC = false);
+
+    StatusCode PICC_RequestA(byte *bufferATQA, byte *bufferSize);
+    StatusCode PICC_WakeupA(byte *bufferATQA, byte *bufferSize);
+    virtual StatusCode PICC_Select(Uid *uid, byte validBits = 0);
+    StatusCode PICC_HaltA();
+    virtual bool PICC_IsNewCardPresent();
+    virtual bool PICC_ReadCardSerial();
+
+    StatusCode PCD_Authenticate(byte command, byte blockAddr, MIFARE_Key *key, Uid *uid);
+    StatusCode MIFARE_Read(byte blockAddr, byte *buffer, byte *bufferSize);
+    StatusCode MIFARE_Write(byte blockAddr, byte *buffer, byte bufferSize);
+    StatusCode MIFARE_Ultralight_Write(byte page, byte *buffer, byte bufferSize);
+    StatusCode MIFARE_Decrement(byte blockAddr, int32_t delta);
+    StatusCode MIFARE_Increment(byte blockAddr, int32_t delta);
+    StatusCode MIFARE_Restore(byte blockAddr);
+    StatusCode MIFARE_Transfer(byte blockAddr);
+    StatusCode MIFARE_GetValue(byte blockAddr, int32_t *value);
+    StatusCode MIFARE_SetValue(byte blockAddr, int32_t value);
+    StatusCode PCD_NTAG216_AUTH(byte *passWord, byte pACK[]);
+    void MIFARE_SetAccessBits(byte *accessBitBuffer, byte g0, byte g1, byte g2, byte g3);
+
+    static const __FlashStringHelper *GetStatusCodeName(StatusCode code);
+    static PICC_Type PICC_GetType(byte sak);
+    static const __FlashStringHelper *PICC_GetTypeName(PICC_Type type);
+    void PICC_DumpToSerial(Uid *uid);
+};
+
+#endif // RFID_EMU_MFRC522_H
@@ -0,0 +1,18 @@
+/**
+ * @file SPI.h
+ * @brief Emulated SPI bus (the reader is emulated at the MFRC522 API level)
+ * @author Dag
+ */
+
+#ifndef RFID_EMU_SPI_H
+#define RFID_EMU_SPI_H
+
+class SPIClass
+{
+public:
+    void begin() {}
+};
+
+extern SPIClass SPI;
+
+#endif // RFID_EMU_SPI_H
@@ -0,0 +1,10 @@
+/**
+ * @file Wire.h
+ * @brief Emulated I2C bus (unused, the LCD is emulated at the LCD_I2C API level)
+ * @author Dag
+ */
+
+#ifndef RFID_EMU_WIRE_H
+#define RFID_EMU_WIRE_H
+
+#endif // RFID_EMU_WIRE_H
@@ -0,0 +1,902 @@
+/**
+ * @file box-emulator.cpp
+ * @brief Run the rfid-box-writer sketch on Linux, its serial port on a pseudo-terminal
+ * @details Arduino core for the emulated headers: virtual clock, GPIO (buttons never
+ *          pressed), EEPROM optionally backed by a file, Serial on the master side of a
+ *          pty. The slave path is printed on stdout ("PTY /dev/pts/N") and can be opened
+ *          by provisiond or any serial tool. Card polls advance the clock by their
+ *          modeled duration (25 ms on an empty field), as on the reader: idle loops and
+ *          the low-power statistics (power.h) keep their real proportions.
+ *
+ *          Cards: when the sketch has a host job armed, a blank MIFARE Classic card with
+ *          a new UID is put in the field, as an operator on the bench would do, and
+ *          removed once it has been halted. --tear-every N pulls every Nth card away
+ *          in the middle of the transaction.
+ *
+ *          Replay (--replay): runs a FRAME_TRACE frame recorded by the box ("trace"
+ *          command, rf-trace.h) against the emulated reader, without pty. The card
+ *          (--card: raw memory image, blank otherwise) is presented again after every
+ *          halt until the trace is used up; a recorded error makes the same command
+ *          fail again. The clock is virtual, RF commands advance it by their recorded
+ *          or modeled duration: the run is deterministic. Prints the outcome and exits
+ *          1 if the firmware left the recorded path or its RF time exceeds the recorded
+ *          one by more than --tolerance percent (default 10): a trace kept next to the
+ *          sketch is a timing fixture.
+ *
+ *          Soak (--soak N): N SET / WRITE operations, each one also run again with
+ *          a power cut before every EEPROM byte write and every RF command, and
+ *          with the card torn away before every RF command. After each fault the
+ *          box (rebooted from its EEPROM after a power cut) must hold the old or
+ *          the new secret, whole, and the interrupted card must validate or be
+ *          completed by presenting it again. Prints every corruption found and
+ *          the recovery figures; exits 1 if any.
+ *
+ *          Usage: box-emulator [--eeprom FILE] [--link PATH] [--sak 08|09|18|00]
+ *                              [--tear-every N] [--present-ms MS] [--id N]
+ *                 box-emulator --replay TRACE [--card IMAGE] [--uid HEX] [--sak ..]
+ *                              [--eeprom FILE] [--tolerance PCT]
+ *                 box-emulator --soak OPERATIONS [--seed N] [--sak ..]
+ * @author Dag
+ */
+
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "SPI.h"
+#include "mfrc522-emu.h"
+#include "audit-log.h"
+#include "config.h"
+#include "counters.h"
+#include "credential.h"
+#include "grant-cache.h"
+#include "host-job.h"
+#include "secrets.h"
+#include "def.h"
+#include "frame.h"
+#include "ultralight.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <memory>
+#include <vector>
+
+// Sketch entry points (rfid-box-writer.ino), job slot and state driven by the soak
+void setup();
+void loop();
+extern ProvisionJob hostJob;
+extern Mode MODE;
+extern Job JOB;
+extern unsigned long bootMicros;
+extern bool passphraseLost;
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+SPIClass SPI;
+
+namespace
+{
+
+int ptyMaster = -1;
+int ptySlave = -1;         // Kept open so the master never reads EIO between host sessions
+unsigned long virtualMs = 0; // Time spent in delay()
+int peeked = -1;           // Byte returned by peek()
+bool virtualClock = false; // Replay: time only advances with delay() and RF commands
+bool resetPressed = false; // Replay: operator acknowledging errors
+
+unsigned long long monotonicUs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+const unsigned long long startUs = monotonicUs();
+
+struct Options
+{
+    const char *eeprom = nullptr;
+    const char *link = nullptr;
+    byte sak = 0x08;
+    unsigned tearEvery = 0;
+    unsigned long presentMs = 300;
+    byte id = 0;
+    const char *replay = nullptr;
+    const char *card = nullptr;
+    const char *uid = nullptr;
+    unsigned tolerance = 10;
+    unsigned soak = 0;
+    unsigned seed = 1;
+};
+
+bool parseOptions(int argc, char **argv, Options *o)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+            return false;
+        const char *value = argv[++i];
+        if (arg == "--eeprom")
+            o->eeprom = value;
+        else if (arg == "--link")
+            o->link = value;
+        else if (arg == "--sak")
+            o->sak = strtoul(value, nullptr, 16);
+        else if (arg == "--tear-every")
+            o->tearEvery = strtoul(value, nullptr, 10);
+        else if (arg == "--present-ms")
+            o->presentMs = strtoul(value, nullptr, 10);
+        else if (arg == "--id")
+            o->id = strtoul(value, nullptr, 10);
+        else if (arg == "--replay")
+            o->replay = value;
+        else if (arg == "--card")
+            o->card = value;
+        else if (arg == "--uid")
+            o->uid = value;
+        else if (arg == "--tolerance")
+            o->tolerance = strtoul(value, nullptr, 10);
+        else if (arg == "--soak")
+            o->soak = strtoul(value, nullptr, 10);
+        else if (arg == "--seed")
+            o->seed = strtoul(value, nullptr, 10);
+        else
+            return false;
+    }
+    return true;
+}
+
+bool openPty(const char *link)
+{
+    ptyMaster = posix_openpt(O_RDWR | O_NOCTTY);
+    if (ptyMaster < 0 || grantpt(ptyMaster) != 0 || unlockpt(ptyMaster) != 0)
+        return false;
+
+    const char *slave = ptsname(ptyMaster);
+    ptySlave = open(slave, O_RDWR | O_NOCTTY);
+    if (ptySlave < 0)
+        return false;
+
+    termios tio;
+    tcgetattr(ptySlave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(ptySlave, TCSANOW, &tio);
+    fcntl(ptyMaster, F_SETFL, O_NONBLOCK);
+
+    if (link)
+    {
+        unlink(link);
+        if (symlink(slave, link) != 0)
+            return false;
+    }
+    printf("PTY %s\n", slave);
+    fflush(stdout);
+    return true;
+}
+
+/**
+ * @brief Bench operator: present a new card for the armed job, take away halted cards
+ */
+class CardFeeder
+{
+public:
+    explicit CardFeeder(const Options &options) : options(options) {}
+
+    void run()
+    {
+        emu::Card *field = emu::fieldCard();
+
+        if (card && (field != card.get() || card->halted))
+        {
+            fprintf(stderr, "card %u %s\n", count, field == card.get() ? "removed" : "torn away");
+            emu::presentCard(nullptr);
+            card.reset();
+            armedSince = 0;
+        }
+
+        if (card || !hostJob.armed)
+            return;
+        if (armedSince == 0)
+            armedSince = millis() | 1;
+        if (millis() - armedSince < options.presentMs)
+            return;
+
+        count++;
+        byte uid[4] = {0xE0, options.id, static_cast<byte>(count >> 8), static_cast<byte>(count)};
+        card.reset(new emu::Card(uid, sizeof(uid), options.sak));
+        emu::presentCard(card.get());
+        if (options.tearEvery && count % options.tearEvery == 0)
+            emu::tearAfter(5 + rand() % 60);
+        fprintf(stderr, "card %u presented, UID %02X%02X%02X%02X\n", count, uid[0], uid[1], uid[2], uid[3]);
+    }
+
+private:
+    const Options &options;
+    std::unique_ptr<emu::Card> card;
+    unsigned count = 0;
+    unsigned long armedSince = 0;
+};
+
+// ============================================================================
+// TRACE REPLAY
+// ============================================================================
+
+/**
+ * @brief Records of the first valid FRAME_TRACE frame of a file
+ * @details Anything around the frame (serial text of the session) is skipped.
+ */
+bool loadTrace(const char *path, std::vector<TraceRecord> *records)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+    std::vector<byte> data;
+    int c;
+    while ((c = fgetc(f)) != EOF)
+        data.push_back(c);
+    fclose(f);
+
+    for (size_t i = 0; i + 6 <= data.size(); i++)
+    {
+        if (data[i] != FRAME_SOF || data[i + 1] != FRAME_TRACE)
+            continue;
+        size_t length = data[i + 2] | data[i + 3] << 8;
+        if (length % sizeof(TraceRecord) != 0 || i + 6 + length > data.size())
+            continue;
+
+        uint16_t crc = 0xFFFF;
+        for (size_t j = 1; j < 4 + length; j++)
+            crc = crc16Update(crc, data[i + j]);
+        const byte *tail = &data[i + 4 + length];
+        if ((tail[0] | tail[1] << 8) != crc)
+            continue;
+
+        for (const byte *r = &data[i + 4]; r < tail; r += sizeof(TraceRecord))
+            records->push_back(TraceRecord{r[0], r[1], r[2], r[3], static_cast<uint16_t>(r[4] | r[5] << 8)});
+        return true;
+    }
+    return false;
+}
+
+/** @brief Card of the replay: memory image or blank, UID from --uid or the image */
+emu::Card *loadCard(const Options &o, byte uidSize)
+{
+    byte image[sizeof(emu::Card::memory)] = {0};
+    size_t imageSize = 0;
+    if (o.card)
+    {
+        FILE *f = fopen(o.card, "rb");
+        if (!f)
+            return nullptr;
+        imageSize = fread(image, 1, sizeof(image), f);
+        fclose(f);
+    }
+
+    byte uid[10] = {0xE0, 0x00, 0x00, 0x01};
+    if (o.uid)
+    {
+        uidSize = 0;
+        for (const char *p = o.uid; p[0] && p[1] && uidSize < sizeof(uid); p += 2)
+        {
+            char hex[3] = {p[0], p[1], 0};
+            uid[uidSize++] = strtoul(hex, nullptr, 16);
+        }
+    }
+    else if (imageSize >= uidSize)
+        memcpy(uid, image, uidSize); // Manufacturer block / UID pages
+    else
+        uidSize = 4;
+
+    emu::Card *card = new emu::Card(uid, uidSize, o.sak);
+    if (imageSize)
+        memcpy(card->memory, image, imageSize);
+    return card;
+}
+
+/**
+ * @brief Replay a recorded trace and compare the RF time
+ * @return Exit status: 0 replayed within tolerance, 1 diverged or slower, 2 bad input
+ */
+int runReplay(const Options &options)
+{
+    std::vector<TraceRecord> records;
+    if (!loadTrace(options.replay, &records))
+    {
+        fprintf(stderr, "%s: no valid trace frame\n", options.replay);
+        return 2;
+    }
+
+    // The ring may start in the middle of a session: replay from the first select
+    size_t first = 0;
+    while (first < records.size() && records[first].op != TRACE_OP_SELECT)
+        first++;
+    if (first == records.size())
+    {
+        fprintf(stderr, "%s: no card select in the trace\n", options.replay);
+        return 2;
+    }
+    records.erase(records.begin(), records.begin() + first);
+
+    unsigned long recordedUs = 0;
+    for (const TraceRecord &r : records)
+        recordedUs += r.micros;
+
+    std::unique_ptr<emu::Card> card(loadCard(options, records[0].arg));
+    if (!card)
+    {
+        perror(options.card);
+        return 2;
+    }
+
+    virtualClock = true;
+    EEPROM.attach(options.eeprom);
+    setup();
+
+    unsigned long startUs = emu::rfMicros();
+    emu::replay(records.data(), records.size());
+    for (int i = 0; i < 1000 && emu::replaying(); i++)
+    {
+        if (emu::fieldCard() != card.get() || card->halted)
+        {
+            card->halted = false; // Next tap of the same card
+            emu::presentCard(card.get());
+        }
+        loop(); // Runs a whole card session: ends after the session that used up the trace
+        virtualMs++;
+    }
+    emu::presentCard(nullptr);
+
+    const emu::ReplayStats &stats = emu::replayStats();
+    unsigned long replayedUs = emu::rfMicros() - startUs;
+    bool diverged = stats.diverged >= 0 || stats.matched < static_cast<int>(records.size());
+    bool slower = replayedUs * 100 > recordedUs * (100UL + options.tolerance);
+
+    fprintf(stderr, "records %u, matched %d", static_cast<unsigned>(records.size()), stats.matched);
+    if (diverged)
+    {
+        const TraceRecord &r = records[stats.matched];
+        fprintf(stderr, ", diverged at record %d (op %02X arg %u)", stats.matched, r.op, r.arg);
+    }
+    fprintf(stderr, ", read mismatches %d\n", stats.checkMismatches);
+    fprintf(stderr, "RF time recorded %lu us, replayed %lu us (%+ld%%)\n", recordedUs, replayedUs,
+            recordedUs ? (static_cast<long>(replayedUs) - static_cast<long>(recordedUs)) * 100 / static_cast<long>(recordedUs) : 0L);
+    return diverged || slower ? 1 : 0;
+}
+
+// ============================================================================
+// FAULT INJECTION SOAK
+// ============================================================================
+
+/**
+ * @brief Where the fault of an injection run strikes
+ */
+enum Fault
+{
+    FAULT_NONE,       // Uninterrupted operation: counts the boundaries
+    FAULT_EEPROM_CUT, // Power lost before the (k+1)th EEPROM byte write
+    FAULT_RF_CUT,     // Power lost before the (k+1)th RF command
+    FAULT_TEAR,       // Card pulled away before the (k+1)th RF command
+    FAULT_COUNT
+};
+
+const char *const FAULT_NAMES[FAULT_COUNT] = {"no fault", "power cut before EEPROM write", "power cut before RF command",
+                                              "card torn before RF command"};
+
+/**
+ * @brief SET (master card with a new passphrase) or WRITE (blank card programmed)
+ */
+struct SoakOperation
+{
+    bool set;
+    std::string oldSecret; // Passphrase of the box before the operation
+    std::string newSecret; // SET: passphrase of the master card
+    unsigned index;        // Operation number: UID of its card
+    unsigned fleetIndex;   // Last card written by a WRITE operation, 0 if none yet
+    std::vector<byte> fleetCard; // Its memory: a card of the old secret for SET
+};
+
+/**
+ * @brief State handed from the box processes of an injection to the harness (MAP_SHARED)
+ */
+struct SoakShared
+{
+    byte eeprom[EEPROMClass::SIZE];       // EEPROM when the power failed or the operation ended
+    byte card[sizeof(emu::Card::memory)]; // Card memory at the same moment
+    long eepromWrites;                    // Boundaries crossed by the operation
+    long rfOperations;
+    bool cut;                             // The power failed during the operation
+    bool reported;                        // The box reported the card written before the fault
+    byte auditRecords;                    // Valid audit records before the operation
+    bool tornAccepted;                    // The interrupted card validated before any retry
+    unsigned retries;                     // Taps needed to complete an interrupted card or SET
+    unsigned long recoveryUs;             // Reset to ready, plus the RF time of the retries
+    char problem[120];                    // Corruption found, empty if the box recovered
+};
+
+const unsigned SOAK_MAX_RETRIES = 3;     // Taps allowed to complete an interrupted card
+const unsigned SOAK_CHILD_TIMEOUT_S = 20; // A box process running longer is hung
+
+SoakShared *shared = nullptr;
+long eepromWrites = 0;         // EEPROM byte writes since the operation started
+long eepromCutAt = -1;         // eepromWrites value at which the power fails
+emu::Card *soakCard = nullptr; // Card of the operation, saved on a power cut
+uint32_t writtenBefore = 0;    // CNT_WRITE_SUCCESSES when the operation started
+
+/** @brief Power lost: keep what the EEPROM and the card hold, the box process ends */
+void powerCut()
+{
+    memcpy(shared->eeprom, EEPROM.data(), sizeof(shared->eeprom));
+    memcpy(shared->card, soakCard->memory, sizeof(shared->card));
+    shared->cut = true;
+    shared->reported = counterValue(CNT_WRITE_SUCCESSES) > writtenBefore;
+    _exit(0);
+}
+
+/** @brief Idle for 5 s of empty-field polls: splash, audit log and counters written in background */
+void settle()
+{
+    for (int i = 0; i < 200; i++)
+        loop();
+}
+
+/** @brief One tap: the card stays until halted or torn away, then the box settles */
+void tap(emu::Card *card)
+{
+    resetPressed = false; // Held RESET at detection would dump the card instead
+    card->halted = false;
+    emu::presentCard(card);
+    for (int i = 0; i < 10 && emu::fieldCard() == card && !card->halted; i++)
+        loop();
+    emu::presentCard(nullptr);
+    settle();
+}
+
+/** @brief Reset: the sketch starts from an EEPROM image */
+void boot(const byte *eeprom)
+{
+    virtualClock = true;
+    EEPROM.attach(nullptr);
+    memcpy(EEPROM.data(), eeprom, EEPROMClass::SIZE);
+    setup();
+    settle();
+}
+
+/** @brief The box grants access to the card (READ / RUN, grant cache bypassed) */
+bool validates(emu::Card *card)
+{
+    MODE = MODE_READ;
+    JOB = RUN;
+    grantCacheClear();
+    uint32_t grants = counterValue(CNT_GRANTS);
+    tap(card);
+    return counterValue(CNT_GRANTS) > grants;
+}
+
+/** @brief Master card: passphrase in clear in the data blocks, transport keys */
+emu::Card *masterCard(const std::string &passphrase, unsigned index)
+{
+    byte uid[4] = {0xE1, 0x5A, static_cast<byte>(index >> 8), static_cast<byte>(index)};
+    emu::Card *card = new emu::Card(uid, sizeof(uid), 0x08);
+    for (size_t i = 0; i < passphrase.size(); i++)
+        card->memory[blocks[i / 16] * 16 + i % 16] = passphrase[i];
+    return card;
+}
+
+/** @brief Card of a WRITE operation: blank, or as an operation left it */
+emu::Card *issuedCard(unsigned index, byte sak, const byte *memory)
+{
+    byte uid[4] = {0xE0, 0x5A, static_cast<byte>(index >> 8), static_cast<byte>(index)};
+    emu::Card *card = new emu::Card(uid, sizeof(uid), sak);
+    if (memory)
+        memcpy(card->memory, memory, sizeof(card->memory));
+    return card;
+}
+
+/**
+ * @brief Check the credential stores: the box holds the old or the new secret, whole
+ * @return Corruption found, empty if none
+ */
+std::string checkStores(const SoakOperation &op, bool *isNew)
+{
+    *isNew = false;
+    byte stored[MAC_KEY_SIZE];
+    byte expected[MAC_KEY_SIZE];
+    if (!loadMacKeyFromEEPROM(stored))
+        return "device key missing";
+
+    deriveMacKey(String(op.newSecret.c_str()), expected);
+    *isNew = op.set && memcmp(stored, expected, MAC_KEY_SIZE) == 0;
+    deriveMacKey(String(op.oldSecret.c_str()), expected);
+    if (!*isNew && memcmp(stored, expected, MAC_KEY_SIZE) != 0)
+        return "device key is neither the old nor the new secret";
+
+    if (KEEP_PASSPHRASE && !passphraseLost)
+    {
+        String passphrase;
+        loadPayloadFromEEPROM(&passphrase);
+        if (passphrase != String((*isNew ? op.newSecret : op.oldSecret).c_str()))
+            return "stored passphrase differs from the device key";
+    }
+
+    byte version = EEPROM.read(EEPROM_SECRET_RING_ADDR);
+    if (static_cast<byte>(~EEPROM.read(EEPROM_SECRET_RING_ADDR + 1)) != version)
+        return "secret ring header corrupt";
+    return "";
+}
+
+/**
+ * @brief Check the box after the operation or the fault, complete an interrupted card
+ * @details Runs in the box process: after the operation (no fault, card tear) or after
+ *          the reboot that follows a power cut.
+ */
+std::string recover(const SoakOperation &op, Fault fault, byte sak)
+{
+    bool isNew;
+    std::string problem = checkStores(op, &isNew);
+    if (!problem.empty())
+        return problem;
+    if (fault == FAULT_NONE && op.set && !isNew)
+        return "SET without fault did not store the new secret";
+    if (auditLogCount() + 1 < shared->auditRecords)
+        return "audit log lost more than the record being written";
+
+    if (passphraseLost)
+    {
+        // Passphrase torn after the key was stored: no card written until SET again
+        std::unique_ptr<emu::Card> blank(issuedCard(op.index, sak, nullptr));
+        uint32_t written = counterValue(CNT_WRITE_SUCCESSES);
+        MODE = MODE_WRITE;
+        JOB = RUN;
+        tap(blank.get());
+        if (counterValue(CNT_WRITE_SUCCESSES) != written)
+            return "card written without a valid passphrase";
+
+        std::unique_ptr<emu::Card> master(masterCard(op.newSecret, op.index));
+        unsigned long rfStart = emu::rfMicros();
+        MODE = MODE_READ;
+        JOB = SET;
+        tap(master.get());
+        shared->retries++;
+        shared->recoveryUs += emu::rfMicros() - rfStart;
+        problem = checkStores(op, &isNew);
+        if (!problem.empty())
+            return problem;
+        if (passphraseLost || !isNew)
+            return "passphrase still lost after SET again";
+    }
+
+    if (op.set)
+    {
+        // A card written before the SET, or the previous master card (untagged passphrase)
+        std::unique_ptr<emu::Card> old;
+        if (op.fleetIndex)
+            old.reset(issuedCard(op.fleetIndex, sak, op.fleetCard.data()));
+        else if (CREDENTIAL_MODE == CREDENTIAL_PASSPHRASE && !op.oldSecret.empty())
+            old.reset(masterCard(op.oldSecret, op.index - 1));
+        return !old || validates(old.get()) ? "" : "cards of the old secret rejected";
+    }
+
+    std::unique_ptr<emu::Card> card(issuedCard(op.index, sak, shared->card));
+    if (fault == FAULT_NONE && !shared->reported)
+        return "WRITE without fault not reported";
+
+    // The card of an interrupted operation may be rejected, never left for good
+    shared->tornAccepted = validates(card.get());
+    if (shared->reported && !shared->tornAccepted)
+        return "card reported written but rejected";
+
+    unsigned long rfStart = emu::rfMicros();
+    bool valid = shared->tornAccepted;
+    while (!valid && shared->retries < SOAK_MAX_RETRIES)
+    {
+        MODE = MODE_WRITE;
+        JOB = RUN;
+        tap(card.get());
+        shared->retries++;
+        valid = validates(card.get());
+    }
+    shared->recoveryUs += emu::rfMicros() - rfStart;
+    return valid ? "" : "card still rejected after " + std::to_string(SOAK_MAX_RETRIES) + " retries";
+}
+
+/**
+ * @brief Run one injection in fresh box processes
+ * @details The harness never runs the sketch itself: each box process is forked
+ *          from it, so every boot starts from the initial globals. The operation
+ *          runs in one process; after a power cut a second one boots from the
+ *          EEPROM it left and recovers.
+ * @return false if a box process crashed or hung (shared->problem set)
+ */
+bool inject(const std::vector<byte> &state, const SoakOperation &op, Fault fault, long k, byte sak)
+{
+    memset(shared, 0, sizeof(*shared));
+    memcpy(shared->eeprom, state.data(), state.size());
+
+    for (int stage = 0; stage < 2; stage++)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            alarm(SOAK_CHILD_TIMEOUT_S);
+            boot(shared->eeprom);
+            if (stage == 0)
+            {
+                std::unique_ptr<emu::Card> card(op.set ? masterCard(op.newSecret, op.index) : issuedCard(op.index, sak, nullptr));
+                soakCard = card.get();
+                shared->auditRecords = auditLogCount();
+                writtenBefore = counterValue(CNT_WRITE_SUCCESSES);
+                long rfStart = emu::rfOperations();
+                eepromWrites = 0;
+                if (fault == FAULT_EEPROM_CUT)
+                    eepromCutAt = k;
+                else if (fault == FAULT_RF_CUT)
+                    emu::cutAfter(k, powerCut);
+                else if (fault == FAULT_TEAR)
+                    emu::tearAfter(k);
+
+                MODE = op.set ? MODE_READ : MODE_WRITE;
+                JOB = op.set ? SET : RUN;
+                tap(soakCard);
+                eepromCutAt = -1;
+                emu::cutAfter(-1, nullptr);
+
+                shared->eepromWrites = eepromWrites;
+                shared->rfOperations = emu::rfOperations() - rfStart;
+                shared->reported = counterValue(CNT_WRITE_SUCCESSES) > writtenBefore;
+                memcpy(shared->card, soakCard->memory, sizeof(shared->card));
+            }
+            else
+                shared->recoveryUs = bootMicros;
+
+            std::string problem = recover(op, fault, sak);
+            snprintf(shared->problem, sizeof(shared->problem), "%s", problem.c_str());
+            memcpy(shared->eeprom, EEPROM.data(), sizeof(shared->eeprom));
+            _exit(0);
+        }
+
+        int status;
+        if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            snprintf(shared->problem, sizeof(shared->problem), "box process %s",
+                     pid > 0 && WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM ? "hung" : "crashed");
+            return false;
+        }
+        if (!shared->cut)
+            return true; // Ended without power loss: checked in the same process
+        shared->cut = false;
+    }
+    return true;
+}
+
+/** @brief Random printable passphrase, 8 to 40 characters (1 to 3 blocks) */
+std::string randomPassphrase()
+{
+    std::string passphrase(8 + rand() % 33, ' ');
+    for (char &c : passphrase)
+        c = '!' + rand() % ('~' - '!' + 1);
+    return passphrase;
+}
+
+/**
+ * @brief Soak: every operation interrupted at every boundary, each outcome checked
+ * @return Exit status: 0 no corruption, 1 corruption found, 2 setup error
+ */
+int runSoak(const Options &options)
+{
+    shared = static_cast<SoakShared *>(mmap(nullptr, sizeof(SoakShared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    if (shared == MAP_FAILED)
+    {
+        perror("mmap");
+        return 2;
+    }
+    srand(options.seed);
+    if (isUltralight(options.sak) && CREDENTIAL_MODE == CREDENTIAL_PASSPHRASE)
+    {
+        fprintf(stderr, "Ultralight / NTAG tags are refused with CREDENTIAL_PASSPHRASE (config.h)\n");
+        return 2;
+    }
+
+    std::vector<byte> state(EEPROMClass::SIZE, 0xFF); // Erased EEPROM: the first boot installs the build secret, if secrets.h has one
+    SoakOperation op = {true, FACTORY_PASSPHRASE, "", 0, 0, {}};
+    unsigned long injections[FAULT_COUNT] = {0};
+    unsigned long corrupted = 0, tornAccepted = 0, retried = 0, retries = 0, maxRetries = 0;
+    unsigned long long recoveryUs = 0;
+    unsigned long maxRecoveryUs = 0, recoveries = 0;
+
+    for (unsigned i = 0; i < options.soak; i++)
+    {
+        op.index = i + 1;
+        op.set = !BoxRole::CAN_WRITE || i % 2 == 0;
+        if (op.set)
+            op.newSecret = randomPassphrase();
+
+        if (!inject(state, op, FAULT_NONE, 0, options.sak) || shared->problem[0])
+        {
+            fprintf(stderr, "op %u %s, %s: %s\n", op.index, op.set ? "SET" : "WRITE", FAULT_NAMES[FAULT_NONE], shared->problem);
+            return 1; // Nothing to inject into: the operation itself fails
+        }
+        std::vector<byte> next(shared->eeprom, shared->eeprom + sizeof(shared->eeprom));
+        std::vector<byte> written(shared->card, shared->card + sizeof(shared->card));
+        long boundaries[FAULT_COUNT] = {0, shared->eepromWrites, shared->rfOperations, shared->rfOperations};
+
+        for (int fault = FAULT_EEPROM_CUT; fault < FAULT_COUNT; fault++)
+            for (long k = 0; k < boundaries[fault]; k++)
+            {
+                injections[fault]++;
+                if (!inject(state, op, static_cast<Fault>(fault), k, options.sak) || shared->problem[0])
+                {
+                    corrupted++;
+                    fprintf(stderr, "op %u %s, %s %ld: %s\n", op.index, op.set ? "SET" : "WRITE", FAULT_NAMES[fault], k + 1, shared->problem);
+                    continue;
+                }
+                tornAccepted += shared->tornAccepted;
+                retried += shared->retries > 0;
+                retries += shared->retries;
+                maxRetries = std::max<unsigned long>(maxRetries, shared->retries);
+                recoveries++;
+                recoveryUs += shared->recoveryUs;
+                maxRecoveryUs = std::max(maxRecoveryUs, shared->recoveryUs);
+            }
+
+        state = next;
+        if (op.set)
+            op.oldSecret = op.newSecret;
+        else
+        {
+            op.fleetIndex = op.index;
+            op.fleetCard = written;
+        }
+        if ((i + 1) % 10 == 0)
+            fprintf(stderr, "%u/%u operations, %lu corrupted\n", i + 1, options.soak, corrupted);
+    }
+
+    unsigned long total = injections[FAULT_EEPROM_CUT] + injections[FAULT_RF_CUT] + injections[FAULT_TEAR];
+    fprintf(stderr, "operations %u, injections %lu (EEPROM cuts %lu, RF cuts %lu, tears %lu), corrupted %lu\n", options.soak,
+            total, injections[FAULT_EEPROM_CUT], injections[FAULT_RF_CUT], injections[FAULT_TEAR], corrupted);
+    if (recoveries)
+        fprintf(stderr, "recovered %lu: %lu interrupted cards valid as left, %lu retried (avg %.2f, max %lu taps), "
+                        "recovery avg %llu us max %lu us\n",
+                recoveries, tornAccepted, retried, retried ? static_cast<double>(retries) / retried : 0.0, maxRetries,
+                recoveryUs / recoveries, maxRecoveryUs);
+    return corrupted ? 1 : 0;
+}
+
+} // namespace
+
+// ============================================================================
+// ARDUINO CORE
+// ============================================================================
+
+unsigned long micros()
+{
+    if (virtualClock)
+        return virtualMs * 1000UL + emu::rfMicros() + emu::pollMicros();
+    return static_cast<unsigned long>(monotonicUs() - startUs) + virtualMs * 1000UL + emu::pollMicros();
+}
+
+unsigned long millis()
+{
+    return micros() / 1000;
+}
+
+void delay(unsigned long ms)
+{
+    virtualMs += ms; // Feedback pauses do not slow the emulation down
+    if (virtualClock)
+        resetPressed = ms == 100 && !resetPressed; // Press and release while an error waits for reset
+}
+
+void delayMicroseconds(unsigned int) {}
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+
+int digitalRead(uint8_t pin)
+{
+    if (pin == BTN_RESET_PIN && resetPressed)
+        return LOW;
+    return HIGH; // Buttons use the internal pull-up: never pressed
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    // No host reading: the byte is lost, like USB CDC with the port closed
+    return ::write(ptyMaster, &c, 1) == 1 ? 1 : 0;
+}
+
+int HardwareSerial::available()
+{
+    if (peek() < 0)
+        return 0;
+    return 1;
+}
+
+int HardwareSerial::read()
+{
+    int c = peek();
+    peeked = -1;
+    return c;
+}
+
+int HardwareSerial::peek()
+{
+    byte c;
+    if (peeked < 0 && ::read(ptyMaster, &c, 1) == 1)
+        peeked = c;
+    return peeked;
+}
+
+void EEPROMClass::attach(const char *path)
+{
+    memset(mem, 0xFF, sizeof(mem)); // Erased EEPROM
+    if (!path)
+        return;
+
+    fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        return;
+    if (pread(fd, mem, sizeof(mem), 0) != static_cast<ssize_t>(sizeof(mem)))
+    {
+        memset(mem, 0xFF, sizeof(mem));
+        if (pwrite(fd, mem, sizeof(mem), 0) != static_cast<ssize_t>(sizeof(mem)))
+            perror(path);
+    }
+}
+
+void EEPROMClass::write(int address, uint8_t value)
+{
+    if (eepromCutAt >= 0 && eepromWrites == eepromCutAt)
+        powerCut(); // Soak: the byte is never written
+    eepromWrites++;
+    mem[address] = value;
+    if (fd >= 0 && pwrite(fd, &value, 1, address) != 1)
+        perror("eeprom");
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, &options))
+    {
+        fprintf(stderr, "usage: %s [--eeprom FILE] [--link PATH] [--sak 08|09|18|00] [--tear-every N] [--present-ms MS] [--id N]\n"
+                        "       %s --replay TRACE [--card IMAGE] [--uid HEX] [--sak ..] [--eeprom FILE] [--tolerance PCT]\n"
+                        "       %s --soak OPERATIONS [--seed N] [--sak ..]\n",
+                argv[0], argv[0], argv[0]);
+        return 2;
+    }
+    if (options.replay)
+        return runReplay(options);
+    if (options.soak)
+        return runSoak(options);
+    if (!openPty(options.link))
+    {
+        perror("pty");
+        return 1;
+    }
+    EEPROM.attach(options.eeprom);
+    srand(options.id + 1);
+
+    CardFeeder feeder(options);
+    setup();
+    for (;;)
+    {
+        loop();
+        feeder.run();
+
+        if (!emu::fieldCard() && peeked < 0)
+        {
+            pollfd p = {ptyMaster, POLLIN, 0};
+            poll(&p, 1, 1); // Idle: wait for the host instead of spinning
+        }
+    }
+}
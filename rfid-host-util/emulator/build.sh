@@ -0,0 +1,12 @@
+#!/bin/sh
+# Build the emulated RFID Box (writer profile) into rfid-host-util/emulator/box-emulator
+# Usage: rfid-host-util/emulator/build.sh [extra g++ flags, e.g. -DRFID_BOX_READER]
+set -e
+EMU=$(cd "$(dirname "$0")" && pwd)
+SKETCH=$EMU/../../rfid-box-writer
+OUT=${OUT:-$EMU/box-emulator}
+
+python3 "$EMU/sketch-prototypes.py" "$SKETCH/rfid-box-writer.ino" > "$OUT-sketch.cpp"
+g++ -std=gnu++11 -O1 -g -Wall -Wno-sign-compare -I"$EMU" -I"$SKETCH" "$@" \
+    -o "$OUT" "$OUT-sketch.cpp" "$SKETCH"/*.cpp "$EMU"/box-emulator.cpp "$EMU"/mfrc522-emu.cpp
+rm -f "$OUT-sketch.cpp"
@@ -0,0 +1,675 @@
+/**
+ * @file mfrc522-emu.cpp
+ * @brief Emulated MFRC522 reader, MIFARE Classic and NTAG213 card models
+ * @author Dag
+ */
+
+#include "mfrc522-emu.h"
+
+namespace emu
+{
+
+static Card *field = nullptr; // Card in the field
+static bool selected = false; // Card selected (not halted, not deselected by an error)
+static int authTrailer = -1;  // Trailer of the authenticated sector, -1 if none
+static bool authKeyB = false; // The sector was authenticated with Key B
+static long operations = 0;   // RF operations since start
+static long tearAt = -1;      // operations value at which the card is removed
+static long cutAt = -1;       // operations value at which the power fails
+static void (*cutHandler)() = nullptr;
+static bool pwdAuth = false;  // NTAG: PWD_AUTH accepted since the card was selected
+static unsigned long modeledUs = 0; // Modeled RF time
+static unsigned long pollUs = 0;    // Modeled time of the card polls
+
+static const TraceRecord *script = nullptr; // Trace being replayed
+static int scriptLength = 0;
+static int position = 0;                    // Next record to match
+static const TraceRecord *matchedRead = nullptr; // Successful read record just matched
+static ReplayStats stats = {0, -1, 0, 0};
+
+Card::Card(const byte *id, byte uidSize, byte sak)
+{
+    uid.size = uidSize;
+    memcpy(uid.uidByte, id, uidSize);
+    uid.sak = sak;
+    blocks = sak == 0x00 ? 0 : sak == 0x09 ? 20 : sak == 0x18 ? 256 : 64;
+    pages = sak == 0x00 ? 45 : 0;
+    halted = false;
+
+    if (pages)
+    {
+        static const byte config[16] = {0x04, 0x00, 0x00, 0xFF, 0x00, 0x05, 0x00, 0x00,
+                                        0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00};
+        static const byte cc[4] = {0xE1, 0x10, 0x12, 0x00};
+        memset(memory, 0, sizeof(memory));
+        memcpy(memory, id, uidSize < 7 ? uidSize : 7); // Pages 0-2: UID and check bytes
+        memcpy(memory + 3 * 4, cc, 4);
+        memcpy(memory + NTAG_CONFIG_PAGE * 4, config, 16);
+        return;
+    }
+
+    static const byte transportTrailer[16] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0x80, 0x69,
+                                              0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    memset(memory, 0, sizeof(memory));
+    memcpy(memory, id, uidSize); // Manufacturer block
+    for (int b = 0; b < blocks; b++)
+        if (isTrailer(b))
+            memcpy(memory + b * 16, transportTrailer, 16);
+}
+
+void presentCard(Card *card)
+{
+    field = card;
+    selected = false;
+    authTrailer = -1;
+    pwdAuth = false;
+    if (card)
+        card->halted = false;
+}
+
+Card *fieldCard()
+{
+    return field;
+}
+
+void tearAfter(long count)
+{
+    tearAt = count < 0 ? -1 : operations + count;
+}
+
+void cutAfter(long count, void (*cut)())
+{
+    cutAt = count < 0 ? -1 : operations + count;
+    cutHandler = cut;
+}
+
+long rfOperations()
+{
+    return operations;
+}
+
+unsigned long rfMicros()
+{
+    return modeledUs;
+}
+
+unsigned long pollMicros()
+{
+    return pollUs;
+}
+
+void replay(const TraceRecord *records, int count)
+{
+    script = records;
+    scriptLength = count;
+    position = 0;
+    stats = {0, -1, 0, 0};
+}
+
+bool replaying()
+{
+    return script && position < scriptLength;
+}
+
+const ReplayStats &replayStats()
+{
+    return stats;
+}
+
+/** @brief Typical duration of a command (estimate, Uno + MFRC522 at 106 kbit/s) */
+static unsigned long typicalMicros(byte op)
+{
+    switch (op)
+    {
+    case TRACE_OP_SELECT:
+        return 3000; // Anticollision and select
+    case TRACE_OP_WAKEUP:
+    case TRACE_OP_HALT:
+        return 800;
+    case TRACE_OP_AUTH_A:
+    case TRACE_OP_AUTH_B:
+        return 2500;
+    case TRACE_OP_WRITE:
+    case TRACE_OP_UL_WRITE:
+        return 6000; // Two frames, then the EEPROM write of the card
+    case TRACE_OP_DECREMENT:
+    case TRACE_OP_INCREMENT:
+    case TRACE_OP_RESTORE:
+    case TRACE_OP_TRANSFER:
+        return 3500;
+    default:
+        return 1500; // Read, PWD_AUTH, GET_VERSION
+    }
+}
+
+/**
+ * @brief Account for one command and match it with the trace being replayed
+ * @return true if the command must fail with *status (recorded error)
+ */
+static bool replayed(byte op, byte arg, MFRC522::StatusCode *status)
+{
+    matchedRead = nullptr;
+    if (!replaying())
+    {
+        modeledUs += typicalMicros(op);
+        return false;
+    }
+
+    const TraceRecord &r = script[position];
+    if (r.op != op || r.arg != arg)
+    {
+        stats.diverged = position; // The firmware took another path: the model answers alone
+        script = nullptr;
+        modeledUs += typicalMicros(op);
+        return false;
+    }
+
+    position++;
+    stats.matched++;
+    stats.recordedMicros += r.micros;
+    modeledUs += r.micros;
+    if (r.status == MFRC522::STATUS_OK)
+    {
+        matchedRead = op == TRACE_OP_READ ? &r : nullptr;
+        return false;
+    }
+
+    // Recorded failure: the card drops out of the selected state, as after a real error
+    selected = false;
+    authTrailer = -1;
+    pwdAuth = false;
+    *status = static_cast<MFRC522::StatusCode>(r.status);
+    return true;
+}
+
+/** @brief Compare the data of a replayed read with the recorded checksum */
+static void checkRead(const byte *data)
+{
+    byte check = 0;
+    for (int i = 0; i < 16; i++)
+        check ^= data[i];
+    if (matchedRead && matchedRead->check != check)
+        stats.checkMismatches++;
+}
+
+/** @brief Count one RF operation; false if there is no card (or it was just torn away) */
+static bool live()
+{
+    if (field && cutAt >= 0 && operations >= cutAt)
+    {
+        cutAt = -1;
+        cutHandler();
+    }
+    if (field && tearAt >= 0 && operations >= tearAt)
+    {
+        field = nullptr;
+        tearAt = -1;
+    }
+    if (!field)
+        return false;
+    operations++;
+    return true;
+}
+
+/** @brief NTAG: the page can be accessed, write access or read access */
+static bool pageAccessible(byte page, bool write)
+{
+    if (!live() || !selected)
+        return false;
+
+    const byte *config = field->memory + Card::NTAG_CONFIG_PAGE * 4;
+    bool guarded = page >= config[3] && (write || (config[4] & 0x80));
+    if (page >= field->pages || (guarded && !pwdAuth))
+    {
+        selected = false; // NAK: the tag goes idle
+        return false;
+    }
+    return true;
+}
+
+/** @brief The block can be accessed: card selected and its sector authenticated */
+static bool accessible(byte block)
+{
+    if (!live() || !selected || block >= field->blocks || authTrailer != Card::trailerOf(block))
+    {
+        selected = false;
+        authTrailer = -1;
+        return false;
+    }
+    return true;
+}
+
+/** @brief Operations gated by the Classic access conditions */
+enum Access : byte
+{
+    ACCESS_READ = 0,
+    ACCESS_WRITE = 1,
+    ACCESS_INCREMENT = 2,
+    ACCESS_DECREMENT = 3 // Also restore and transfer
+};
+
+// Data blocks: bit (Access * 2 + Key B) set when the condition C1 C2 C3 allows it
+static const byte DATA_ACCESS[8] = {0xFF, 0xC3, 0x03, 0x0A, 0x0B, 0x02, 0xEB, 0x00};
+
+/** @brief Access condition C1 C2 C3 of a block, from its sector trailer */
+static byte accessCondition(int block)
+{
+    int trailer = Card::trailerOf(block);
+    int group = block == trailer ? 3 : block < 128 ? block % 4 : (block - 128) % 16 / 5;
+    const byte *bits = field->memory + trailer * 16 + 6;
+    return ((bits[1] >> (4 + group)) & 1) << 2 | ((bits[2] >> group) & 1) << 1 | ((bits[2] >> (4 + group)) & 1);
+}
+
+/**
+ * @brief The access conditions allow the operation with the key of the session
+ * @details Key B cannot authenticate while the trailer makes it readable (conditions
+ *          000, 010, 001). A trailer is written whole, so writing it needs the right
+ *          to write the access bits (001 with Key A, 011 and 101 with Key B).
+ *          A refused operation is a NAK: the card goes idle.
+ */
+static bool allowed(byte block, Access op)
+{
+    byte trailer = accessCondition(Card::trailerOf(block));
+    bool ok;
+    if (authKeyB && (trailer == 0 || trailer == 1 || trailer == 2))
+        ok = false;
+    else if (Card::isTrailer(block))
+        ok = op == ACCESS_READ || (op == ACCESS_WRITE && (trailer == 1 ? !authKeyB : (trailer == 3 || trailer == 5) && authKeyB));
+    else
+        ok = DATA_ACCESS[accessCondition(block)] & (1 << (op * 2 + authKeyB));
+
+    if (!ok)
+    {
+        selected = false;
+        authTrailer = -1;
+    }
+    return ok;
+}
+
+static bool readValue(byte block, int32_t *value)
+{
+    const byte *b = field->memory + block * 16;
+    int32_t v, inverted, copy;
+    memcpy(&v, b, 4);
+    memcpy(&inverted, b + 4, 4);
+    memcpy(&copy, b + 8, 4);
+    if (v != copy || v != ~inverted || b[12] != b[14] || b[13] != b[15] || b[12] != (byte)~b[13])
+        return false;
+    *value = v;
+    return true;
+}
+
+static int32_t transferBuffer = 0; // Value register of the card
+
+/** @brief Load a value block into the transfer buffer, plus delta */
+static MFRC522::StatusCode changeValue(byte block, int32_t delta, Access op)
+{
+    int32_t value;
+    if (!accessible(block))
+        return MFRC522::STATUS_TIMEOUT;
+    if (Card::isTrailer(block) || !allowed(block, op) || !readValue(block, &value))
+        return MFRC522::STATUS_MIFARE_NACK;
+    transferBuffer = value + delta;
+    return MFRC522::STATUS_OK;
+}
+
+} // namespace emu
+
+using namespace emu;
+
+MFRC522::MFRC522(byte, byte)
+{
+    uid.size = 0;
+}
+
+void MFRC522::PCD_Init() {}
+void MFRC522::PCD_WriteRegister(PCD_Register, byte) {}
+byte MFRC522::PCD_ReadRegister(PCD_Register reg) { return reg == VersionReg ? 0x92 : 0; }
+void MFRC522::PCD_AntennaOn() {}
+void MFRC522::PCD_AntennaOff() {}
+void MFRC522::PCD_SoftPowerDown() {}
+void MFRC522::PCD_SoftPowerUp() {}
+void MFRC522::PCD_StopCrypto1() { authTrailer = -1; }
+void MFRC522::PCD_DumpVersionToSerial() { Serial.println(F("Firmware Version: 0x92 = v2.0 (emulated)")); }
+
+MFRC522::StatusCode MFRC522::PICC_RequestA(byte *, byte *)
+{
+    return live() && !field->halted ? STATUS_OK : STATUS_TIMEOUT;
+}
+
+MFRC522::StatusCode MFRC522::PICC_WakeupA(byte *, byte *)
+{
+    StatusCode status;
+    if (replayed(TRACE_OP_WAKEUP, 0, &status))
+        return status;
+    if (!live())
+        return STATUS_TIMEOUT;
+    field->halted = false;
+    selected = false;
+    authTrailer = -1;
+    pwdAuth = false;
+    return STATUS_OK;
+}
+
+MFRC522::StatusCode MFRC522::PICC_Select(Uid *id, byte)
+{
+    StatusCode status;
+    if (replayed(TRACE_OP_SELECT, id->size, &status))
+        return status;
+    if (!live() || field->halted || id->size != field->uid.size || memcmp(id->uidByte, field->uid.uidByte, id->size) != 0)
+        return STATUS_TIMEOUT;
+    selected = true;
+    authTrailer = -1;
+    pwdAuth = false;
+    id->sak = field->uid.sak;
+    return STATUS_OK;
+}
+
+MFRC522::StatusCode MFRC522::PICC_HaltA()
+{
+    StatusCode status;
+    if (replayed(TRACE_OP_HALT, 0, &status))
+        return status;
+    if (live())
+        field->halted = true;
+    selected = false;
+    authTrailer = -1;
+    pwdAuth = false;
+    return STATUS_OK;
+}
+
+bool MFRC522::PICC_IsNewCardPresent()
+{
+    bool present = field && !field->halted;
+    pollUs += present ? 1000 : 25000; // REQA answered, or the reader timeout on an empty field
+    return present;
+}
+
+bool MFRC522::PICC_ReadCardSerial()
+{
+    if (field)
+        uid = field->uid; // Anticollision: the UID of the card in the field
+    return PICC_Select(&uid) == STATUS_OK; // Virtual as in the library, so TracedMFRC522 records it
+}
+
+MFRC522::StatusCode MFRC522::PCD_Authenticate(byte command, byte block, MIFARE_Key *key, Uid *)
+{
+    StatusCode status;
+    if (replayed(command, block, &status))
+        return status;
+    if (!live() || !selected || block >= field->blocks)
+        return STATUS_TIMEOUT;
+
+    int trailer = Card::trailerOf(block);
+    const byte *stored = field->memory + trailer * 16 + (command == PICC_CMD_MF_AUTH_KEY_A ? 0 : 10);
+    if (memcmp(stored, key->keyByte, MF_KEY_SIZE) != 0)
+    {
+        selected = false; // The card stops answering until it is woken up again
+        authTrailer = -1;
+        return STATUS_TIMEOUT;
+    }
+    authTrailer = trailer;
+    authKeyB = command != PICC_CMD_MF_AUTH_KEY_A;
+    return STATUS_OK;
+}
+
+MFRC522::StatusCode MFRC522::MIFARE_Read(byte block, byte *buffer, byte *bufferSize)
+{
+    if (*bufferSize < 18)
+        return STATUS_NO_ROOM;
+    StatusCode status;
+    if (replayed(TRACE_OP_READ, block, &status))
+        return status;
+
+    if (field && field->pages)
+    {
+        if (!pageAccessible(block, false))
+            return field ? STATUS_MIFARE_NACK : STATUS_TIMEOUT;
+        for (int i = 0; i < 4; i++)
+        {
+            int page = (block + i) % field->pages; // Roll over at the end of memory
+            bool secret = page == Card::NTAG_CONFIG_PAGE + 2 || page == Card::NTAG_CONFIG_PAGE + 3;
+            if (secret)
+                memset(buffer + i * 4, 0, 4);
+            else
+                memcpy(buffer + i * 4, field->memory + page * 4, 4);
+        }
+        buffer[16] = buffer[17] = 0;
+        *bufferSize = 18;
+        checkRead(buffer);
+        return STATUS_OK;
+    }
+
+    if (!accessible(block))
+        return STATUS_TIMEOUT;
+    if (!allowed(block, ACCESS_READ))
+        return STATUS_MIFARE_NACK;
+
+    memcpy(buffer, field->memory + block * 16, 16);
+    if (Card::isTrailer(block))
+        memset(buffer, 0, MF_KEY_SIZE); // Key A is never readable
+    buffer[16] = buffer[17] = 0;
+    *bufferSize = 18;
+    checkRead(buffer);
+    return STATUS_OK;
+}
+
+MFRC522::StatusCode MFRC522::MIFARE_Write(byte block, byte *buffer, byte bufferSize)
+{
+    if (bufferSize < 16)
+        return STATUS_INVALID;
+    StatusCode status;
+    if (replayed(TRACE_OP_WRITE, block, &status))
+        return status;
+    if (!accessible(block))
+        return STATUS_TIMEOUT;
+    if (block == 0 || !allowed(block, ACCESS_WRITE))
+        return STATUS_MIFARE_NACK; // Manufacturer block, or write not allowed
+
+    memcpy(field->memory + block * 16, buffer, 16);
+    return STATUS_OK;
+}
+
+MFRC522::StatusCode MFRC522::MIFARE_Ultralight_Write(byte page, byte *buffer, byte bufferSize)
+{
+    if (bufferSize < 4)
+        return STATUS_INVALID;
+    StatusCode status;
+    if (replayed(TRACE_OP_UL_WRITE, page, &status))
+        return status;
+    if (field && !field->pages)
+        return live() ? STATUS_MIFARE_NACK : STATUS_TIMEOUT;
+    if (!pageAccessible(page, true))
+        return field ? STATUS_MIFARE_NACK : STATUS_TIMEOUT;
+    if (page < 3)
+        return STATUS_MIFARE_NACK; // UID and lock bytes are not emulated
+
+    memcpy(field->memory + page * 4, buffer, 4);
+    return STATUS_OK;
+}
+
+MFRC522::StatusCode MFRC522::MIFARE_Decrement(byte block, int32_t delta)
+{
+    StatusCode status;
+    if (replayed(TRACE_OP_DECREMENT, block, &status))
+        return status;
+    return changeValue(block, -delta, ACCESS_DECREMENT);
+}
+
+MFRC522::StatusCode MFRC522::MIFARE_Increment(byte block, int32_t delta)
+{
+    StatusCode status;
+    if (replayed(TRACE_OP_INCREMENT, block, &status))
+        return status;
+    return changeValue(block, delta, ACCESS_INCREMENT);
+}
+
+MFRC522::StatusCode MFRC522::MIFARE_Restore(byte block)
+{
+    StatusCode status;
+    if (replayed(TRACE_OP_RESTORE, block, &status))
+        return status;
+    return changeValue(block, 0, ACCESS_DECREMENT);
+}
+
+MFRC522::StatusCode MFRC522::MIFARE_Transfer(byte block)
+{
+    StatusCode status;
+    if (replayed(TRACE_OP_TRANSFER, block, &status))
+        return status;
+    if (!accessible(block))
+        return STATUS_TIMEOUT;
+    if (block == 0 || Card::isTrailer(block) || !allowed(block, ACCESS_DECREMENT))
+        return STATUS_MIFARE_NACK;
+
+    byte *b = field->memory + block * 16; // Value block format, see MIFARE_SetValue()
+    int32_t inverted = ~transferBuffer;
+    memcpy(b, &transferBuffer, 4);
+    memcpy(b + 4, &inverted, 4);
+    memcpy(b + 8, &transferBuffer, 4);
+    b[12] = b[14] = block;
+    b[13] = b[15] = ~block;
+    return STATUS_OK;
+}
+
+MFRC522::StatusCode MFRC522::MIFARE_GetValue(byte block, int32_t *value)
+{
+    byte buffer[18];
+    byte size = sizeof(buffer);
+    StatusCode status = MIFARE_Read(block, buffer, &size);
+    if (status == STATUS_OK)
+        memcpy(value, buffer, 4);
+    return status;
+}
+
+MFRC522::StatusCode MFRC522::MIFARE_SetValue(byte block, int32_t value)
+{
+    byte buffer[16];
+    int32_t inverted = ~value;
+    memcpy(buffer, &value, 4);
+    memcpy(buffer + 4, &inverted, 4);
+    memcpy(buffer + 8, &value, 4);
+    buffer[12] = buffer[14] = block;
+    buffer[13] = buffer[15] = ~block;
+    return MIFARE_Write(block, buffer, 16);
+}
+
+MFRC522::StatusCode MFRC522::PCD_NTAG216_AUTH(byte *password, byte *pack)
+{
+    StatusCode status;
+    if (replayed(TRACE_OP_PWD_AUTH, 0, &status))
+        return status;
+    if (!live() || !selected)
+        return STATUS_TIMEOUT;
+
+    const byte *config = field->memory + Card::NTAG_CONFIG_PAGE * 4;
+    if (!field->pages || memcmp(config + 8, password, 4) != 0)
+    {
+        selected = false;
+        return STATUS_MIFARE_NACK;
+    }
+    pwdAuth = true;
+    memcpy(pack, config + 12, 2);
+    return STATUS_OK;
+}
+
+MFRC522::StatusCode MFRC522::PCD_CalculateCRC(byte *, byte, byte *result)
+{
+    result[0] = result[1] = 0; // CRC_A is not checked by the card model
+    return STATUS_OK;
+}
+
+MFRC522::StatusCode MFRC522::PCD_TransceiveData(byte *sendData, byte sendLen, byte *backData, byte *backLen,
+                                                byte *, byte, bool)
+{
+    static const byte ntag213Version[8] = {0x00, 0x04, 0x04, 0x02, 0x01, 0x00, 0x0F, 0x03};
+
+    StatusCode status;
+    if (replayed(TRACE_OP_TRANSCEIVE, sendLen > 0 ? sendData[0] : 0, &status))
+        return status;
+    if (!live() || !selected)
+        return STATUS_TIMEOUT;
+    if (sendLen < 1 || sendData[0] != 0x60 || !field->pages) // Only GET_VERSION, on NTAG
+    {
+        selected = false;
+        return STATUS_MIFARE_NACK;
+    }
+    if (*backLen < 10)
+        return STATUS_NO_ROOM;
+    memcpy(backData, ntag213Version, 8);
+    backData[8] = backData[9] = 0;
+    *backLen = 10;
+    return STATUS_OK;
+}
+
+void MFRC522::MIFARE_SetAccessBits(byte *buffer, byte g0, byte g1, byte g2, byte g3)
+{
+    byte c1 = ((g3 & 4) << 1) | ((g2 & 4) << 0) | ((g1 & 4) >> 1) | ((g0 & 4) >> 2);
+    byte c2 = ((g3 & 2) << 2) | ((g2 & 2) << 1) | ((g1 & 2) << 0) | ((g0 & 2) >> 1);
+    byte c3 = ((g3 & 1) << 3) | ((g2 & 1) << 2) | ((g1 & 1) << 1) | ((g0 & 1) << 0);
+
+    buffer[0] = (~c2 & 0xF) << 4 | (~c1 & 0xF);
+    buffer[1] = c1 << 4 | (~c3 & 0xF);
+    buffer[2] = c3 << 4 | c2;
+}
+
+const __FlashStringHelper *MFRC522::GetStatusCodeName(StatusCode code)
+{
+    switch (code)
+    {
+    case STATUS_OK:
+        return F("Success.");
+    case STATUS_TIMEOUT:
+        return F("Timeout in communication.");
+    case STATUS_NO_ROOM:
+        return F("A buffer is not big enough.");
+    case STATUS_INVALID:
+        return F("Invalid argument.");
+    case STATUS_MIFARE_NACK:
+        return F("A MIFARE PICC responded with NAK.");
+    default:
+        return F("Error in communication.");
+    }
+}
+
+MFRC522::PICC_Type MFRC522::PICC_GetType(byte sak)
+{
+    switch (sak & 0x7F)
+    {
+    case 0x04:
+        return PICC_TYPE_NOT_COMPLETE;
+    case 0x09:
+        return PICC_TYPE_MIFARE_MINI;
+    case 0x08:
+        return PICC_TYPE_MIFARE_1K;
+    case 0x18:
+        return PICC_TYPE_MIFARE_4K;
+    case 0x00:
+        return PICC_TYPE_MIFARE_UL;
+    case 0x20:
+        return PICC_TYPE_ISO_14443_4;
+    default:
+        return PICC_TYPE_UNKNOWN;
+    }
+}
+
+const __FlashStringHelper *MFRC522::PICC_GetTypeName(PICC_Type type)
+{
+    switch (type)
+    {
+    case PICC_TYPE_MIFARE_MINI:
+        return F("MIFARE Mini, 320 bytes");
+    case PICC_TYPE_MIFARE_1K:
+        return F("MIFARE 1KB");
+    case PICC_TYPE_MIFARE_4K:
+        return F("MIFARE 4KB");
+    case PICC_TYPE_MIFARE_UL:
+        return F("MIFARE Ultralight or Ultralight C");
+    default:
+        return F("Unknown type");
+    }
+}
+
+void MFRC522::PICC_DumpToSerial(Uid *)
+{
+}
@@ -0,0 +1,112 @@
+/**
+ * @file mfrc522-emu.h
+ * @brief MIFARE Classic and NTAG213 card models behind the emulated MFRC522
+ * @details Behave like the real cards where rfid-box-writer depends on them:
+ *          a failed authentication deselects the card, Key A reads back as zeros,
+ *          block 0 is read-only and a halted card answers only WakeupA.
+ *          Classic access bits are enforced for reads, writes and value operations
+ *          (a refused operation is a NAK), a trailer is written whole. NTAG213: reads roll over at the
+ *          end of memory, PWD and PACK read back as zeros, pages from AUTH0 on
+ *          need PWD_AUTH for writes (and for reads with PROT set).
+ * @author Dag
+ */
+
+#ifndef RFID_EMU_MFRC522_EMU_H
+#define RFID_EMU_MFRC522_EMU_H
+
+#include "MFRC522.h"
+#include "rf-trace.h"
+
+namespace emu
+{
+
+/**
+ * @brief MIFARE Classic Mini / 1K / 4K card, or NTAG213 tag
+ */
+struct Card
+{
+    MFRC522::Uid uid;
+    int blocks;        // 20 (Mini), 64 (1K), 256 (4K), 0 (NTAG213)
+    int pages;         // 45 (NTAG213), 0 (Classic)
+    bool halted;
+    byte memory[4096]; // Classic transport configuration: zeros, trailers FF..FF / FF 07 80 69 / FF..FF
+                       // NTAG213: 4 bytes per page, CC E1 10 12 00, AUTH0 FF, PWD FF..FF
+
+    static const int NTAG_CONFIG_PAGE = 0x29;
+
+    /**
+     * @param uid UID bytes (4, 7 or 10)
+     * @param uidSize UID length
+     * @param sak 0x09 Mini, 0x08 1K, 0x18 4K, 0x00 NTAG213
+     */
+    Card(const byte *uid, byte uidSize, byte sak);
+
+    static int trailerOf(int block) { return block < 128 ? block / 4 * 4 + 3 : block - (block - 128) % 16 + 15; }
+    static bool isTrailer(int block) { return trailerOf(block) == block; }
+};
+
+/** @brief Put a card in the field (nullptr: remove it) */
+void presentCard(Card *card);
+
+/** @brief Card in the field, nullptr if none */
+Card *fieldCard();
+
+/** @brief Remove the card after n more RF operations (card tear), -1: never */
+void tearAfter(long operations);
+
+/**
+ * @brief Call cut() in place of the RF operation after the next n (power loss)
+ * @details cut() is not expected to return: the process stands for the powered box.
+ *          n < 0 cancels.
+ */
+void cutAfter(long operations, void (*cut)());
+
+/** @brief RF operations since start */
+long rfOperations();
+
+/**
+ * @brief Modeled RF time since start, in microseconds
+ * @details Each command costs its typical duration on an Uno with a MFRC522 at
+ *          106 kbit/s, or the duration of the trace record it replayed.
+ */
+unsigned long rfMicros();
+
+/**
+ * @brief Modeled time of the card polls (PICC_IsNewCardPresent), in microseconds
+ * @details An empty field costs the reader timeout (25 ms), a card about 1 ms.
+ *          Not part of rfMicros(): polls are not traced.
+ */
+unsigned long pollMicros();
+
+/**
+ * @brief Outcome of a trace replay
+ */
+struct ReplayStats
+{
+    int matched;          // Commands matched with a record
+    int diverged;         // Index of the first record the firmware did not send, -1 if none
+    int checkMismatches;  // Matched reads whose data differ from the recorded checksum
+    unsigned long recordedMicros; // Duration of the matched records
+};
+
+/**
+ * @brief Replay a recorded RF trace (rf-trace.h) against the card in the field
+ * @details Every command the firmware sends is matched with the next record (command
+ *          and block). A matched record with an error status makes the command fail
+ *          with that status, as it did in the field; a matched successful record runs
+ *          the card model. The first command that does not match ends the replay:
+ *          from there the card model answers alone.
+ * @param records Recorded commands, kept by the caller until the replay ends
+ * @param count Number of records
+ */
+void replay(const TraceRecord *records, int count);
+
+/** @brief true while records remain to be matched */
+bool replaying();
+
+/** @brief Outcome of the replay so far */
+const ReplayStats &replayStats();
+
+} // namespace emu
+
+#endif // RFID_EMU_MFRC522_EMU_H
@@ -0,0 +1,40 @@
+#!/usr/bin/env python3
+"""Turn rfid-box-writer.ino into a C++ translation unit, as the Arduino builder does.
+
+Adds `#include <Arduino.h>` and a prototype of every top-level function before the
+first function definition, so functions can be used before they are defined.
+
+Usage: sketch-prototypes.py SKETCH.ino > sketch.cpp
+"""
+
+import re
+import sys
+
+SIGNATURE = re.compile(
+    r'^(?!\s)(?!return|else|if|for|while|switch)([A-Za-z_][\w:<>]*[\s*&]+)+\**[A-Za-z_]\w*\s*\([^;{]*\)\s*$')
+
+
+def main(path):
+    lines = open(path).read().split('\n')
+    prototypes, first, depth = [], None, 0
+
+    for i, line in enumerate(lines):
+        if depth == 0 and SIGNATURE.match(line) and i + 1 < len(lines) and lines[i + 1].strip().startswith('{'):
+            if 'static' not in line:
+                prototypes.append(re.sub(r'\s*=\s*[^,)]+', '', line.strip()) + ';')
+                if first is None:
+                    first = i
+        depth += line.count('{') - line.count('}')
+
+    # Insert above the doc comment of the first function
+    insert = first if first is not None else len(lines)
+    while insert > 0 and lines[insert - 1].strip().startswith(('*', '/**', '//')):
+        insert -= 1
+
+    print('#include <Arduino.h>')
+    print('#line 1 "%s"' % path)
+    print('\n'.join(lines[:insert] + prototypes + ['#line %d "%s"' % (insert + 1, path)] + lines[insert:]))
+
+
+if __name__ == '__main__':
+    main(sys.argv[1])
@@ -0,0 +1,170 @@
+/**
+ * @file frame.h
+ * @brief Host-side decoder/encoder of the RFID Box binary frames
+ * @details Mirrors rfid-box-writer/frame.h:
+ *
+ * -----------------------------------------------------------------
+ * SOF (0x7E) | TYPE (1) | LENGTH (2, LE) | PAYLOAD (LENGTH) | CRC16 (2, LE)
+ * -----------------------------------------------------------------
+ *
+ * CRC16 is CRC-16/CCITT-FALSE over TYPE, LENGTH and PAYLOAD. Bytes outside frames
+ * (text log lines on the same serial port) are skipped.
+ * @author Dag
+ */
+
+#ifndef RFID_HOST_FRAME_H
+#define RFID_HOST_FRAME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rfid
+{
+
+const uint8_t FRAME_SOF = 0x7E;
+const size_t FRAME_MAX_PAYLOAD = 1024;
+
+// Frame types (rfid-box-writer/frame.h)
+const uint8_t FRAME_AUDIT_LOG = 0x10;
+const uint8_t FRAME_COUNTERS = 0x11;
+const uint8_t FRAME_TRACE = 0x12;
+const uint8_t FRAME_CARD_INFO = 0x20;
+const uint8_t FRAME_SECTOR = 0x21;
+const uint8_t FRAME_CARD_END = 0x22;
+const uint8_t FRAME_JOB = 0x30;
+const uint8_t FRAME_JOB_ACK = 0x31;
+const uint8_t FRAME_JOB_RESULT = 0x32;
+const uint8_t FRAME_STATUS_REQUEST = 0x33;
+const uint8_t FRAME_STATUS = 0x34;
+const uint8_t FRAME_JOB_CANCEL = 0x35;
+const uint8_t FRAME_CONSOLE = 0x40;
+const uint8_t FRAME_CONSOLE_REPLY = 0x41;
+
+inline uint16_t crc16Update(uint16_t crc, uint8_t data)
+{
+    crc ^= static_cast<uint16_t>(data << 8);
+    for (int i = 0; i < 8; i++)
+        crc = crc & 0x8000 ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+    return crc;
+}
+
+/**
+ * @brief Encode one frame
+ */
+inline std::vector<uint8_t> encodeFrame(uint8_t type, const std::vector<uint8_t> &payload)
+{
+    std::vector<uint8_t> out;
+    uint16_t crc = 0xFFFF;
+    uint16_t len = static_cast<uint16_t>(payload.size());
+
+    out.push_back(FRAME_SOF);
+    for (uint8_t b : {type, static_cast<uint8_t>(len & 0xFF), static_cast<uint8_t>(len >> 8)})
+    {
+        out.push_back(b);
+        crc = crc16Update(crc, b);
+    }
+    for (uint8_t b : payload)
+    {
+        out.push_back(b);
+        crc = crc16Update(crc, b);
+    }
+    out.push_back(crc & 0xFF);
+    out.push_back(crc >> 8);
+    return out;
+}
+
+/**
+ * @brief Incremental frame decoder
+ * @details Feed the received bytes one at a time; feed() returns true when a
+ *          complete frame with a valid CRC is available in type() / payload().
+ */
+class FrameDecoder
+{
+public:
+    bool feed(uint8_t b)
+    {
+        switch (state)
+        {
+        case WAIT_SOF:
+            if (b == FRAME_SOF)
+            {
+                state = TYPE;
+                crc = 0xFFFF;
+                data.clear();
+            }
+            return false;
+        case TYPE:
+            frameType = b;
+            crc = crc16Update(crc, b);
+            state = LEN_LO;
+            return false;
+        case LEN_LO:
+            length = b;
+            crc = crc16Update(crc, b);
+            state = LEN_HI;
+            return false;
+        case LEN_HI:
+            length |= static_cast<uint16_t>(b << 8);
+            crc = crc16Update(crc, b);
+            if (length > FRAME_MAX_PAYLOAD)
+            {
+                errors++;
+                state = WAIT_SOF; // Not a frame: resynchronize
+            }
+            else
+                state = length ? PAYLOAD : CRC_LO;
+            return false;
+        case PAYLOAD:
+            data.push_back(b);
+            crc = crc16Update(crc, b);
+            if (data.size() == length)
+                state = CRC_LO;
+            return false;
+        case CRC_LO:
+            received = b;
+            state = CRC_HI;
+            return false;
+        case CRC_HI:
+            received |= static_cast<uint16_t>(b << 8);
+            state = WAIT_SOF;
+            if (received != crc)
+            {
+                errors++;
+                return false;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    uint8_t type() const { return frameType; }
+    const std::vector<uint8_t> &payload() const { return data; }
+
+    /** @brief Frames discarded for bad length or CRC */
+    unsigned long errorCount() const { return errors; }
+
+private:
+    enum State
+    {
+        WAIT_SOF,
+        TYPE,
+        LEN_LO,
+        LEN_HI,
+        PAYLOAD,
+        CRC_LO,
+        CRC_HI
+    };
+
+    State state = WAIT_SOF;
+    uint8_t frameType = 0;
+    uint16_t length = 0;
+    uint16_t crc = 0xFFFF;
+    uint16_t received = 0;
+    std::vector<uint8_t> data;
+    unsigned long errors = 0;
+};
+
+} // namespace rfid
+
+#endif // RFID_HOST_FRAME_H
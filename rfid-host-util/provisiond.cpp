@@ -0,0 +1,625 @@
+/**
+ * @file provisiond.cpp
+ * @brief Provisioning daemon: one job queue, many RFID Box writers in parallel
+ * @details Every serial port is a device with its own state machine:
+ *
+ *          PROBING    FRAME_STATUS_REQUEST every second until FRAME_STATUS arrives
+ *                     (the board may be rebooting after the port was opened)
+ *          IDLE       ready for a job
+ *          SENT       FRAME_JOB sent, waiting for FRAME_JOB_ACK
+ *          ARMED      job accepted, waiting for a card and FRAME_JOB_RESULT
+ *          CANCELLING FRAME_JOB_CANCEL sent (card timeout or stale job after a restart)
+ *
+ *          Jobs are taken from a FIFO by whichever device becomes idle first, so the
+ *          throughput grows with the number of boxes. A box holds a single job: a new
+ *          one is sent only after the result of the previous one, which bounds what
+ *          is in flight per port. Outbound bytes go through a bounded per-port queue
+ *          written only when poll() reports POLLOUT; a port whose queue is full gets no
+ *          new job until it drains. Failed jobs are retried (on any device) up to
+ *          --retries times; jobs of a device that disappears are requeued.
+ *
+ *          Jobs file, one job per line ('#' comments):
+ *              passphrase[;UID hex[;norekey]]
+ *          Empty passphrase: the box master credential. Empty UID: any card.
+ *
+ *          Results go to stdout as JSON lines, the summary to stderr.
+ *
+ *          Build: g++ -std=c++17 -O2 -Wall -o provisiond provisiond.cpp
+ *          Usage: provisiond [--retries N] [--ack-timeout MS] [--card-timeout MS]
+ *                            [--baud N] JOBS PORT...
+ * @author Dag
+ */
+
+#include "frame.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace rfid;
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+const uint8_t AGENT_WRITER = 1;        // rfid-box-writer/def.h
+const uint8_t JOB_FLAG_NO_REKEY = 0x01; // rfid-box-writer/host-job.h
+const size_t JOB_PASSPHRASE_MAX = 64;
+const size_t OUTBOUND_LIMIT = 512;      // Bytes queued per port
+const long PROBE_INTERVAL_MS = 1000;
+
+// JobAck (rfid-box-writer/host-job.h)
+enum JobAck : uint8_t
+{
+    JOB_ACCEPTED = 0,
+    JOB_BUSY = 1,
+    JOB_INVALID = 2,
+    JOB_UNSUPPORTED = 3
+};
+
+// AuditResult (rfid-box-writer/audit-log.h), index = code
+const char *const RESULT_NAMES[] = {"cancelled", "granted", "denied", "uid_denied", "incompatible", "auth_failed",
+                                    "read_failed", "write_failed", "written", "set", "set_failed", "uid_mismatch",
+                                    "uses_exhausted"};
+const uint8_t RESULT_CANCELLED = 0;
+const uint8_t RESULT_WRITTEN = 8;
+const uint8_t NO_BLOCK = 0xFF;
+
+struct Options
+{
+    unsigned retries = 2;
+    long ackTimeoutMs = 2000;
+    long cardTimeoutMs = 120000; // 0: wait for the card forever
+    speed_t baud = B9600;
+};
+
+struct Job
+{
+    uint16_t id = 0;
+    std::string passphrase;
+    std::vector<uint8_t> uid;
+    uint8_t flags = 0;
+    unsigned attempts = 0;
+};
+
+enum DeviceState
+{
+    PROBING,
+    IDLE,
+    SENT,
+    ARMED,
+    CANCELLING,
+    DISABLED
+};
+
+struct Device
+{
+    std::string path;
+    int fd = -1;
+    DeviceState state = PROBING;
+    FrameDecoder decoder;
+    std::deque<uint8_t> outbound;
+    Clock::time_point deadline; // Timeout of the current state
+    bool hasJob = false;
+    Job job;
+    unsigned written = 0;
+    unsigned failed = 0;
+};
+
+std::string hex(const std::vector<uint8_t> &data)
+{
+    std::string out;
+    char digits[3];
+    for (uint8_t b : data)
+    {
+        snprintf(digits, sizeof(digits), "%02X", b);
+        out += digits;
+    }
+    return out;
+}
+
+std::string jsonString(const std::string &s)
+{
+    std::string out = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+bool parseUid(const std::string &text, std::vector<uint8_t> *uid)
+{
+    std::string digits;
+    for (char c : text)
+        if (isxdigit(static_cast<unsigned char>(c)))
+            digits += c;
+        else if (c != ':' && c != ' ')
+            return false;
+
+    if (digits.size() % 2 != 0)
+        return false;
+    for (size_t i = 0; i < digits.size(); i += 2)
+        uid->push_back(static_cast<uint8_t>(std::stoul(digits.substr(i, 2), nullptr, 16)));
+    return uid->empty() || uid->size() == 4 || uid->size() == 7 || uid->size() == 10;
+}
+
+bool loadJobs(std::istream &in, std::deque<Job> *jobs)
+{
+    std::string line;
+    unsigned lineNumber = 0;
+
+    while (std::getline(in, line))
+    {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::vector<std::string> fields;
+        size_t start = 0;
+        for (size_t sep; (sep = line.find(';', start)) != std::string::npos; start = sep + 1)
+            fields.push_back(line.substr(start, sep - start));
+        fields.push_back(line.substr(start));
+
+        Job job;
+        job.id = static_cast<uint16_t>(jobs->size() + 1);
+        job.passphrase = fields[0];
+        bool ok = fields.size() <= 3 && job.passphrase.size() <= JOB_PASSPHRASE_MAX;
+        if (ok && fields.size() > 1)
+            ok = parseUid(fields[1], &job.uid);
+        if (ok && fields.size() > 2)
+        {
+            if (fields[2] == "norekey")
+                job.flags |= JOB_FLAG_NO_REKEY;
+            else if (!fields[2].empty())
+                ok = false;
+        }
+        if (!ok)
+        {
+            std::cerr << "jobs:" << lineNumber << ": invalid job\n";
+            return false;
+        }
+        jobs->push_back(job);
+    }
+    return true;
+}
+
+bool openPort(Device *device, speed_t baud)
+{
+    device->fd = open(device->path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (device->fd < 0)
+        return false;
+
+    termios tio;
+    if (tcgetattr(device->fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, baud);
+        cfsetospeed(&tio, baud);
+        tcsetattr(device->fd, TCSANOW, &tio);
+    }
+    return true;
+}
+
+/**
+ * @brief Scheduler of the job queue over the devices
+ */
+class Daemon
+{
+public:
+    Daemon(const Options &options, std::deque<Job> jobs) : options(options), queue(std::move(jobs)), total(queue.size()) {}
+
+    void addDevice(const std::string &path)
+    {
+        devices.emplace_back();
+        devices.back().path = path;
+    }
+
+    int run()
+    {
+        start = Clock::now();
+        for (Device &d : devices)
+        {
+            if (!openPort(&d, options.baud))
+            {
+                std::cerr << d.path << ": " << strerror(errno) << "\n";
+                d.state = DISABLED;
+            }
+            else
+                probe(d);
+        }
+
+        while (finished + failed < total && anyDevice())
+        {
+            schedule();
+            pump();
+            expire();
+        }
+
+        summary();
+        return finished == total ? 0 : 1;
+    }
+
+private:
+    const Options &options;
+    std::deque<Job> queue;
+    size_t total;
+    size_t finished = 0;
+    size_t failed = 0;
+    std::vector<Device> devices;
+    Clock::time_point start;
+
+    bool anyDevice() const
+    {
+        for (const Device &d : devices)
+            if (d.state != DISABLED)
+                return true;
+        return false;
+    }
+
+    static Clock::time_point after(long ms) { return Clock::now() + std::chrono::milliseconds(ms); }
+
+    /** @brief Queue a frame; false (nothing queued) if the port is backlogged */
+    bool send(Device &d, uint8_t type, const std::vector<uint8_t> &payload)
+    {
+        std::vector<uint8_t> frame = encodeFrame(type, payload);
+        if (d.outbound.size() + frame.size() > OUTBOUND_LIMIT)
+            return false;
+        d.outbound.insert(d.outbound.end(), frame.begin(), frame.end());
+        return true;
+    }
+
+    void probe(Device &d)
+    {
+        d.state = PROBING;
+        d.deadline = after(PROBE_INTERVAL_MS);
+        send(d, FRAME_STATUS_REQUEST, {});
+    }
+
+    void cancel(Device &d, uint16_t id)
+    {
+        d.state = CANCELLING;
+        d.deadline = after(options.ackTimeoutMs);
+        send(d, FRAME_JOB_CANCEL, {static_cast<uint8_t>(id), static_cast<uint8_t>(id >> 8)});
+    }
+
+    /** @brief Give the job back to the queue (front: it keeps its turn) */
+    void requeue(Device &d)
+    {
+        if (d.hasJob)
+            queue.push_front(d.job);
+        d.hasJob = false;
+    }
+
+    void disable(Device &d, const char *reason)
+    {
+        std::cerr << d.path << ": " << reason << "\n";
+        requeue(d);
+        if (d.fd >= 0)
+            close(d.fd);
+        d.fd = -1;
+        d.state = DISABLED;
+    }
+
+    /** @brief Hand the next job to every idle device with room in its outbound queue */
+    void schedule()
+    {
+        for (Device &d : devices)
+        {
+            if (queue.empty())
+                return;
+            if (d.state != IDLE || !d.outbound.empty())
+                continue;
+
+            Job job = queue.front();
+            std::vector<uint8_t> payload = {static_cast<uint8_t>(job.id), static_cast<uint8_t>(job.id >> 8), job.flags,
+                                            static_cast<uint8_t>(job.uid.size())};
+            payload.insert(payload.end(), job.uid.begin(), job.uid.end());
+            payload.insert(payload.end(), job.passphrase.begin(), job.passphrase.end());
+            if (!send(d, FRAME_JOB, payload))
+                continue;
+
+            queue.pop_front();
+            d.job = job;
+            d.hasJob = true;
+            d.state = SENT;
+            d.deadline = after(options.ackTimeoutMs);
+        }
+    }
+
+    /** @brief One poll() round: flush outbound queues, decode inbound frames */
+    void pump()
+    {
+        std::vector<pollfd> fds;
+        std::vector<Device *> owners;
+        for (Device &d : devices)
+        {
+            if (d.state == DISABLED)
+                continue;
+            fds.push_back({d.fd, static_cast<short>(POLLIN | (d.outbound.empty() ? 0 : POLLOUT)), 0});
+            owners.push_back(&d);
+        }
+
+        if (poll(fds.data(), fds.size(), 50) <= 0)
+            return;
+
+        for (size_t i = 0; i < fds.size(); i++)
+        {
+            Device &d = *owners[i];
+            if (fds[i].revents & POLLOUT)
+                flush(d);
+            if (fds[i].revents & POLLIN)
+                receive(d);
+            else if (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL))
+                disable(d, "port closed");
+        }
+    }
+
+    void flush(Device &d)
+    {
+        uint8_t chunk[64];
+        size_t n = 0;
+        while (n < sizeof(chunk) && n < d.outbound.size())
+        {
+            chunk[n] = d.outbound[n];
+            n++;
+        }
+
+        ssize_t sent = write(d.fd, chunk, n);
+        if (sent > 0)
+            d.outbound.erase(d.outbound.begin(), d.outbound.begin() + sent);
+        else if (sent < 0 && errno != EAGAIN && errno != EINTR)
+            disable(d, "write error");
+    }
+
+    void receive(Device &d)
+    {
+        uint8_t buffer[256];
+        ssize_t n = read(d.fd, buffer, sizeof(buffer));
+        if (n <= 0)
+        {
+            if (n == 0 || (errno != EAGAIN && errno != EINTR))
+                disable(d, "port closed");
+            return;
+        }
+
+        for (ssize_t i = 0; i < n && d.state != DISABLED; i++)
+            if (d.decoder.feed(buffer[i]))
+                handleFrame(d, d.decoder.type(), d.decoder.payload());
+    }
+
+    static uint16_t idOf(const std::vector<uint8_t> &p) { return p.size() >= 2 ? p[0] | p[1] << 8 : 0; }
+
+    void handleFrame(Device &d, uint8_t type, const std::vector<uint8_t> &p)
+    {
+        switch (type)
+        {
+        case FRAME_STATUS:
+            if (p.size() < 5 || d.state != PROBING)
+                return;
+            if (p[0] != AGENT_WRITER)
+                disable(d, "reader build, cannot write cards");
+            else if (p[2])
+                cancel(d, p[3] | p[4] << 8); // Armed by a previous session
+            else
+                d.state = IDLE;
+            return;
+
+        case FRAME_JOB_ACK:
+            if (p.size() < 3 || d.state != SENT || !d.hasJob || idOf(p) != d.job.id)
+                return;
+            if (p[2] == JOB_ACCEPTED)
+            {
+                d.state = ARMED;
+                d.deadline = options.cardTimeoutMs > 0 ? after(options.cardTimeoutMs) : Clock::time_point::max();
+            }
+            else if (p[2] == JOB_INVALID)
+            {
+                report(d, d.job, "invalid", nullptr, false);
+                d.hasJob = false;
+                failed++;
+                d.state = IDLE;
+            }
+            else if (p[2] == JOB_UNSUPPORTED)
+                disable(d, "jobs not supported");
+            else
+            {
+                requeue(d); // JOB_BUSY: find out what the box is doing
+                probe(d);
+            }
+            return;
+
+        case FRAME_JOB_RESULT:
+            if (p.size() < 9 || p.size() < 9u + p[8])
+                return;
+            if (d.hasJob && idOf(p) == d.job.id && (d.state == ARMED || d.state == CANCELLING))
+                complete(d, p);
+            else if (d.state == CANCELLING)
+                d.state = IDLE; // Stale job of a previous session cancelled
+            return;
+        }
+    }
+
+    void complete(Device &d, const std::vector<uint8_t> &p)
+    {
+        uint8_t result = p[2];
+        Job job = d.job;
+        d.hasJob = false;
+        d.state = IDLE;
+
+        if (result == RESULT_CANCELLED)
+        {
+            report(d, job, RESULT_NAMES[result], &p, true);
+            queue.push_front(job); // Card timeout: another box may be luckier
+            return;
+        }
+
+        job.attempts++;
+        bool ok = result == RESULT_WRITTEN;
+        bool retry = !ok && job.attempts <= options.retries;
+        report(d, job, result < sizeof(RESULT_NAMES) / sizeof(RESULT_NAMES[0]) ? RESULT_NAMES[result] : "unknown", &p, retry);
+
+        if (ok)
+        {
+            finished++;
+            d.written++;
+        }
+        else
+        {
+            d.failed++;
+            if (retry)
+                queue.push_front(job);
+            else
+                failed++;
+        }
+    }
+
+    void report(const Device &d, const Job &job, const char *result, const std::vector<uint8_t> *p, bool retry)
+    {
+        std::cout << "{\"job\":" << job.id << ",\"device\":" << jsonString(d.path) << ",\"result\":\"" << result << "\"";
+        if (p)
+        {
+            const std::vector<uint8_t> &r = *p;
+            std::cout << ",\"uid\":\"" << hex(std::vector<uint8_t>(r.begin() + 9, r.begin() + 9 + r[8])) << "\""
+                      << ",\"written\":" << unsigned(r[4]) << ",\"skipped\":" << unsigned(r[5])
+                      << ",\"ms\":" << (r[6] | r[7] << 8);
+            if (r[3] != NO_BLOCK)
+                std::cout << ",\"block\":" << unsigned(r[3]);
+        }
+        std::cout << ",\"attempt\":" << job.attempts << ",\"retry\":" << (retry ? "true" : "false") << "}" << std::endl;
+    }
+
+    /** @brief Timeouts of the device states */
+    void expire()
+    {
+        Clock::time_point now = Clock::now();
+        for (Device &d : devices)
+        {
+            if (d.state == DISABLED || d.state == IDLE || now < d.deadline)
+                continue;
+
+            switch (d.state)
+            {
+            case PROBING:
+                probe(d);
+                break;
+            case SENT: // No ACK: the frame may have been lost, the box will tell
+                requeue(d);
+                probe(d);
+                break;
+            case ARMED:
+                cancel(d, d.job.id);
+                break;
+            case CANCELLING:
+                requeue(d);
+                probe(d);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    void summary() const
+    {
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        fprintf(stderr, "%zu/%zu jobs written, %zu failed, %.1f s, %.1f cards/min\n", finished, total, failed, seconds,
+                seconds > 0 ? finished * 60.0 / seconds : 0.0);
+        for (const Device &d : devices)
+            fprintf(stderr, "  %s: %u written, %u failed attempts%s\n", d.path.c_str(), d.written, d.failed,
+                    d.state == DISABLED ? " (disabled)" : "");
+    }
+};
+
+int usage()
+{
+    std::cerr << "Usage: provisiond [--retries N] [--ack-timeout MS] [--card-timeout MS] [--baud N] JOBS PORT...\n"
+              << "  JOBS  jobs file ('-' for stdin), one job per line: passphrase[;UID hex[;norekey]]\n";
+    return 2;
+}
+
+speed_t baudConstant(unsigned long baud)
+{
+    switch (baud)
+    {
+    case 9600:
+        return B9600;
+    case 19200:
+        return B19200;
+    case 38400:
+        return B38400;
+    case 57600:
+        return B57600;
+    case 115200:
+        return B115200;
+    default:
+        return B0;
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--retries" && hasValue)
+            options.retries = std::stoul(argv[++i]);
+        else if (arg == "--ack-timeout" && hasValue)
+            options.ackTimeoutMs = std::stol(argv[++i]);
+        else if (arg == "--card-timeout" && hasValue)
+            options.cardTimeoutMs = std::stol(argv[++i]);
+        else if (arg == "--baud" && hasValue)
+        {
+            options.baud = baudConstant(std::stoul(argv[++i]));
+            if (options.baud == B0)
+                return usage();
+        }
+        else if (arg.size() > 1 && arg[0] == '-')
+            return usage();
+        else
+            args.push_back(arg);
+    }
+    if (args.size() < 2)
+        return usage();
+
+    std::deque<Job> jobs;
+    std::ifstream file;
+    if (args[0] != "-")
+    {
+        file.open(args[0]);
+        if (!file)
+        {
+            std::cerr << "Cannot open " << args[0] << "\n";
+            return 1;
+        }
+    }
+    if (!loadJobs(args[0] == "-" ? std::cin : file, &jobs))
+        return 1;
+
+    Daemon daemon(options, std::move(jobs));
+    for (size_t i = 1; i < args.size(); i++)
+        daemon.addDevice(args[i]);
+    return daemon.run();
+}
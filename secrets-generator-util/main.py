@@ -1,6 +1,19 @@
+import argparse
+import hashlib
+import hmac
 import string
 import secrets
-from typing import Tuple
+from typing import List, Optional, Tuple
+
+
+PASSPHRASE_ALPHABET = string.ascii_letters + string.digits  # a-z, A-Z, 0-9
+PASSPHRASE_MAX_LENGTH = 135  # Fits the EEPROM passphrase slot of the firmware
+DEFAULT_KEY = [0xFF] * 6  # MIFARE Classic factory key, always the last keyring entry
+# Passphrase of the demo data.h published with the sources: never a factory secret
+DEMO_PASSPHRASE = "SuperMegaS3cretP4ssphraseToKeepHidden4EverLockedUpInAS4f3Place00"
+
+# Domain separation key of deriveMacKey() in rfid-box-writer/credential.cpp
+KDF_KEY = b"RFID-BOX-MAC-KDF"
 
 
 def generate_passphrase(length=64) -> str:
@@ -14,7 +27,7 @@ def generate_passphrase(length=64) -> str:
         str: Random passphrase containing uppercase, lowercase letters and digits
     """
     # Define character set: uppercase + lowercase + digits
-    alphabet = string.ascii_letters + string.digits  # a-z, A-Z, 0-9
+    alphabet = PASSPHRASE_ALPHABET
 
     # Use secrets module for cryptographically secure random generation
     passphrase = "".join(secrets.choice(alphabet) for _ in range(length))
@@ -39,7 +52,276 @@ def generate_and_format_crypto_key() -> Tuple[str, str]:
     return formatted_cpp_key, readable_key_bytes
 
 
+# ============================================================================
+# BUILD HEADER (secrets.h)
+# ============================================================================
+
+
+def _siphash24(key: bytes, data: bytes) -> bytes:
+    """
+    SipHash-2-4, 8-byte little endian output, as siphash24() in credential.cpp.
+    """
+    mask = (1 << 64) - 1
+
+    def rotl(x: int, b: int) -> int:
+        return ((x << b) | (x >> (64 - b))) & mask
+
+    def sip_round(v: List[int]) -> None:
+        v[0] = (v[0] + v[1]) & mask
+        v[1] = rotl(v[1], 13) ^ v[0]
+        v[0] = rotl(v[0], 32)
+        v[2] = (v[2] + v[3]) & mask
+        v[3] = rotl(v[3], 16) ^ v[2]
+        v[0] = (v[0] + v[3]) & mask
+        v[3] = rotl(v[3], 21) ^ v[0]
+        v[2] = (v[2] + v[1]) & mask
+        v[1] = rotl(v[1], 17) ^ v[2]
+        v[2] = rotl(v[2], 32)
+
+    def compress(v: List[int], m: int) -> None:
+        v[3] ^= m
+        sip_round(v)
+        sip_round(v)
+        v[0] ^= m
+
+    k0 = int.from_bytes(key[:8], "little")
+    k1 = int.from_bytes(key[8:16], "little")
+    v = [
+        k0 ^ 0x736F6D6570736575,
+        k1 ^ 0x646F72616E646F6D,
+        k0 ^ 0x6C7967656E657261,
+        k1 ^ 0x7465646279746573,
+    ]
+
+    whole = len(data) - len(data) % 8
+    for i in range(0, whole, 8):
+        compress(v, int.from_bytes(data[i : i + 8], "little"))
+    compress(v, int.from_bytes(data[whole:], "little") | ((len(data) & 0xFF) << 56))
+
+    v[2] ^= 0xFF
+    for _ in range(4):
+        sip_round(v)
+    return (v[0] ^ v[1] ^ v[2] ^ v[3]).to_bytes(8, "little")
+
+
+def passphrase_digest(passphrase: str) -> bytes:
+    """
+    16-byte digest of a passphrase, as deriveMacKey() in credential.cpp.
+    Readers store only this digest, never the passphrase.
+    """
+    data = passphrase.encode("ascii")
+    high_key = KDF_KEY[:-1] + bytes([KDF_KEY[-1] ^ 0x01])
+    return _siphash24(KDF_KEY, data) + _siphash24(high_key, data)
+
+
+class SecretSource:
+    """
+    Source of the build secrets.
+
+    With a master secret every value is derived with HMAC-SHA256 from the master and
+    a label: the same master and key generation always give the same header. Without
+    a master every value is random.
+    """
+
+    def __init__(self, master: Optional[bytes]):
+        self.master = master
+
+    def bytes(self, label: str, length: int) -> List[int]:
+        if self.master is None:
+            return [secrets.randbelow(256) for _ in range(length)]
+        out = b""
+        counter = 0
+        while len(out) < length:
+            out += hmac.new(self.master, f"{label}/{counter}".encode(), hashlib.sha256).digest()
+            counter += 1
+        return list(out[:length])
+
+    def passphrase(self, length: int) -> str:
+        if self.master is None:
+            return generate_passphrase(length)
+        # 62 symbols from bytes below 248 (4 * 62): no modulo bias
+        chars = []
+        counter = 0
+        while len(chars) < length:
+            for b in self.bytes(f"passphrase/{counter}", 64):
+                if b < 248 and len(chars) < length:
+                    chars.append(PASSPHRASE_ALPHABET[b % 62])
+            counter += 1
+        return "".join(chars)
+
+
+def _c_bytes(values: List[int]) -> str:
+    return "{" + ", ".join(f"0x{b:02X}" for b in values) + "}"
+
+
+def render_header(
+    build_id: str,
+    passphrase: str,
+    digest: bytes,
+    keyring: List[List[int]],
+    ntag_password: List[int],
+    ntag_pack: List[int],
+    usage_key: List[int],
+    key_generation: int,
+) -> str:
+    """
+    Render rfid-box-writer/secrets.h.
+    """
+    rows = "\n".join(f"    {_c_bytes(key)}," for key in keyring)
+    passphrase_note = (
+        "// Empty: no passphrase in this build, a writer must be SET before writing cards"
+        if not passphrase
+        else "// Installed on a writer never SET, cards written with it are accepted out of the box"
+    )
+    return f"""/**
+ * @file secrets.h
+ * @brief Build secrets, GENERATED by secrets-generator-util: do not edit by hand
+ * @details Every value lives in flash (PROGMEM) and is read with pgm_read_byte() /
+ *          memcpy_P(): nothing is copied to SRAM or allocated at boot.
+ *          Key generation {key_generation}: KEYRING lists crypto_key first, then the keys
+ *          of the previous generations still accepted, then the factory key.
+ */
+
+#ifndef RFID_SECRETS_H
+#define RFID_SECRETS_H
+
+#include <MFRC522.h>
+
+// Build identifier, printed with the firmware version
+const char BUILD_ID[] PROGMEM = "{build_id}";
+
+/**
+ * @brief Factory secret of the build
+ * @details Used only by a box whose EEPROM holds no secret yet (never SET): writers
+ *          install the passphrase, readers only its digest (deriveMacKey()).
+ *          The first SET replaces it and retires it like any other secret.
+ */
+const char FACTORY_PASSPHRASE[] PROGMEM = "{passphrase}";
+{passphrase_note}
+const byte FACTORY_DIGEST[16] PROGMEM = {_c_bytes(list(digest))}; // MAC_KEY_SIZE (credential.h)
+
+/**
+ * @brief MIFARE Classic Key A written on the sectors of provisioned cards
+ */
+const byte crypto_key[MFRC522::MF_KEY_SIZE] PROGMEM = {_c_bytes(keyring[0])};
+
+/**
+ * @brief Candidate Key A values for authentication (keyring.h), in probe order
+ */
+const byte KEYRING[][MFRC522::MF_KEY_SIZE] PROGMEM = {{
+{rows}
+}};
+const byte KEYRING_SIZE = sizeof(KEYRING) / sizeof(KEYRING[0]);
+
+/**
+ * @brief Key B of the entry counter sector (usage-counter.h)
+ * @details Loads entries on limited-use badges. Only writers use it: readers hold
+ *          Key A, which can only take entries.
+ */
+const byte usage_key[MFRC522::MF_KEY_SIZE] PROGMEM = {_c_bytes(usage_key)};
+
+/**
+ * @brief NTAG / Ultralight EV1 write password and PACK (ultralight.h)
+ */
+const byte ntag_password[4] PROGMEM = {_c_bytes(ntag_password)};
+const byte ntag_pack[2] PROGMEM = {_c_bytes(ntag_pack)};
+
+#endif // RFID_SECRETS_H
+"""
+
+
+def write_header(args: argparse.Namespace) -> None:
+    master = None
+    if args.master:
+        with open(args.master, "rb") as f:
+            master = f.read().strip()
+        if not master:
+            raise SystemExit(f"❌ Empty master secret: {args.master}")
+
+    source = SecretSource(master)
+    if args.passphrase is not None:
+        passphrase = args.passphrase
+    elif args.no_passphrase:
+        passphrase = ""
+    else:
+        passphrase = source.passphrase(args.length)
+    if len(passphrase) > PASSPHRASE_MAX_LENGTH or any(c not in PASSPHRASE_ALPHABET for c in passphrase):
+        raise SystemExit(f"❌ The passphrase must be at most {PASSPHRASE_MAX_LENGTH} letters and digits")
+    if passphrase == DEMO_PASSPHRASE:
+        raise SystemExit("❌ The demo passphrase is published with the sources: choose another one")
+
+    # Current generation first, then the older ones the cards in the field may still have
+    keyring = [source.bytes(f"crypto_key/{gen}", 6) for gen in range(args.key_generation, 0, -1)]
+    keyring = keyring[: args.keep_generations] + [DEFAULT_KEY]
+    if args.crypto_key:
+        keyring[0] = args.crypto_key  # Existing fleet key imported as the current generation
+
+    digest = passphrase_digest(passphrase)
+    header = render_header(
+        args.build_id,
+        "" if args.digest_only else passphrase,
+        digest,
+        keyring,
+        args.ntag_password or source.bytes("ntag_password", 4),
+        args.ntag_pack or source.bytes("ntag_pack", 2),
+        args.usage_key or source.bytes("usage_key", 6),
+        args.key_generation,
+    )
+    with open(args.header, "w", encoding="ascii") as f:
+        f.write(header)
+
+    print(f"✅ Header written: {args.header}")
+    print(f"🏷️  Build id: {args.build_id}")
+    print(f"🔑 Crypto key (generation {args.key_generation}): " + " ".join(f"{b:02X}" for b in keyring[0]))
+    print("🔐 Passphrase digest: " + digest.hex().upper())
+    if master is None:
+        print("⚠️  No master secret: generated values are random, keep the header to rebuild the same firmware")
+
+
+def hex_bytes(length: int):
+    """
+    argparse type: exactly length bytes in hex, spaces allowed ("01 02 13 51 09 0F")
+    """
+
+    def parse(text: str) -> List[int]:
+        try:
+            values = list(bytes.fromhex(text))
+        except ValueError:
+            raise argparse.ArgumentTypeError(f"not hex bytes: {text}")
+        if len(values) != length:
+            raise argparse.ArgumentTypeError(f"{length} bytes expected, got {len(values)}")
+        return values
+
+    return parse
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="RFID Box secrets generator")
+    parser.add_argument("--header", help="write the build header (rfid-box-writer/secrets.h) instead of printing")
+    parser.add_argument("--master", help="file with the master secret: the header is derived from it reproducibly")
+    parser.add_argument("--build-id", default="dev", help="build identifier printed by the firmware (default: dev)")
+    parser.add_argument("--key-generation", type=int, default=1, help="crypto_key generation, raise it to re-key the fleet")
+    parser.add_argument("--keep-generations", type=int, default=2, help="key generations kept in KEYRING (default: 2)")
+    parser.add_argument("--length", type=int, default=64, help="length of a generated passphrase (default: 64)")
+    parser.add_argument("--passphrase", help="use this factory passphrase instead of generating one")
+    parser.add_argument("--no-passphrase", action="store_true", help="no factory secret: boxes wait for a SET")
+    parser.add_argument("--crypto-key", type=hex_bytes(6), help="current crypto_key (6 hex bytes) instead of a generated one")
+    parser.add_argument("--ntag-password", type=hex_bytes(4), help="NTAG password (4 hex bytes) instead of a generated one")
+    parser.add_argument("--ntag-pack", type=hex_bytes(2), help="NTAG PACK (2 hex bytes) instead of a generated one")
+    parser.add_argument("--usage-key", type=hex_bytes(6), help="usage counter Key B (6 hex bytes) instead of a generated one")
+    parser.add_argument("--digest-only", action="store_true", help="reader builds: emit the digest, not the passphrase")
+    args = parser.parse_args()
+    if args.key_generation < 1 or args.keep_generations < 1:
+        parser.error("--key-generation and --keep-generations start at 1")
+    return args
+
+
 def main():
+    args = parse_args()
+    if args.header:
+        write_header(args)
+        return
+
     print("🔐 RFID Box Secrets Generator")
     print("=" * 50)
 
@@ -57,18 +339,19 @@ def main():
 
     print("\n🔒 SECURITY NOTES:")
     print("- Keep these values secure and private")
-    print("- Update data.h with the new crypto_key and passphrase")
+    print("- Prefer --header: the whole secrets.h is generated in one step")
     print("- Re-program all existing cards with the new key")
     print("- Backup these values in a secure location")
 
     print("📋 C++ CODE TO UPDATE:")
     print("=" * 50)
 
-    print("For data.h - mainPassphrase:")
-    print(f'       const String mainPassphrase = "{new_passphrase}";')
+    print("For secrets.h - FACTORY_PASSPHRASE (and FACTORY_DIGEST):")
+    print(f'       const char FACTORY_PASSPHRASE[] PROGMEM = "{new_passphrase}";')
+    print("       const byte FACTORY_DIGEST[16] PROGMEM = " + _c_bytes(list(passphrase_digest(new_passphrase))) + ";")
 
-    print("For data.h - crypto_key:")
-    print(f"       const byte crypto_key[MFRC522::MF_KEY_SIZE] = {key};")
+    print("For secrets.h - crypto_key (and first KEYRING entry):")
+    print(f"       const byte crypto_key[MFRC522::MF_KEY_SIZE] PROGMEM = {key};")
 
 
 if __name__ == "__main__":
@@ -0,0 +1,56 @@
+#!/usr/bin/env bash
+#
+# size-report.sh - Confronta l'occupazione di FLASH e SRAM dei profili di build
+#                  WRITER (default) e READER (-DRFID_BOX_READER).
+#
+# Uso:   tools/size-report.sh [FQBN]
+#        FQBN di default: arduino:avr:uno
+#
+# Budget SRAM statica: SRAM_BUDGET (byte, default 1536 su 2048 dell'ATmega328).
+# La RAM restante è riservata a stack e heap (String, buffer dei blocchi).
+# Se uno dei profili supera il budget lo script termina con exit code 1.
+#
+# Richiede arduino-cli con il core della scheda e le librerie MFRC522 e LCD_I2C installate.
+
+set -euo pipefail
+
+FQBN="${1:-arduino:avr:uno}"
+SRAM_BUDGET="${SRAM_BUDGET:-1536}"
+SKETCH="$(cd "$(dirname "$0")/../rfid-box-writer" && pwd)"
+BUILD_ROOT="$(mktemp -d)"
+trap 'rm -rf "$BUILD_ROOT"' EXIT
+
+# compila un profilo e stampa "<flash> <sram>" in byte
+build_profile() {
+    local name="$1" flags="$2" out
+    out="$(arduino-cli compile --fqbn "$FQBN" \
+        --build-path "$BUILD_ROOT/$name" \
+        --build-property "compiler.cpp.extra_flags=$flags" \
+        "$SKETCH" 2>&1)" || { echo "$out" >&2; exit 1; }
+
+    local flash sram
+    flash="$(echo "$out" | sed -n 's/^Sketch uses \([0-9]*\) bytes.*/\1/p')"
+    sram="$(echo "$out" | sed -n 's/^Global variables use \([0-9]*\) bytes.*/\1/p')"
+    echo "$flash $sram"
+}
+
+read -r W_FLASH W_SRAM < <(build_profile writer "")
+read -r R_FLASH R_SRAM < <(build_profile reader "-DRFID_BOX_READER")
+
+printf '\nRFID Box size report (%s)\n\n' "$FQBN"
+printf '%-10s %12s %12s\n' "PROFILE" "FLASH [B]" "SRAM [B]"
+printf '%-10s %12s %12s\n' "writer" "$W_FLASH" "$W_SRAM"
+printf '%-10s %12s %12s\n' "reader" "$R_FLASH" "$R_SRAM"
+printf '%-10s %12s %12s\n' "delta" "$((R_FLASH - W_FLASH))" "$((R_SRAM - W_SRAM))"
+
+# controllo del budget di RAM statica
+status=0
+for profile in "writer $W_SRAM" "reader $R_SRAM"; do
+    set -- $profile
+    if [ "$2" -gt "$SRAM_BUDGET" ]; then
+        printf '\nFAIL: %s uses %s B of static RAM (budget %s B)\n' "$1" "$2" "$SRAM_BUDGET" >&2
+        status=1
+    fi
+done
+[ "$status" -eq 0 ] && printf '\nStatic RAM within budget (%s B)\n' "$SRAM_BUDGET"
+exit "$status"